@@ -7,15 +7,21 @@
  */
 
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
+#include <cmath>
+#include <condition_variable>
 #include <cstring>
 #include <iostream>
 #include <limits>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <sstream>
+#include <thread>
 #include <tuple>
 #include <vector>
 
@@ -305,8 +311,12 @@ class ProgramSettings
 {
 public:
 	VertexShader vertexShader = nullptr;
+	BatchedVertexShader batchedVertexShader = nullptr;
 	FragmentShader fragmentShader = nullptr;
 	std::array<AttribInterpolation, MAX_ATTRIBUTES> interpolations;
+	std::array<AttributeType, MAX_ATTRIBUTES> inputTypes;
+	unsigned fragmentEffects = 0;  // FragmentShaderEffect flags
+	DepthTestMode depthTestMode = DEPTH_TEST_AUTO;
 
 
 	ProgramSettings(
@@ -314,7 +324,117 @@ public:
 		const FragmentShader &fs = nullptr
 	)
 		: vertexShader(vs), fragmentShader(fs)
-	{}
+	{ inputTypes.fill(ATTRIB_EMPTY); }
+};
+
+
+class ThreadPool
+{
+public:
+	explicit ThreadPool(const size_t &nofThreads)
+	{
+		// calling thread is counted as the first thread
+		for (size_t t = 1; t < nofThreads; ++t)
+		{
+			this->workers.emplace_back(&ThreadPool::workerLoop, this, t);
+		}
+	}
+
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->stopping = true;
+		}
+		this->wakeUp.notify_all();
+		for (auto &worker : this->workers)
+		{ worker.join(); }
+	}
+
+
+	size_t getNofThreads() const
+	{
+		return this->workers.size() + 1;
+	}
+
+
+	void run(const size_t &nofTasks, const GPUTask &task, void *const &data)
+	{
+		if (this->workers.empty() || nofTasks <= 1)
+		{
+			for (size_t t = 0; t < nofTasks; ++t)
+			{ task(data, t, 0); }
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->task = task;
+			this->data = data;
+			this->nofTasks = nofTasks;
+			this->nextTask = 0;
+			this->nofBusyWorkers = this->workers.size();
+			this->generation++;
+		}
+		this->wakeUp.notify_all();
+
+		this->executeTasks(0);
+
+		std::unique_lock<std::mutex> lock(this->mutex);
+		this->done.wait(lock, [this]
+		{ return this->nofBusyWorkers == 0; });
+	}
+
+
+private:
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wakeUp;
+	std::condition_variable done;
+	GPUTask task = nullptr;
+	void *data = nullptr;
+	size_t nofTasks = 0;
+	std::atomic<size_t> nextTask{0};
+	size_t nofBusyWorkers = 0;
+	size_t generation = 0;
+	bool stopping = false;
+
+
+	void executeTasks(const size_t &thread)
+	{
+		for (size_t t = this->nextTask++; t < this->nofTasks;
+			t = this->nextTask++)
+		{
+			this->task(this->data, t, thread);
+		}
+	}
+
+
+	void workerLoop(const size_t thread)
+	{
+		size_t seenGeneration = 0;
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(this->mutex);
+				this->wakeUp.wait(lock, [this, &seenGeneration]
+				{
+					return this->stopping
+						|| this->generation != seenGeneration;
+				});
+				if (this->stopping)
+				{ return; }
+				seenGeneration = this->generation;
+			}
+
+			this->executeTasks(thread);
+
+			std::lock_guard<std::mutex> lock(this->mutex);
+			if (--this->nofBusyWorkers == 0)
+			{ this->done.notify_one(); }
+		}
+	}
 };
 
 
@@ -337,10 +457,94 @@ public:
 	AllUniforms uniforms;
 	std::vector<float> depthBuffer;
 	std::vector<Vec4> colorBuffer;
+	// this holds maximal depths of 8x8 and 64x64 tiles of depth buffer
+	std::vector<float> fineDepthTiles;
+	std::vector<float> coarseDepthTiles;
+	std::set<Capability> capabilities;  // this holds enabled capabilities
+	CullFaceMode cullFace = CULL_BACK;
+	FrontFace frontFace = FRONT_FACE_CCW;
+	PrimitiveTopology topology = TOPOLOGY_TRIANGLES;
+	VertexIndex primitiveRestartIndex = 0;
+	// this holds user clip planes
+	std::array<Vec4, MAX_USER_CLIP_PLANES> clipPlanes = {};
+	// this holds matrix of bounding volume culling
+	Mat4 cullingMatrix = {{
+		{{1.f, 0.f, 0.f, 0.f}}, {{0.f, 1.f, 0.f, 0.f}},
+		{{0.f, 0.f, 1.f, 0.f}}, {{0.f, 0.f, 0.f, 1.f}}
+	}};
+	PipelineStatistics statistics = {};  // this holds pipeline counters
+	// this holds number of threads, zero selects number of hardware threads
+	size_t nofThreads = 0;
+	// worker threads are started lazily by the first parallel task
+	std::unique_ptr<ThreadPool> threadPool;
 
 	static const size_t outOfRange;
 
 
+	static size_t nofTiles(size_t nofPixels, size_t tileSize)
+	{
+		return (nofPixels + tileSize - 1) / tileSize;
+	}
+
+
+	// recomputes maximal depths of tiles that overlap region
+	void updateDepthTiles(size_t xMin, size_t yMin, size_t xMax, size_t yMax)
+	{
+		const size_t w = this->viewportWidth;
+		const size_t h = this->viewportHeight;
+		xMax = std::min(xMax, w);
+		yMax = std::min(yMax, h);
+		if (xMin >= xMax || yMin >= yMax)
+		{ return; }
+
+		const size_t fineWidth = nofTiles(w, HIZ_FINE_TILE_SIZE);
+		for (size_t ty = yMin / HIZ_FINE_TILE_SIZE;
+			ty <= (yMax - 1) / HIZ_FINE_TILE_SIZE; ++ty)
+		{
+			for (size_t tx = xMin / HIZ_FINE_TILE_SIZE;
+				tx <= (xMax - 1) / HIZ_FINE_TILE_SIZE; ++tx)
+			{
+				float maxDepth = -INFINITY;
+				const size_t yEnd = std::min((ty + 1) * HIZ_FINE_TILE_SIZE, h);
+				const size_t xEnd = std::min((tx + 1) * HIZ_FINE_TILE_SIZE, w);
+				for (size_t y = ty * HIZ_FINE_TILE_SIZE; y < yEnd; ++y)
+				{
+					for (size_t x = tx * HIZ_FINE_TILE_SIZE; x < xEnd; ++x)
+					{
+						maxDepth = std::max(maxDepth, this->depthBuffer[y * w + x]);
+					}
+				}
+				this->fineDepthTiles[ty * fineWidth + tx] = maxDepth;
+			}
+		}
+
+		const size_t fineHeight = nofTiles(h, HIZ_FINE_TILE_SIZE);
+		const size_t coarseWidth = nofTiles(w, HIZ_COARSE_TILE_SIZE);
+		const size_t ratio = HIZ_COARSE_TILE_SIZE / HIZ_FINE_TILE_SIZE;
+		for (size_t ty = yMin / HIZ_COARSE_TILE_SIZE;
+			ty <= (yMax - 1) / HIZ_COARSE_TILE_SIZE; ++ty)
+		{
+			for (size_t tx = xMin / HIZ_COARSE_TILE_SIZE;
+				tx <= (xMax - 1) / HIZ_COARSE_TILE_SIZE; ++tx)
+			{
+				float maxDepth = -INFINITY;
+				const size_t yEnd = std::min((ty + 1) * ratio, fineHeight);
+				const size_t xEnd = std::min((tx + 1) * ratio, fineWidth);
+				for (size_t y = ty * ratio; y < yEnd; ++y)
+				{
+					for (size_t x = tx * ratio; x < xEnd; ++x)
+					{
+						maxDepth = std::max(
+							maxDepth, this->fineDepthTiles[y * fineWidth + x]
+						);
+					}
+				}
+				this->coarseDepthTiles[ty * coarseWidth + tx] = maxDepth;
+			}
+		}
+	}
+
+
 	size_t getLinearPixelCoord(
 		size_t x, size_t y, const std::string &fceName
 	) const
@@ -377,6 +581,9 @@ public:
 	// (even deleted), zero is reserved for empty
 	// vao
 	VertexPullerID activeVao = 0;   // currently bound vao
+	// sizes in bytes of input attributes that are validated for the whole
+	// current draw call, zero means that fetches are validated one by one
+	std::array<size_t, MAX_ATTRIBUTES> validatedAttributeSizes{};
 
 	std::map<VertexPullerID, PullerReferences> pullerReferences;
 	std::map<BufferID, BufferReferences> bufferReferences;
@@ -442,6 +649,21 @@ public:
 	}
 
 
+	ThreadPool &getThreadPool()
+	{
+		if (!this->threadPool)
+		{
+			size_t n = this->nofThreads;
+			if (n == 0)
+			{
+				n = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+			}
+			this->threadPool.reset(new ThreadPool(n));
+		}
+		return *this->threadPool;
+	}
+
+
 	void setEnableVertexAttrib(
 		const VertexPullerID &puller,
 		const size_t &headIndex, const bool &enable,
@@ -714,7 +936,7 @@ void cpu_bufferData(
 	const auto &bufferReferences = g->bufferReferences.at(buffer);
 	for (const auto &puller : bufferReferences.getIndexings())
 	{
-		g->vaos.at(puller).indices = (const VertexIndex *) buf.data();
+		g->vaos.at(puller).indices = buf.data();
 	}
 
 	for (const auto &pullerAttrib : bufferReferences.getAttribs())
@@ -737,7 +959,8 @@ void cpu_createVertexPullers(
 	{
 		const auto currentId = g->vaoCounter + i;
 		arrays[i] = currentId;
-		g->vaos[currentId] = GPUVertexPullerConfiguration{{}, nullptr};
+		g->vaos[currentId] =
+			GPUVertexPullerConfiguration{{}, nullptr, 0, 0, {}, {}};
 		for (size_t h = 0; h < MAX_ATTRIBUTES; ++h)
 		{
 			auto &head = g->vaos[currentId].heads[h];
@@ -745,6 +968,7 @@ void cpu_createVertexPullers(
 			head.enabled = false;
 			head.stride = 0;
 			head.offset = 0;
+			head.divisor = 0;
 		}
 		g->pullerReferences[currentId] = PullerReferences();
 	}
@@ -793,6 +1017,51 @@ void cpu_setVertexPullerHead(
 }
 
 
+void cpu_setVertexPullerHeadDivisor(
+	const GPU gpu, const VertexPullerID puller,
+	const size_t attribIndex, const size_t divisor
+)
+{
+	assert(gpu != nullptr);
+	if (attribIndex >= MAX_ATTRIBUTES)
+	{
+		printAttribIndexError(attribIndex, __func__);
+		return;
+	}
+
+	auto g = static_cast<GpuImplementation *>(gpu);
+	auto vaoIt = g->getVAO(puller, __func__);
+	if (vaoIt == g->vaos.end())
+	{ return; }
+
+	vaoIt->second.heads[attribIndex].divisor = divisor;
+}
+
+
+void cpu_setVertexPullerBoundingBox(
+	const GPU gpu, const VertexPullerID puller, const Vec3 *const min,
+	const Vec3 *const max
+)
+{
+	assert(gpu != nullptr);
+	assert(min == nullptr || max != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	auto vaoIt = g->getVAO(puller, __func__);
+	if (vaoIt == g->vaos.end())
+	{ return; }
+
+	auto &configuration = vaoIt->second;
+	configuration.bounded = min != nullptr;
+	if (min == nullptr)
+	{ return; }
+	for (size_t c = 0; c < 3; ++c)
+	{
+		configuration.boundingBoxMin[c] = min->data[c];
+		configuration.boundingBoxMax[c] = max->data[c];
+	}
+}
+
+
 void cpu_setIndexing(
 	const GPU gpu, const VertexPullerID puller,
 	const BufferID buffer, const size_t indexSize
@@ -823,7 +1092,8 @@ void cpu_setIndexing(
 		ptr = &*bufferIt->second.data();
 	}
 
-	vaoIt->second.indices = (const VertexIndex *) ptr;
+	vaoIt->second.indices = ptr;
+	vaoIt->second.indexSize = indexSize;
 
 	auto &pullerReferences = g->pullerReferences.at(puller);
 	if (pullerReferences.getIndexBuffer() != GpuImplementation::EMPTY_BUFFER_ID)
@@ -904,6 +1174,38 @@ void cpu_attachVertexShader(
 }
 
 
+void cpu_attachBatchedVertexShader(
+	const GPU gpu, const ProgramID program, const BatchedVertexShader shader
+)
+{
+	assert(gpu != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	auto it = g->getProgram(program, __func__);
+	if (it == g->programs.end())
+	{ return; }
+	it->second.batchedVertexShader = shader;
+}
+
+
+void cpu_setVertexShaderInputType(
+	const GPU gpu, const ProgramID program, const size_t attribIndex,
+	const AttributeType type
+)
+{
+	if (attribIndex >= MAX_ATTRIBUTES)
+	{
+		printAttribIndexError(attribIndex, __func__);
+		exit(1);
+	}
+	assert(gpu != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	auto it = g->getProgram(program, __func__);
+	if (it == g->programs.end())
+	{ exit(1); }
+	it->second.inputTypes[attribIndex] = type;
+}
+
+
 void cpu_attachFragmentShader(
 	const GPU gpu, const ProgramID program, const FragmentShader shader
 )
@@ -945,6 +1247,15 @@ void cpu_setViewportSize(const GPU gpu, const size_t width, const size_t height)
 	const size_t nofPixels = g->viewportWidth * g->viewportHeight;
 	g->colorBuffer.resize(nofPixels);
 	g->depthBuffer.resize(nofPixels);
+	g->fineDepthTiles.resize(
+		GpuImplementation::nofTiles(width, HIZ_FINE_TILE_SIZE)
+		* GpuImplementation::nofTiles(height, HIZ_FINE_TILE_SIZE)
+	);
+	g->coarseDepthTiles.resize(
+		GpuImplementation::nofTiles(width, HIZ_COARSE_TILE_SIZE)
+		* GpuImplementation::nofTiles(height, HIZ_COARSE_TILE_SIZE)
+	);
+	g->updateDepthTiles(0, 0, width, height);
 }
 
 
@@ -964,6 +1275,231 @@ size_t gpu_getViewportHeight(const GPU gpu)
 }
 
 
+void cpu_enable(const GPU gpu, const Capability capability)
+{
+	assert(gpu != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	g->capabilities.insert(capability);
+}
+
+
+void cpu_disable(const GPU gpu, const Capability capability)
+{
+	assert(gpu != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	g->capabilities.erase(capability);
+}
+
+
+int gpu_isEnabled(const GPU gpu, const Capability capability)
+{
+	assert(gpu != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	return g->capabilities.count(capability) > 0;
+}
+
+
+void cpu_setCullFace(const GPU gpu, const CullFaceMode mode)
+{
+	assert(gpu != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	g->cullFace = mode;
+}
+
+
+void cpu_setFrontFace(const GPU gpu, const FrontFace frontFace)
+{
+	assert(gpu != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	g->frontFace = frontFace;
+}
+
+
+CullFaceMode gpu_getCullFace(const GPU gpu)
+{
+	assert(gpu != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	return g->cullFace;
+}
+
+
+FrontFace gpu_getFrontFace(const GPU gpu)
+{
+	assert(gpu != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	return g->frontFace;
+}
+
+
+void cpu_setPrimitiveTopology(const GPU gpu, const PrimitiveTopology topology)
+{
+	assert(gpu != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	g->topology = topology;
+}
+
+
+void cpu_setPrimitiveRestartIndex(const GPU gpu, const VertexIndex index)
+{
+	assert(gpu != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	g->primitiveRestartIndex = index;
+}
+
+
+PrimitiveTopology gpu_getPrimitiveTopology(const GPU gpu)
+{
+	assert(gpu != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	return g->topology;
+}
+
+
+VertexIndex gpu_getPrimitiveRestartIndex(const GPU gpu)
+{
+	assert(gpu != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	return g->primitiveRestartIndex;
+}
+
+
+void cpu_setClipPlane(
+	const GPU gpu, const size_t index, const Vec4 *const plane
+)
+{
+	assert(gpu != nullptr);
+	assert(plane != nullptr);
+	if (index >= MAX_USER_CLIP_PLANES)
+	{
+		std::cerr << fceArgError2Str(index, __func__)
+			<< "index has to be lower than " << MAX_USER_CLIP_PLANES
+			<< std::endl;
+		return;
+	}
+	auto g = static_cast<GpuImplementation *>(gpu);
+	g->clipPlanes[index] = *plane;
+}
+
+
+size_t gpu_getClipPlanes(const GPU gpu, Vec4 planes[MAX_USER_CLIP_PLANES])
+{
+	assert(gpu != nullptr);
+	assert(planes != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	size_t nofPlanes = 0;
+	for (size_t p = 0; p < MAX_USER_CLIP_PLANES; ++p)
+	{
+		const auto capability = static_cast<Capability>(CLIP_PLANE0 + p);
+		if (g->capabilities.count(capability) > 0)
+		{ planes[nofPlanes++] = g->clipPlanes[p]; }
+	}
+	return nofPlanes;
+}
+
+
+void cpu_setCullingMatrix(const GPU gpu, const Mat4 *const matrix)
+{
+	assert(gpu != nullptr);
+	assert(matrix != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	g->cullingMatrix = *matrix;
+}
+
+
+const Mat4 *gpu_getCullingMatrix(const GPU gpu)
+{
+	assert(gpu != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	return &g->cullingMatrix;
+}
+
+
+const PipelineStatistics *cpu_getPipelineStatistics(const GPU gpu)
+{
+	assert(gpu != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	return &g->statistics;
+}
+
+
+void cpu_resetPipelineStatistics(const GPU gpu)
+{
+	assert(gpu != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	g->statistics = PipelineStatistics();
+}
+
+
+void gpu_addPipelineStatistics(
+	const GPU gpu, const PipelineStatistics *const statistics
+)
+{
+	assert(gpu != nullptr);
+	assert(statistics != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	g->statistics.nofDrawCalls += statistics->nofDrawCalls;
+	g->statistics.nofVertexShaderInvocations +=
+		statistics->nofVertexShaderInvocations;
+	g->statistics.nofVertexCacheHits += statistics->nofVertexCacheHits;
+	g->statistics.nofAssembledTriangles += statistics->nofAssembledTriangles;
+	g->statistics.nofClippedTriangles += statistics->nofClippedTriangles;
+	g->statistics.nofCulledTriangles += statistics->nofCulledTriangles;
+	g->statistics.nofDegenerateTriangles +=
+		statistics->nofDegenerateTriangles;
+	g->statistics.nofEmptyTriangles += statistics->nofEmptyTriangles;
+	g->statistics.nofSubPixelTriangles += statistics->nofSubPixelTriangles;
+	g->statistics.nofSubPixelRejectedTriangles +=
+		statistics->nofSubPixelRejectedTriangles;
+	g->statistics.nofCulledDrawCalls += statistics->nofCulledDrawCalls;
+}
+
+
+void cpu_setNofThreads(const GPU gpu, const size_t nofThreads)
+{
+	assert(gpu != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	g->nofThreads = nofThreads;
+	g->threadPool.reset();
+}
+
+
+size_t gpu_getNofThreads(const GPU gpu)
+{
+	assert(gpu != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	return g->getThreadPool().getNofThreads();
+}
+
+
+void gpu_runTasks(
+	const GPU gpu, const size_t nofTasks, const GPUTask task, void *const data
+)
+{
+	assert(gpu != nullptr);
+	assert(task != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	g->getThreadPool().run(nofTasks, task, data);
+}
+
+
+const void *gpu_getBufferData(
+	const GPU gpu, const BufferID buffer, size_t *const size
+)
+{
+	assert(gpu != nullptr);
+	assert(size != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	auto it = g->getBuffer(buffer, __func__);
+	if (it == g->buffers.end())
+	{
+		*size = 0;
+		return nullptr;
+	}
+	*size = it->second.size();
+	return it->second.data();
+}
+
+
 const GPUVertexPullerConfiguration *gpu_getActiveVertexPuller(const GPU gpu)
 {
 	assert(gpu != nullptr);
@@ -975,6 +1511,23 @@ const GPUVertexPullerConfiguration *gpu_getActiveVertexPuller(const GPU gpu)
 }
 
 
+size_t gpu_getNofIndices(const GPU gpu)
+{
+	assert(gpu != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	const auto vaoIt = g->vaos.find(g->activeVao);
+	const auto referencesIt = g->pullerReferences.find(g->activeVao);
+	if (vaoIt == g->vaos.end() || referencesIt == g->pullerReferences.end()
+		|| vaoIt->second.indices == nullptr)
+	{ return 0; }
+	const auto bufferIt =
+		g->buffers.find(referencesIt->second.getIndexBuffer());
+	if (bufferIt == g->buffers.end())
+	{ return 0; }
+	return bufferIt->second.size() / vaoIt->second.indexSize;
+}
+
+
 VertexShader gpu_getActiveVertexShader(const GPU gpu)
 {
 	assert(gpu != nullptr);
@@ -986,6 +1539,101 @@ VertexShader gpu_getActiveVertexShader(const GPU gpu)
 }
 
 
+BatchedVertexShader gpu_getActiveBatchedVertexShader(const GPU gpu)
+{
+	assert(gpu != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	auto it = g->getProgram(g->activeProgram, __func__);
+	if (it == g->programs.end())
+	{ exit(1); }
+	return it->second.batchedVertexShader;
+}
+
+
+AttributeType gpu_getVertexShaderInputType(
+	const GPU gpu, const size_t attribIndex
+)
+{
+	if (attribIndex >= MAX_ATTRIBUTES)
+	{
+		printAttribIndexError(attribIndex, __func__);
+		exit(1);
+	}
+	assert(gpu != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	auto it = g->getProgram(g->activeProgram, __func__);
+	if (it == g->programs.end())
+	{ exit(1); }
+	return it->second.inputTypes[attribIndex];
+}
+
+
+void gpu_validateVertexFetch(
+	const GPU gpu, const size_t nofVertexIDs, const size_t nofInstances
+)
+{
+	assert(gpu != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	g->validatedAttributeSizes.fill(0);
+	const auto programIt = g->programs.find(g->activeProgram);
+	const auto vaoIt = g->vaos.find(g->activeVao);
+	const auto referencesIt = g->pullerReferences.find(g->activeVao);
+	if (nofVertexIDs == 0 || programIt == g->programs.end()
+		|| vaoIt == g->vaos.end() || referencesIt == g->pullerReferences.end())
+	{ return; }
+
+	// attributes without declared type or out of range are validated per
+	// fetch, so errors are reported by attribute interpretation as before
+	for (size_t a = 0; a < MAX_ATTRIBUTES; ++a)
+	{
+		const AttributeType type = programIt->second.inputTypes[a];
+		const GPUVertexPullerHead &head = vaoIt->second.heads[a];
+		if (type == ATTRIB_EMPTY || head.enabled != 1
+			|| !referencesIt->second.hasAttribBuffer(a))
+		{ continue; }
+		const auto bufferIt =
+			g->buffers.find(referencesIt->second.getAttribBuffer(a));
+		if (bufferIt == g->buffers.end())
+		{ continue; }
+
+		// heads with divisor advance per instance instead of per vertex
+		const size_t nofElements = head.divisor == 0 ? nofVertexIDs
+			: (nofInstances + head.divisor - 1) / head.divisor;
+		if (nofElements == 0)
+		{ continue; }
+		const size_t size = sizeof(float) * static_cast<size_t>(type);
+		const size_t last = head.offset + head.stride * (nofElements - 1);
+		const auto &data = bufferIt->second;
+		if (head.buffer == data.data() && last + size <= data.size())
+		{ g->validatedAttributeSizes[a] = size; }
+	}
+}
+
+
+void gpu_invalidateVertexFetch(const GPU gpu)
+{
+	assert(gpu != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	g->validatedAttributeSizes.fill(0);
+}
+
+
+int gpu_isAttributeFetchValidated(
+	const GPU gpu, const size_t attribIndex, const size_t size
+)
+{
+	if (attribIndex >= MAX_ATTRIBUTES)
+	{
+		printAttribIndexError(attribIndex, __func__);
+		exit(1);
+	}
+	assert(gpu != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	const size_t validated = g->validatedAttributeSizes[attribIndex];
+	return validated != 0 && size <= validated;
+}
+
+
 FragmentShader gpu_getActiveFragmentShader(const GPU gpu)
 {
 	assert(gpu != nullptr);
@@ -1012,6 +1660,10 @@ void cpu_clearDepth(const GPU gpu, const float depth)
 	auto g = static_cast<GpuImplementation *>(gpu);
 	for (auto &x : g->depthBuffer)
 	{ x = depth; }
+	for (auto &x : g->fineDepthTiles)
+	{ x = depth; }
+	for (auto &x : g->coarseDepthTiles)
+	{ x = depth; }
 }
 
 
@@ -1047,6 +1699,20 @@ void gpu_setDepth(
 	if (index == GpuImplementation::outOfRange)
 	{ exit(1); }
 	g->depthBuffer.at(index) = depth;
+
+	// keep maximal depths of tiles conservative
+	float &fine = g->fineDepthTiles[
+		(y / HIZ_FINE_TILE_SIZE)
+		* GpuImplementation::nofTiles(g->viewportWidth, HIZ_FINE_TILE_SIZE)
+		+ x / HIZ_FINE_TILE_SIZE
+	];
+	fine = std::max(fine, depth);
+	float &coarse = g->coarseDepthTiles[
+		(y / HIZ_COARSE_TILE_SIZE)
+		* GpuImplementation::nofTiles(g->viewportWidth, HIZ_COARSE_TILE_SIZE)
+		+ x / HIZ_COARSE_TILE_SIZE
+	];
+	coarse = std::max(coarse, depth);
 }
 
 
@@ -1063,6 +1729,45 @@ void gpu_setColor(
 }
 
 
+float *gpu_getDepthBuffer(const GPU gpu)
+{
+	assert(gpu != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	return g->depthBuffer.data();
+}
+
+
+Vec4 *gpu_getColorBuffer(const GPU gpu)
+{
+	assert(gpu != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	return g->colorBuffer.data();
+}
+
+
+const float *gpu_getHierarchicalDepth(const GPU gpu, const size_t tileSize)
+{
+	assert(gpu != nullptr);
+	assert(
+		tileSize == HIZ_FINE_TILE_SIZE || tileSize == HIZ_COARSE_TILE_SIZE
+	);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	return tileSize == HIZ_FINE_TILE_SIZE
+		? g->fineDepthTiles.data() : g->coarseDepthTiles.data();
+}
+
+
+void gpu_updateHierarchicalDepth(
+	const GPU gpu, const size_t xMin, const size_t yMin, const size_t xMax,
+	const size_t yMax
+)
+{
+	assert(gpu != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	g->updateDepthTiles(xMin, yMin, xMax, yMax);
+}
+
+
 void cpu_setAttributeInterpolation(
 	const GPU gpu, const ProgramID program,
 	const size_t attribIndex,
@@ -1085,6 +1790,63 @@ void cpu_setAttributeInterpolation(
 }
 
 
+void cpu_setFragmentShaderEffects(
+	const GPU gpu, const ProgramID program, const unsigned effects
+)
+{
+	assert(gpu != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	auto it = g->getProgram(program, __func__);
+	if (it == g->programs.end())
+	{ exit(1); }
+	it->second.fragmentEffects = effects;
+}
+
+
+void cpu_setDepthTestMode(
+	const GPU gpu, const ProgramID program, const DepthTestMode mode
+)
+{
+	assert(gpu != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	auto it = g->getProgram(program, __func__);
+	if (it == g->programs.end())
+	{ exit(1); }
+	it->second.depthTestMode = mode;
+}
+
+
+int gpu_isEarlyDepthTestActive(const GPU gpu)
+{
+	assert(gpu != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	auto it = g->getProgram(g->activeProgram, __func__);
+	if (it == g->programs.end())
+	{ exit(1); }
+	switch (it->second.depthTestMode)
+	{
+		case DEPTH_TEST_EARLY:
+			return 1;
+		case DEPTH_TEST_LATE:
+			return 0;
+		default:
+			return !(it->second.fragmentEffects
+				& (FRAGMENT_WRITES_DEPTH | FRAGMENT_DISCARDS));
+	}
+}
+
+
+unsigned gpu_getFragmentShaderEffects(const GPU gpu)
+{
+	assert(gpu != nullptr);
+	auto g = static_cast<GpuImplementation *>(gpu);
+	auto it = g->getProgram(g->activeProgram, __func__);
+	if (it == g->programs.end())
+	{ exit(1); }
+	return it->second.fragmentEffects;
+}
+
+
 InterpolationType gpu_getAttributeInterpolation(
 	const GPU gpu, const size_t attribIndex
 )
@@ -1127,6 +1889,10 @@ AttributeType gpu_getAttributeType(const GPU gpu, const size_t attribIndex)
     return nullptr;                                                            \
   }                                                                            \
   auto       g            = (GpuImplementation*)gpu;                           \
+  if (sizeof(TYPE) <= g->validatedAttributeSizes[attributeIndex]) {            \
+    return reinterpret_cast<TYPE const*>(                                      \
+        vertex->attributes->attributes[attributeIndex]);                       \
+  }                                                                            \
   const auto referencesIt = g->pullerReferences.find(g->activeVao);            \
   if (referencesIt == g->pullerReferences.end()) {                             \
     std::cerr << fceArgError2Str(attributeIndex, __func__)                     \
@@ -1061,7 +1061,7 @@ const BunnyVertex bunnyVertices[1048] = {
 	{{0.43413f, -0.960972f, 0.348519f}, {0.0588828f, -0.985535f, 0.158914f}},
 };
 
-const VertexIndex bunnyIndices[2092][3] = {
+const uint16_t bunnyIndices[2092][3] = {
 	{657, 465, 37},
 	{466, 0, 1},
 	{37, 466, 13},
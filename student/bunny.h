@@ -33,7 +33,7 @@ typedef struct BunnyVertex
 extern const BunnyVertex bunnyVertices[1048];
 
 /// This variable contains Standford bunny indices.
-extern const VertexIndex bunnyIndices[2092][3];
+extern const uint16_t bunnyIndices[2092][3];
 
 
 #ifdef __cplusplus
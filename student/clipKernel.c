@@ -0,0 +1,223 @@
+/**
+ * @file
+ * @brief This file contains implementation of clip kernels.
+ *
+ * @author Dominik Harmim <harmim6@gmail.com>
+ */
+
+
+#include <assert.h>
+
+#include <student/clipKernel.h>
+#include <student/linearAlgebra.h>
+#include <student/rasterizationKernel.h>
+
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+/**
+ * @brief SIMD kernels are compiled for x86 with target attributes, instruction
+ * set is selected at runtime.
+ */
+#define KERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+
+/**
+ * @brief This function stores masks of one plane into per-triangle masks.
+ *
+ * @param outsideAll per-triangle planes that reject triangle
+ * @param outsideAny per-triangle planes that are crossed by triangle
+ * @param all triangles (bit per triangle) whose vertices all lie behind plane
+ * @param any triangles (bit per triangle) with some vertex behind plane
+ * @param plane index of plane
+ */
+static void gpu_storePlaneMasks(
+	unsigned outsideAll[CLIP_BATCH_SIZE], unsigned outsideAny[CLIP_BATCH_SIZE],
+	const unsigned all, const unsigned any, const size_t plane
+)
+{
+	for (size_t t = 0; t < CLIP_BATCH_SIZE; ++t)
+	{
+		outsideAll[t] |= ((all >> t) & 1u) << plane;
+		outsideAny[t] |= ((any >> t) & 1u) << plane;
+	}
+}
+
+
+/**
+ * @brief This function is scalar clip kernel.
+ *
+ * @param outsideAll output planes that reject triangle
+ * @param outsideAny output planes that are crossed by triangle
+ * @param batch triangles
+ * @param planes clip planes
+ * @param nofPlanes number of planes
+ */
+static void gpu_clipKernelScalar(
+	unsigned outsideAll[CLIP_BATCH_SIZE], unsigned outsideAny[CLIP_BATCH_SIZE],
+	const GPUClipBatch *const batch, const Vec4 *const planes,
+	const size_t nofPlanes
+)
+{
+	for (size_t t = 0; t < CLIP_BATCH_SIZE; ++t)
+	{
+		outsideAll[t] = 0;
+		outsideAny[t] = 0;
+	}
+	for (size_t p = 0; p < nofPlanes; ++p)
+	{
+		unsigned all = (1u << CLIP_BATCH_SIZE) - 1;
+		unsigned any = 0;
+		for (size_t v = 0; v < VERTICES_PER_TRIANGLE; ++v)
+		{
+			unsigned outside = 0;
+			for (size_t t = 0; t < batch->nofTriangles; ++t)
+			{
+				Vec4 position;
+				for (size_t c = 0; c < 4; ++c)
+				{ position.data[c] = batch->positions[c][v][t]; }
+				outside |= (unsigned) (dot_Vec4(planes + p, &position) < 0.f)
+					<< t;
+			}
+			all &= outside;
+			any |= outside;
+		}
+		gpu_storePlaneMasks(outsideAll, outsideAny, all, any, p);
+	}
+}
+
+
+#ifdef KERNEL_X86
+/**
+ * @brief This function is SSE2 clip kernel that evaluates planes for 4
+ * triangles at once.
+ *
+ * @param outsideAll output planes that reject triangle
+ * @param outsideAny output planes that are crossed by triangle
+ * @param batch triangles
+ * @param planes clip planes
+ * @param nofPlanes number of planes
+ */
+__attribute__((target("sse2")))
+static void gpu_clipKernelSSE2(
+	unsigned outsideAll[CLIP_BATCH_SIZE], unsigned outsideAny[CLIP_BATCH_SIZE],
+	const GPUClipBatch *const batch, const Vec4 *const planes,
+	const size_t nofPlanes
+)
+{
+	for (size_t t = 0; t < CLIP_BATCH_SIZE; ++t)
+	{
+		outsideAll[t] = 0;
+		outsideAny[t] = 0;
+	}
+	const __m128 zero = _mm_setzero_ps();
+	for (size_t p = 0; p < nofPlanes; ++p)
+	{
+		unsigned all = (1u << CLIP_BATCH_SIZE) - 1;
+		unsigned any = 0;
+		for (size_t v = 0; v < VERTICES_PER_TRIANGLE; ++v)
+		{
+			unsigned outside = 0;
+			for (size_t half = 0; half < CLIP_BATCH_SIZE; half += 4)
+			{
+				// the same order of operations as dot_Vec4()
+				__m128 distance = zero;
+				for (size_t c = 0; c < 4; ++c)
+				{
+					distance = _mm_add_ps(distance, _mm_mul_ps(
+						_mm_set1_ps(planes[p].data[c]),
+						_mm_loadu_ps(batch->positions[c][v] + half)
+					));
+				}
+				outside |= (unsigned) _mm_movemask_ps(
+					_mm_cmplt_ps(distance, zero)
+				) << half;
+			}
+			all &= outside;
+			any |= outside;
+		}
+		gpu_storePlaneMasks(outsideAll, outsideAny, all, any, p);
+	}
+}
+
+
+/**
+ * @brief This function is AVX2 clip kernel that evaluates planes for 8
+ * triangles at once.
+ *
+ * @param outsideAll output planes that reject triangle
+ * @param outsideAny output planes that are crossed by triangle
+ * @param batch triangles
+ * @param planes clip planes
+ * @param nofPlanes number of planes
+ */
+__attribute__((target("avx2")))
+static void gpu_clipKernelAVX2(
+	unsigned outsideAll[CLIP_BATCH_SIZE], unsigned outsideAny[CLIP_BATCH_SIZE],
+	const GPUClipBatch *const batch, const Vec4 *const planes,
+	const size_t nofPlanes
+)
+{
+	for (size_t t = 0; t < CLIP_BATCH_SIZE; ++t)
+	{
+		outsideAll[t] = 0;
+		outsideAny[t] = 0;
+	}
+	const __m256 zero = _mm256_setzero_ps();
+	for (size_t p = 0; p < nofPlanes; ++p)
+	{
+		__m256 all = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		__m256 any = zero;
+		for (size_t v = 0; v < VERTICES_PER_TRIANGLE; ++v)
+		{
+			// the same order of operations as dot_Vec4()
+			__m256 distance = zero;
+			for (size_t c = 0; c < 4; ++c)
+			{
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(
+					_mm256_set1_ps(planes[p].data[c]),
+					_mm256_loadu_ps(batch->positions[c][v])
+				));
+			}
+			const __m256 outside = _mm256_cmp_ps(distance, zero, _CMP_LT_OQ);
+			all = _mm256_and_ps(all, outside);
+			any = _mm256_or_ps(any, outside);
+		}
+		gpu_storePlaneMasks(
+			outsideAll, outsideAny, (unsigned) _mm256_movemask_ps(all),
+			(unsigned) _mm256_movemask_ps(any), p
+		);
+	}
+}
+#endif
+
+
+/**
+ * @brief clip kernels ordered from the fastest one, the scalar kernel has to
+ * be the last one
+ */
+static const GPUClipKernelInfo kernels[] = {
+#ifdef KERNEL_X86
+	{gpu_clipKernelAVX2, "AVX2"},
+	{gpu_clipKernelSSE2, "SSE2"},
+#endif
+	{gpu_clipKernelScalar, "scalar"},
+};
+
+
+const GPUClipKernelInfo *gpu_getClipKernels(size_t *const nofKernels)
+{
+	assert(nofKernels != NULL);
+
+	const size_t first = gpu_getSupportedKernelLevel();
+	*nofKernels = sizeof(kernels) / sizeof(kernels[0]) - first;
+	return kernels + first;
+}
+
+
+const GPUClipKernelInfo *gpu_getClipKernel(void)
+{
+	size_t nofKernels;
+	return gpu_getClipKernels(&nofKernels);
+}
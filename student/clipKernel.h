@@ -0,0 +1,91 @@
+/**
+ * @file
+ * @brief This file contains declarations of clip kernels that classify
+ * batches of triangles against user clip planes.
+ *
+ * @author Dominik Harmim <harmim6@gmail.com>
+ */
+
+
+#pragma once
+
+
+#include <stdlib.h>
+
+#include <student/fwd.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief number of triangles that are classified by one clip kernel call
+ */
+#define CLIP_BATCH_SIZE 8
+
+
+/**
+ * @brief This structure represents batch of triangles in clip-space stored
+ * as structure of arrays, so one plane is evaluated for all triangles at once.
+ */
+struct GPUClipBatch
+{
+	/// positions[component][vertex][triangle] in clip-space
+	float positions[4][VERTICES_PER_TRIANGLE][CLIP_BATCH_SIZE];
+	size_t nofTriangles; ///< number of used triangles
+};
+
+
+/**
+ * @brief This function type represents clip kernel.
+ * Kernel computes distances of vertices from planes and for every triangle
+ * of batch it sets bit p of outsideAll if all vertices lie behind plane p
+ * (dot(plane, position) < 0) and bit p of outsideAny if some vertex does.
+ * Lanes of unused triangles are undefined.
+ *
+ * @param outsideAll output planes that reject triangle
+ * @param outsideAny output planes that are crossed by triangle
+ * @param batch triangles
+ * @param planes clip planes in clip-space
+ * @param nofPlanes number of planes (at most MAX_USER_CLIP_PLANES)
+ */
+typedef void (*GPUClipKernel)(
+	unsigned outsideAll[CLIP_BATCH_SIZE], unsigned outsideAny[CLIP_BATCH_SIZE],
+	const GPUClipBatch *batch, const Vec4 *planes, size_t nofPlanes
+);
+
+/**
+ * @brief This structure describes clip kernel.
+ */
+struct GPUClipKernelInfo
+{
+	GPUClipKernel kernel; ///<kernel function
+	const char *name; ///<name of instruction set used by kernel
+};
+
+
+/**
+ * @brief This function returns clip kernels that are supported by CPU, the
+ * fastest kernel is the first one and the scalar kernel is always the last
+ * one.
+ *
+ * @param nofKernels output number of supported kernels
+ *
+ * @return supported kernels
+ */
+const GPUClipKernelInfo *gpu_getClipKernels(size_t *nofKernels);
+
+/**
+ * @brief This function returns the fastest clip kernel that is supported by
+ * CPU.
+ *
+ * @return clip kernel
+ */
+const GPUClipKernelInfo *gpu_getClipKernel(void);
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -55,16 +55,119 @@
 #define PIXEL_CENTER .5f
 
 /**
- * @brief This value represents maximal number of triangles that can be created
- * by clipping of single input triangle.
- * This value is overestimated.
+ * @brief maximal number of user clip planes
  */
-#define MAX_CLIPPED_TRIANGLES 64
+#define MAX_USER_CLIP_PLANES 8
+
+/**
+ * @brief maximal number of planes that clip one triangle (frustum planes and
+ * user clip planes)
+ */
+#define MAX_CLIP_PLANES (6 + MAX_USER_CLIP_PLANES)
+
+/**
+ * @brief maximal number of vertices of clipped triangle, every clip plane
+ * adds at most one vertex to convex polygon
+ */
+#define MAX_CLIP_POLYGON_VERTICES (VERTICES_PER_TRIANGLE + MAX_CLIP_PLANES)
+
+/**
+ * @brief width and height of screen tile in pixels that is used for binning of
+ * triangles in tiled rasterization
+ */
+#define TILE_SIZE 64
+
+/**
+ * @brief number of unique vertices that are shaded by one task of parallel
+ * vertex shading (multiple of VERTEX_SHADER_BATCH_SIZE)
+ */
+#define VERTEX_SHADING_TASK_SIZE 256
+
+/**
+ * @brief width and height of tiles of hierarchical depth buffer in pixels
+ */
+#define HIZ_FINE_TILE_SIZE 8
+#define HIZ_COARSE_TILE_SIZE 64 ///<@copydoc HIZ_FINE_TILE_SIZE
+
+/**
+ * @brief This macro checks condition during compilation.
+ */
+#ifdef __cplusplus
+#define GPU_STATIC_ASSERT(condition, message) static_assert(condition, message)
+#elif defined(__GNUC__)
+#define GPU_STATIC_ASSERT(condition, message) \
+	__extension__ _Static_assert(condition, message)
+#else
+#define GPU_STATIC_ASSERT(condition, message) _Static_assert(condition, message)
+#endif
+
+// workers of tiled rasterization update coarse hierarchical depth tiles
+// without locking, so every coarse tile has to lie in one screen tile
+GPU_STATIC_ASSERT(
+	TILE_SIZE % HIZ_COARSE_TILE_SIZE == 0,
+	"TILE_SIZE has to be multiple of HIZ_COARSE_TILE_SIZE"
+);
+
+/**
+ * @brief number of sub-pixel bits of fixed-point screen-space coords
+ */
+#define SUBPIXEL_BITS 8
+
+/**
+ * @brief This value represents maximal absolute value of screen-space coord
+ * (in pixels) of triangle vertex that can be rasterized in fixed-point.
+ * Edge functions of such triangles fit into 64-bit integers, triangles with
+ * larger coords are rasterized in floating point.
+ */
+#define FIXED_POINT_MAX_COORD 1048576.f
+
+/**
+ * @brief half-size of guard band in normalized device coords.
+ * Triangles that cross x/y frustum planes only inside of guard band are
+ * clipped by rasterization bounds instead of geometric clipping, their screen
+ * coords stay in range of FIXED_POINT_MAX_COORD for viewports up to 16384
+ * pixels.
+ */
+#define GUARD_BAND_SIZE 64.f
+
+/**
+ * @brief width and height of fragment quad in pixels
+ */
+#define QUAD_SIZE 2
+
+/**
+ * @brief number of fragments per fragment quad
+ */
+#define FRAGMENTS_PER_QUAD (QUAD_SIZE * QUAD_SIZE)
+
+/**
+ * @brief coverage masks of fragment quad lanes, lane i lies in column
+ * i % QUAD_SIZE and row i / QUAD_SIZE of quad
+ */
+#define QUAD_LEFT_COLUMN_MASK 0x5u
+#define QUAD_RIGHT_COLUMN_MASK 0xAu ///<@copydoc QUAD_LEFT_COLUMN_MASK
+#define QUAD_BOTTOM_ROW_MASK 0x3u ///<@copydoc QUAD_LEFT_COLUMN_MASK
+#define QUAD_TOP_ROW_MASK 0xCu ///<@copydoc QUAD_LEFT_COLUMN_MASK
+#define QUAD_FULL_MASK 0xFu ///<@copydoc QUAD_LEFT_COLUMN_MASK
 
 
 struct GPUPrimitive;                  // forward declaration
 struct GPUTriangle;                   // forward declaration
-struct GPUTriangleList;               // forward declaration
+struct GPUClipPolygon;                // forward declaration
+struct GPUVertexFetch;                // forward declaration
+struct GPUVertexCache;                // forward declaration
+struct GPUPrimitiveAssembler;         // forward declaration
+struct DrawTrianglesCommand;          // forward declaration
+struct GPUAttributePlane;             // forward declaration
+struct GPUTriangleSetup;              // forward declaration
+struct GPUTriangleSetupList;          // forward declaration
+struct GPUTileBins;                   // forward declaration
+struct GPUFragmentQuad;               // forward declaration
+struct GPURasterizationKernelInfo;    // forward declaration
+struct GPUClipBatch;                  // forward declaration
+struct GPUClipKernelInfo;             // forward declaration
+struct GPURasterizationState;         // forward declaration
+struct PipelineStatistics;            // forward declaration
 struct Vec2;                          // forward declaration
 struct Vec3;                          // forward declaration
 struct Vec4;                          // forward declaration
@@ -72,6 +175,8 @@ struct Mat4;                          // forward declaration
 struct GPUVertexPullerConfiguration;  // forward declaration
 struct GPUVertexShaderOutput;         // forward declaration
 struct GPUVertexShaderInput;          // forward declaration
+struct GPUVertexShaderOutputBatch;    // forward declaration
+struct GPUVertexShaderInputBatch;     // forward declaration
 struct GPUFragmentShaderOutput;       // forward declaration
 struct GPUFragmentShaderInput;        // forward declaration
 struct GPUFragmentAttributes;         // forward declaration
@@ -82,7 +187,21 @@ struct GPUVertexPullerOutput;         // forward declaration
 
 typedef struct GPUPrimitive GPUPrimitive;                       ///< shortcut
 typedef struct GPUTriangle GPUTriangle;                         ///< shortcut
-typedef struct GPUTriangleList GPUTriangleList;                 ///< shortcut
+typedef struct GPUClipPolygon GPUClipPolygon;                   ///< shortcut
+typedef struct GPUVertexFetch GPUVertexFetch;                   ///< shortcut
+typedef struct GPUVertexCache GPUVertexCache;                   ///< shortcut
+typedef struct GPUPrimitiveAssembler GPUPrimitiveAssembler;     ///< shortcut
+typedef struct DrawTrianglesCommand DrawTrianglesCommand;       ///< shortcut
+typedef struct GPUAttributePlane GPUAttributePlane;             ///< shortcut
+typedef struct GPUTriangleSetup GPUTriangleSetup;               ///< shortcut
+typedef struct GPUTriangleSetupList GPUTriangleSetupList;       ///< shortcut
+typedef struct GPUTileBins GPUTileBins;                         ///< shortcut
+typedef struct GPUFragmentQuad GPUFragmentQuad;                 ///< shortcut
+typedef struct GPURasterizationKernelInfo GPURasterizationKernelInfo; ///< shortcut
+typedef struct GPUClipBatch GPUClipBatch;                       ///< shortcut
+typedef struct GPUClipKernelInfo GPUClipKernelInfo;             ///< shortcut
+typedef struct GPURasterizationState GPURasterizationState;     ///< shortcut
+typedef struct PipelineStatistics PipelineStatistics;           ///< shortcut
 typedef struct Vec2 Vec2;                                       ///< shortcut
 typedef struct Vec3 Vec3;                                       ///< shortcut
 typedef struct Vec4 Vec4;                                       ///< shortcut
@@ -91,6 +210,8 @@ typedef struct GPUVertexPullerConfiguration
 	GPUVertexPullerConfiguration;                               ///< shortcut
 typedef struct GPUVertexShaderInput GPUVertexShaderInput;       ///< shortcut
 typedef struct GPUVertexShaderOutput GPUVertexShaderOutput;     ///< shortcut
+typedef struct GPUVertexShaderInputBatch GPUVertexShaderInputBatch; ///< shortcut
+typedef struct GPUVertexShaderOutputBatch GPUVertexShaderOutputBatch; ///< shortcut
 typedef struct GPUFragmentShaderInput GPUFragmentShaderInput;   ///< shortcut
 typedef struct GPUFragmentShaderOutput GPUFragmentShaderOutput; ///< shortcut
 typedef struct GPUFragmentAttributes GPUFragmentAttributes;     ///< shortcut
@@ -161,6 +282,14 @@ typedef void (*VertexShader)(
 	GPUVertexShaderOutput *, const GPUVertexShaderInput *, GPU
 );
 
+/**
+ * @brief This type represents callback (function pointer) to batched vertex
+ * shader that processes several vertices in structure-of-arrays form.
+ */
+typedef void (*BatchedVertexShader)(
+	GPUVertexShaderOutputBatch *, const GPUVertexShaderInputBatch *, GPU
+);
+
 /**
  * @brief This type represents callback (function pointer) to fragment shader.
  */
@@ -168,6 +297,15 @@ typedef void (*FragmentShader)(
 	GPUFragmentShaderOutput *, const GPUFragmentShaderInput *, GPU
 );
 
+/**
+ * @brief This type represents callback (function pointer) to one task that is
+ * executed by GPU worker threads.
+ *
+ * The first parameter is user data, the second one is index of task and the
+ * third one is index of thread that executes the task.
+ */
+typedef void (*GPUTask)(void *, size_t, size_t);
+
 /**
  * @brief A instance of this type represents handle to all vertex attributes of
  * input vertex of vertex shader.
@@ -23,6 +23,103 @@ extern "C" {
 #endif
 
 
+/**
+ * @brief This enum represents optional features of rendering pipeline that can
+ * be enabled or disabled.
+ * All capabilities are disabled by default.
+ */
+typedef enum Capability
+{
+	///< triangles are binned into screen tiles and tiles are rasterized in
+	///  parallel by GPU worker threads
+	TILED_RASTERIZATION,
+	///< vertices are snapped to sub-pixel grid and coverage is evaluated with
+	///  integer edge functions (watertight and deterministic)
+	FIXED_POINT_RASTERIZATION,
+	///< triangles and fragment blocks that lie behind hierarchical depth
+	///  buffer are rejected before fragments are created
+	HIERARCHICAL_DEPTH_TEST,
+	///< index equal to primitive restart index ends current strip or fan
+	///  of indexed draw call
+	PRIMITIVE_RESTART,
+	///< all unique vertices of draw call are shaded by GPU worker threads
+	///  before triangles are assembled
+	PARALLEL_VERTEX_SHADING,
+	///< draw calls whose bounding box of active vertex puller lies outside of
+	///  view frustum are skipped before any vertex is pulled
+	BOUNDING_VOLUME_CULLING,
+	///< user clip plane i is enabled by CLIP_PLANE0 + i, triangles are clipped
+	///  by it (see cpu_setClipPlane())
+	CLIP_PLANE0,
+	CLIP_PLANE1, ///< @copydoc CLIP_PLANE0
+	CLIP_PLANE2, ///< @copydoc CLIP_PLANE0
+	CLIP_PLANE3, ///< @copydoc CLIP_PLANE0
+	CLIP_PLANE4, ///< @copydoc CLIP_PLANE0
+	CLIP_PLANE5, ///< @copydoc CLIP_PLANE0
+	CLIP_PLANE6, ///< @copydoc CLIP_PLANE0
+	CLIP_PLANE7, ///< @copydoc CLIP_PLANE0
+} Capability;
+
+/**
+ * @brief This enum represents which faces of triangles are culled.
+ */
+typedef enum CullFaceMode
+{
+	CULL_NONE,  ///< no triangles are culled
+	CULL_BACK,  ///< back-facing triangles are culled
+	CULL_FRONT, ///< front-facing triangles are culled
+} CullFaceMode;
+
+/**
+ * @brief This enum represents winding of front-facing triangles in screen
+ * space (y axis goes up).
+ */
+typedef enum FrontFace
+{
+	FRONT_FACE_CCW, ///< counter-clockwise triangles are front-facing
+	FRONT_FACE_CW,  ///< clockwise triangles are front-facing
+} FrontFace;
+
+/**
+ * @brief This enum represents how vertices of draw call form triangles.
+ */
+typedef enum PrimitiveTopology
+{
+	///< vertices 3i, 3i+1, 3i+2 form triangle i
+	TOPOLOGY_TRIANGLES,
+	///< vertices i, i+1, i+2 form triangle i, winding of odd triangles is
+	///  flipped (i+1, i, i+2)
+	TOPOLOGY_TRIANGLE_STRIP,
+	///< vertices 0, i+1, i+2 form triangle i
+	TOPOLOGY_TRIANGLE_FAN,
+} PrimitiveTopology;
+
+/**
+ * @brief This struct contains counters of rendering pipeline.
+ * Counters are accumulated over all draw calls until they are reset.
+ */
+struct PipelineStatistics
+{
+	size_t nofDrawCalls; ///< number of draw calls
+	size_t nofVertexShaderInvocations; ///< number of vertex shader invocations
+	///< number of vertices found in post-transform vertex cache, hit rate is
+	///< hits / (hits + invocations)
+	size_t nofVertexCacheHits;
+	size_t nofAssembledTriangles; ///< number of assembled triangles
+	size_t nofClippedTriangles; ///< number of triangles after clipping
+	size_t nofCulledTriangles; ///< number of triangles removed by face culling
+	size_t nofDegenerateTriangles; ///< number of rejected zero-area triangles
+	///< number of rejected triangles whose bounding box contains no sample
+	size_t nofEmptyTriangles;
+	///< number of triangles that were tested by sub-pixel fast path
+	size_t nofSubPixelTriangles;
+	///< number of sub-pixel triangles rejected because they miss their sample
+	size_t nofSubPixelRejectedTriangles;
+	///< number of draw calls skipped by bounding volume culling
+	size_t nofCulledDrawCalls;
+};
+
+
 /**
  * @brief This function creates GPU handle.
  *
@@ -135,6 +232,270 @@ void gpu_setDepth(GPU gpu, size_t x, size_t y, float depth);
  */
 void gpu_setColor(GPU gpu, size_t x, size_t y, const Vec4 *color);
 
+/**
+ * @brief This function returns depth buffer on GPU.
+ * Depth of pixel [x,y] is stored at index y * width + x.
+ * Depths written through this pointer have to be followed by
+ * gpu_updateHierarchicalDepth().
+ *
+ * @param gpu GPU handle
+ *
+ * @return pointer to the first pixel of depth buffer
+ */
+float *gpu_getDepthBuffer(GPU gpu);
+
+/**
+ * @brief This function returns color buffer on GPU.
+ * Color of pixel [x,y] is stored at index y * width + x.
+ *
+ * @param gpu GPU handle
+ *
+ * @return pointer to the first pixel of color buffer
+ */
+Vec4 *gpu_getColorBuffer(GPU gpu);
+
+/**
+ * @brief This function returns level of hierarchical depth buffer.
+ * Level contains maximal depth of every tileSize x tileSize tile of depth
+ * buffer, depth of tile [x,y] is stored at index
+ * y * ceil(width / tileSize) + x. Stored depths are conservative, they are
+ * never lower than depths in depth buffer.
+ *
+ * @param gpu GPU handle
+ * @param tileSize HIZ_FINE_TILE_SIZE or HIZ_COARSE_TILE_SIZE
+ *
+ * @return maximal depths of tiles
+ */
+const float *gpu_getHierarchicalDepth(GPU gpu, size_t tileSize);
+
+/**
+ * @brief This function recomputes maximal depths of all tiles of hierarchical
+ * depth buffer that overlap screen region [xMin,xMax) x [yMin,yMax).
+ *
+ * @param gpu GPU handle
+ * @param xMin first pixel column of region
+ * @param yMin first pixel row of region
+ * @param xMax pixel column after region
+ * @param yMax pixel row after region
+ */
+void gpu_updateHierarchicalDepth(
+	GPU gpu, size_t xMin, size_t yMin, size_t xMax, size_t yMax
+);
+
+/**
+ * @brief This function enables capability of rendering pipeline.
+ *
+ * Its alternative function in OpenGL is
+ * <a href="https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glEnable.xhtml">
+ * glEnable
+ * </a>.
+ *
+ * @param gpu GPU handle
+ * @param capability capability that will be enabled
+ */
+void cpu_enable(GPU gpu, Capability capability);
+
+/**
+ * @brief This function disables capability of rendering pipeline.
+ *
+ * @param gpu GPU handle
+ * @param capability capability that will be disabled
+ */
+void cpu_disable(GPU gpu, Capability capability);
+
+/**
+ * @brief This function returns whether capability is enabled.
+ *
+ * @param gpu GPU handle
+ * @param capability capability
+ *
+ * @return 1 if capability is enabled, otherwise 0
+ */
+int gpu_isEnabled(GPU gpu, Capability capability);
+
+/**
+ * @brief This function sets which faces of triangles are culled.
+ * Default mode is CULL_BACK.
+ *
+ * @param gpu GPU handle
+ * @param mode cull face mode
+ */
+void cpu_setCullFace(GPU gpu, CullFaceMode mode);
+
+/**
+ * @brief This function sets winding of front-facing triangles.
+ * Default winding is FRONT_FACE_CCW.
+ *
+ * @param gpu GPU handle
+ * @param frontFace winding of front-facing triangles
+ */
+void cpu_setFrontFace(GPU gpu, FrontFace frontFace);
+
+/**
+ * @brief This function returns cull face mode.
+ *
+ * @param gpu GPU handle
+ *
+ * @return cull face mode
+ */
+CullFaceMode gpu_getCullFace(GPU gpu);
+
+/**
+ * @brief This function returns winding of front-facing triangles.
+ *
+ * @param gpu GPU handle
+ *
+ * @return winding of front-facing triangles
+ */
+FrontFace gpu_getFrontFace(GPU gpu);
+
+/**
+ * @brief This function sets how vertices of draw calls form triangles.
+ * Default topology is TOPOLOGY_TRIANGLES.
+ *
+ * @param gpu GPU handle
+ * @param topology primitive topology
+ */
+void cpu_setPrimitiveTopology(GPU gpu, PrimitiveTopology topology);
+
+/**
+ * @brief This function sets primitive restart index.
+ * If PRIMITIVE_RESTART is enabled, index (read with declared width) equal to
+ * restart index is not drawn and the next index starts new primitive.
+ * Default restart index is 0.
+ *
+ * Its alternative function in OpenGL is
+ * <a href="https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glPrimitiveRestartIndex.xhtml">
+ * glPrimitiveRestartIndex
+ * </a>.
+ *
+ * @param gpu GPU handle
+ * @param index primitive restart index
+ */
+void cpu_setPrimitiveRestartIndex(GPU gpu, VertexIndex index);
+
+/**
+ * @brief This function returns primitive topology.
+ *
+ * @param gpu GPU handle
+ *
+ * @return primitive topology
+ */
+PrimitiveTopology gpu_getPrimitiveTopology(GPU gpu);
+
+/**
+ * @brief This function returns primitive restart index.
+ *
+ * @param gpu GPU handle
+ *
+ * @return primitive restart index
+ */
+VertexIndex gpu_getPrimitiveRestartIndex(GPU gpu);
+
+/**
+ * @brief This function sets matrix that transforms bounding boxes of vertex
+ * pullers into clip-space (usually projection * view * model matrix of the
+ * next draw calls). It is used if BOUNDING_VOLUME_CULLING is enabled.
+ * Default matrix is identity.
+ *
+ * @param gpu GPU handle
+ * @param matrix culling matrix
+ */
+void cpu_setCullingMatrix(GPU gpu, const Mat4 *matrix);
+
+/**
+ * @brief This function returns matrix that transforms bounding boxes of vertex
+ * pullers into clip-space.
+ *
+ * @param gpu GPU handle
+ *
+ * @return culling matrix
+ */
+const Mat4 *gpu_getCullingMatrix(GPU gpu);
+
+/**
+ * @brief This function sets user clip plane in clip-space.
+ * Point P is kept if dot(plane, P) >= 0, plane is used if capability
+ * CLIP_PLANE0 + index is enabled.
+ * World-space plane is transformed into clip-space by
+ * transpose(inverse(projection * view)).
+ *
+ * Its alternative in OpenGL is gl_ClipDistance written by vertex shader.
+ *
+ * @param gpu GPU handle
+ * @param index index of plane (lower than MAX_USER_CLIP_PLANES)
+ * @param plane plane coefficients
+ */
+void cpu_setClipPlane(GPU gpu, size_t index, const Vec4 *plane);
+
+/**
+ * @brief This function returns enabled user clip planes.
+ *
+ * @param gpu GPU handle
+ * @param planes output enabled planes in order of their indices
+ *
+ * @return number of enabled planes
+ */
+size_t gpu_getClipPlanes(GPU gpu, Vec4 planes[MAX_USER_CLIP_PLANES]);
+
+/**
+ * @brief This function returns pipeline statistics accumulated since
+ * the last reset.
+ *
+ * @param gpu GPU handle
+ *
+ * @return pipeline statistics
+ */
+const PipelineStatistics *cpu_getPipelineStatistics(GPU gpu);
+
+/**
+ * @brief This function resets all pipeline statistics to zero.
+ *
+ * @param gpu GPU handle
+ */
+void cpu_resetPipelineStatistics(GPU gpu);
+
+/**
+ * @brief This function adds counters of draw call to pipeline statistics.
+ *
+ * @param gpu GPU handle
+ * @param statistics counters of draw call
+ */
+void gpu_addPipelineStatistics(
+	GPU gpu, const PipelineStatistics *statistics
+);
+
+/**
+ * @brief This function sets number of threads that execute GPU tasks.
+ * Calling thread is counted as one of them.
+ *
+ * @param gpu GPU handle
+ * @param nofThreads number of threads, 0 selects number of hardware threads
+ */
+void cpu_setNofThreads(GPU gpu, size_t nofThreads);
+
+/**
+ * @brief This function returns number of threads that execute GPU tasks.
+ *
+ * @param gpu GPU handle
+ *
+ * @return number of threads
+ */
+size_t gpu_getNofThreads(GPU gpu);
+
+/**
+ * @brief This function executes tasks in parallel on GPU worker threads.
+ * Tasks are distributed dynamically, calling thread participates in execution
+ * and this function returns after all tasks are done.
+ * Index of thread passed to the task is lower than gpu_getNofThreads().
+ *
+ * @param gpu GPU handle
+ * @param nofTasks number of tasks
+ * @param task callback that executes one task
+ * @param data user data passed to every task
+ */
+void gpu_runTasks(GPU gpu, size_t nofTasks, GPUTask task, void *data);
+
 /**
  * @brief This function returns active vertex puller configuration.
  *
@@ -144,6 +505,27 @@ void gpu_setColor(GPU gpu, size_t x, size_t y, const Vec4 *color);
  */
 const GPUVertexPullerConfiguration *gpu_getActiveVertexPuller(GPU gpu);
 
+/**
+ * @brief This function returns number of indices that fit into index buffer
+ * of active vertex puller.
+ *
+ * @param gpu GPU handle
+ *
+ * @return number of indices, 0 if indexing is not used
+ */
+size_t gpu_getNofIndices(GPU gpu);
+
+/**
+ * @brief This function returns data of buffer.
+ *
+ * @param gpu GPU handle
+ * @param buffer buffer id
+ * @param size output size of buffer in bytes
+ *
+ * @return data of buffer, NULL if buffer does not exist
+ */
+const void *gpu_getBufferData(GPU gpu, BufferID buffer, size_t *size);
+
 /**
  * @brief This function returns active vertex shader.
  *
@@ -162,6 +544,85 @@ VertexShader gpu_getActiveVertexShader(GPU gpu);
  */
 FragmentShader gpu_getActiveFragmentShader(GPU gpu);
 
+/**
+ * @brief This function returns batched vertex shader of active program.
+ *
+ * @param gpu GPU handle
+ *
+ * @return batched vertex shader or NULL if program does not have any
+ */
+BatchedVertexShader gpu_getActiveBatchedVertexShader(GPU gpu);
+
+/**
+ * @brief This function returns type of input vertex attribute of batched
+ * vertex shader of active program.
+ *
+ * @param gpu GPU handle
+ * @param attribIndex attribute index
+ *
+ * @return type of attribute
+ */
+AttributeType gpu_getVertexShaderInputType(GPU gpu, size_t attribIndex);
+
+/**
+ * @brief This function validates addresses of input attributes of all
+ * vertices and instances of draw call at once.
+ *
+ * Attributes with declared input type (cpu_setVertexShaderInputType()) whose
+ * last vertex (or last instance for heads with divisor) lies inside of buffer
+ * are not validated again by vs_interpretInputVertexAttributeAs*() functions
+ * until gpu_invalidateVertexFetch() is called, see
+ * gpu_isAttributeFetchValidated().
+ *
+ * @param gpu GPU handle
+ * @param nofVertexIDs the highest fetched gl_VertexID + 1
+ * @param nofInstances number of instances of draw call
+ */
+void gpu_validateVertexFetch(
+	GPU gpu, size_t nofVertexIDs, size_t nofInstances
+);
+
+/**
+ * @brief This function ends validity of gpu_validateVertexFetch(), it is
+ * called at the end of draw call.
+ *
+ * @param gpu GPU handle
+ */
+void gpu_invalidateVertexFetch(GPU gpu);
+
+/**
+ * @brief This function returns whether input attribute of all vertices of
+ * draw call was validated by gpu_validateVertexFetch(), so it can be read
+ * without further checks.
+ *
+ * @param gpu GPU handle
+ * @param attribIndex attribute index
+ * @param size number of bytes that are read from every vertex
+ *
+ * @return 1 if attribute is validated, otherwise 0
+ */
+int gpu_isAttributeFetchValidated(GPU gpu, size_t attribIndex, size_t size);
+
+/**
+ * @brief This function returns whether depth test of active program is
+ * performed before fragment shader.
+ *
+ * @param gpu GPU handle
+ *
+ * @return 1 for early depth test, 0 for late depth test
+ */
+int gpu_isEarlyDepthTestActive(GPU gpu);
+
+/**
+ * @brief This function returns declared effects of fragment shader of active
+ * program.
+ *
+ * @param gpu GPU handle
+ *
+ * @return combination of FragmentShaderEffect flags
+ */
+unsigned gpu_getFragmentShaderEffects(GPU gpu);
+
 /**
  * @brief This functions returns interpolation type of vertex attributes of
  * output vertex of active program.
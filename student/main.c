@@ -8,6 +8,7 @@
 
 
 #include <SDL2/SDL.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -16,6 +17,8 @@
 #include <examples/triangleExample.h>
 #include <student/mouseCamera.h>
 #include <student/student_cpu.h>
+#include <student/bunny.h>
+#include <student/meshOptimizer.h>
 #include <tests/conformanceTests.h>
 #include <tests/performanceTest.h>
 
@@ -61,6 +64,19 @@ int main(int argc, char *argv[])
 		return EXIT_SUCCESS;
 	}
 
+	// print vertex cache statistics of optimized bunny
+	if (argc > 1 && strcmp(argv[1], "-m") == 0)
+	{
+		cpu_printMeshOptimizationReport(
+			stdout, "bunny", bunnyVertices, sizeof(bunnyVertices[0]),
+			offsetof(BunnyVertex, position),
+			sizeof(bunnyVertices) / sizeof(bunnyVertices[0]), bunnyIndices,
+			sizeof(bunnyIndices[0][0]),
+			sizeof(bunnyIndices) / sizeof(bunnyIndices[0][0])
+		);
+		return EXIT_SUCCESS;
+	}
+
 
 	// enable logging
 	SDL_LogSetPriority(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO);
@@ -0,0 +1,729 @@
+/**
+ * @file
+ * @brief This file contains implementation of mesh optimization functions.
+ *
+ * @author Dominik Harmim <harmim6@gmail.com>
+ */
+
+
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <student/meshOptimizer.h>
+#include <student/student_pipeline.h>
+#include <student/linearAlgebra.h>
+
+
+/**
+ * @brief This function allocates memory and terminates application if there
+ * is not enough memory.
+ *
+ * @param size size of allocated memory in bytes
+ *
+ * @return pointer to allocated memory
+ */
+static void *cpu_allocateMeshMemory(const size_t size)
+{
+	void *const result = malloc(size == 0 ? 1 : size);
+	if (result == NULL)
+	{
+		fprintf(stderr, "ERROR: cpu_allocateMeshMemory(%zu) failed\n", size);
+		exit(1);
+	}
+	return result;
+}
+
+
+/**
+ * @brief This function reads all indices of triangle list.
+ *
+ * @param indices indices of triangle list
+ * @param indexSize size of one index in bytes (1, 2 or 4)
+ * @param nofIndices number of indices
+ *
+ * @return allocated indices, they have to be freed by caller
+ */
+static VertexIndex *cpu_readIndices(
+	const void *const indices, const size_t indexSize, const size_t nofIndices
+)
+{
+	assert(indices != NULL || nofIndices == 0);
+
+	VertexIndex *const result = (VertexIndex *)
+		cpu_allocateMeshMemory(nofIndices * sizeof(VertexIndex));
+	for (size_t i = 0; i < nofIndices; ++i)
+	{ result[i] = gpu_computeGLVertexID(indices, indexSize, i); }
+
+	return result;
+}
+
+
+/**
+ * @brief This function writes index with given width.
+ *
+ * @param indices indices of triangle list
+ * @param indexSize size of one index in bytes (1, 2 or 4)
+ * @param i position of written index
+ * @param index written index
+ */
+static void cpu_writeIndex(
+	void *const indices, const size_t indexSize, const size_t i,
+	const VertexIndex index
+)
+{
+	assert(indices != NULL);
+
+	if (indexSize == sizeof(uint8_t))
+	{
+		assert(index <= UINT8_MAX);
+		((uint8_t *) indices)[i] = (uint8_t) index;
+	}
+	else if (indexSize == sizeof(uint16_t))
+	{
+		assert(index <= UINT16_MAX);
+		((uint16_t *) indices)[i] = (uint16_t) index;
+	}
+	else if (indexSize == sizeof(uint32_t))
+	{
+		assert(index <= UINT32_MAX);
+		((uint32_t *) indices)[i] = (uint32_t) index;
+	}
+	else
+	{
+		assert(indexSize == sizeof(VertexIndex));
+		((VertexIndex *) indices)[i] = index;
+	}
+}
+
+
+/**
+ * @brief This function simulates FIFO vertex cache access.
+ *
+ * @param timestamps cache timestamps of vertices
+ * @param timestamp current cache timestamp (number of misses + cacheSize + 1)
+ * @param cacheSize number of vertices in FIFO cache
+ * @param vertex accessed vertex
+ *
+ * @return 1 if access is miss, 0 otherwise
+ */
+static size_t cpu_accessVertexCache(
+	size_t *const timestamps, size_t *const timestamp, const size_t cacheSize,
+	const VertexIndex vertex
+)
+{
+	if (*timestamp - timestamps[vertex] <= cacheSize)
+	{ return 0; }
+
+	timestamps[vertex] = (*timestamp)++;
+	return 1;
+}
+
+
+/**
+ * @brief This function counts FIFO vertex cache misses of triangle list.
+ *
+ * @param indices indices of triangle list
+ * @param nofIndices number of indices
+ * @param nofVertices number of vertices, all indices have to be lower
+ * @param cacheSize number of vertices in FIFO cache
+ * @param triangleMisses optional output number of misses of each triangle
+ *
+ * @return number of cache misses
+ */
+static size_t cpu_countCacheMisses(
+	const VertexIndex *const indices, const size_t nofIndices,
+	const size_t nofVertices, const size_t cacheSize,
+	unsigned char *const triangleMisses
+)
+{
+	size_t *const timestamps =
+		(size_t *) cpu_allocateMeshMemory(nofVertices * sizeof(size_t));
+	memset(timestamps, 0, nofVertices * sizeof(size_t));
+	size_t timestamp = cacheSize + 1;
+
+	size_t misses = 0;
+	for (size_t i = 0; i < nofIndices; ++i)
+	{
+		assert(indices[i] < nofVertices);
+		const size_t miss =
+			cpu_accessVertexCache(timestamps, &timestamp, cacheSize, indices[i]);
+		misses += miss;
+		if (triangleMisses != NULL)
+		{
+			triangleMisses[i / 3] = (unsigned char)
+				((i % 3 == 0 ? 0 : triangleMisses[i / 3]) + miss);
+		}
+	}
+
+	free(timestamps);
+	return misses;
+}
+
+
+/**
+ * @brief This function returns number of vertices that are referenced by
+ * indices (maximal index + 1).
+ *
+ * @param indices indices of triangle list
+ * @param nofIndices number of indices
+ *
+ * @return number of vertices
+ */
+static size_t cpu_countVertices(
+	const VertexIndex *const indices, const size_t nofIndices
+)
+{
+	size_t nofVertices = 0;
+	for (size_t i = 0; i < nofIndices; ++i)
+	{
+		if (indices[i] >= nofVertices)
+		{ nofVertices = indices[i] + 1; }
+	}
+
+	return nofVertices;
+}
+
+
+float cpu_computeACMR(
+	const void *const indices, const size_t indexSize, const size_t nofIndices,
+	const size_t cacheSize
+)
+{
+	assert(nofIndices % 3 == 0);
+
+	if (nofIndices == 0)
+	{ return 0.f; }
+
+	VertexIndex *const vertexIndices =
+		cpu_readIndices(indices, indexSize, nofIndices);
+	const size_t misses = cpu_countCacheMisses(
+		vertexIndices, nofIndices, cpu_countVertices(vertexIndices, nofIndices),
+		cacheSize, NULL
+	);
+	free(vertexIndices);
+
+	return (float) misses / (float) (nofIndices / 3);
+}
+
+
+float cpu_computeATVR(
+	const void *const indices, const size_t indexSize, const size_t nofIndices,
+	const size_t nofVertices, const size_t cacheSize
+)
+{
+	assert(nofIndices % 3 == 0);
+
+	if (nofIndices == 0)
+	{ return 0.f; }
+
+	VertexIndex *const vertexIndices =
+		cpu_readIndices(indices, indexSize, nofIndices);
+	const size_t misses = cpu_countCacheMisses(
+		vertexIndices, nofIndices, nofVertices, cacheSize, NULL
+	);
+
+	// count unique vertices
+	unsigned char *const used = (unsigned char *) cpu_allocateMeshMemory(
+		nofVertices
+	);
+	memset(used, 0, nofVertices);
+	size_t nofUsedVertices = 0;
+	for (size_t i = 0; i < nofIndices; ++i)
+	{
+		nofUsedVertices += used[vertexIndices[i]] == 0;
+		used[vertexIndices[i]] = 1;
+	}
+	free(used);
+	free(vertexIndices);
+
+	return (float) misses / (float) nofUsedVertices;
+}
+
+
+/**
+ * @brief This function selects next fanning vertex of Tipsify.
+ *
+ * @param candidates vertices of triangles emitted by last fan
+ * @param nofCandidates number of candidates
+ * @param liveTriangles numbers of not emitted triangles of vertices
+ * @param timestamps cache timestamps of vertices
+ * @param timestamp current cache timestamp
+ * @param cacheSize number of vertices in FIFO cache
+ * @param deadEnd stack of recently used vertices
+ * @param nofDeadEnds number of vertices in stack
+ * @param cursor next vertex that is checked if stack is empty
+ * @param nofVertices number of vertices
+ *
+ * @return next fanning vertex, nofVertices if all triangles are emitted
+ */
+static VertexIndex cpu_selectFanningVertex(
+	const VertexIndex *const candidates, const size_t nofCandidates,
+	const size_t *const liveTriangles, const size_t *const timestamps,
+	const size_t timestamp, const size_t cacheSize,
+	const VertexIndex *const deadEnd, size_t *const nofDeadEnds,
+	VertexIndex *const cursor, const size_t nofVertices
+)
+{
+	// prefer vertex that stays in cache while its whole fan is emitted
+	VertexIndex best = nofVertices;
+	size_t bestPriority = 0;
+	for (size_t i = 0; i < nofCandidates; ++i)
+	{
+		const VertexIndex vertex = candidates[i];
+		if (liveTriangles[vertex] == 0)
+		{ continue; }
+
+		const size_t age = timestamp - timestamps[vertex];
+		const size_t priority =
+			age + 2 * liveTriangles[vertex] <= cacheSize ? age + 1 : 1;
+		if (priority > bestPriority)
+		{
+			best = vertex;
+			bestPriority = priority;
+		}
+	}
+	if (best != nofVertices)
+	{ return best; }
+
+	// dead end, continue with recently used vertex
+	while (*nofDeadEnds > 0)
+	{
+		const VertexIndex vertex = deadEnd[--(*nofDeadEnds)];
+		if (liveTriangles[vertex] > 0)
+		{ return vertex; }
+	}
+
+	// continue with next vertex in input order
+	while (*cursor < nofVertices)
+	{
+		if (liveTriangles[*cursor] > 0)
+		{ return (*cursor)++; }
+		++(*cursor);
+	}
+
+	return nofVertices;
+}
+
+
+void cpu_optimizeVertexCache(
+	void *const destination, const void *const indices, const size_t indexSize,
+	const size_t nofIndices, const size_t nofVertices, const size_t cacheSize
+)
+{
+	assert(destination != NULL || nofIndices == 0);
+	assert(nofIndices % 3 == 0);
+
+	const size_t nofTriangles = nofIndices / 3;
+	VertexIndex *const input = cpu_readIndices(indices, indexSize, nofIndices);
+
+	// build vertex-triangle adjacency
+	size_t *const liveTriangles =
+		(size_t *) cpu_allocateMeshMemory(nofVertices * sizeof(size_t));
+	size_t *const offsets =
+		(size_t *) cpu_allocateMeshMemory((nofVertices + 1) * sizeof(size_t));
+	size_t *const adjacency =
+		(size_t *) cpu_allocateMeshMemory(nofIndices * sizeof(size_t));
+	memset(liveTriangles, 0, nofVertices * sizeof(size_t));
+	for (size_t i = 0; i < nofIndices; ++i)
+	{
+		assert(input[i] < nofVertices);
+		++liveTriangles[input[i]];
+	}
+	offsets[0] = 0;
+	for (size_t v = 0; v < nofVertices; ++v)
+	{ offsets[v + 1] = offsets[v] + liveTriangles[v]; }
+	size_t *const fill =
+		(size_t *) cpu_allocateMeshMemory(nofVertices * sizeof(size_t));
+	memcpy(fill, offsets, nofVertices * sizeof(size_t));
+	for (size_t i = 0; i < nofIndices; ++i)
+	{ adjacency[fill[input[i]]++] = i / 3; }
+	free(fill);
+
+	size_t *const timestamps =
+		(size_t *) cpu_allocateMeshMemory(nofVertices * sizeof(size_t));
+	memset(timestamps, 0, nofVertices * sizeof(size_t));
+	size_t timestamp = cacheSize + 1;
+	unsigned char *const emitted =
+		(unsigned char *) cpu_allocateMeshMemory(nofTriangles);
+	memset(emitted, 0, nofTriangles);
+	VertexIndex *const deadEnd =
+		(VertexIndex *) cpu_allocateMeshMemory(nofIndices * sizeof(VertexIndex));
+	size_t nofDeadEnds = 0;
+	VertexIndex *const candidates =
+		(VertexIndex *) cpu_allocateMeshMemory(nofIndices * sizeof(VertexIndex));
+	VertexIndex cursor = 0;
+	size_t nofOutputIndices = 0;
+
+	while (cursor < nofVertices && liveTriangles[cursor] == 0)
+	{ ++cursor; }
+	VertexIndex fanningVertex = cursor;
+	while (fanningVertex != nofVertices)
+	{
+		// emit all remaining triangles around fanning vertex
+		size_t nofCandidates = 0;
+		for (
+			size_t a = offsets[fanningVertex];
+			a < offsets[fanningVertex + 1];
+			++a
+		)
+		{
+			const size_t triangle = adjacency[a];
+			if (emitted[triangle])
+			{ continue; }
+			emitted[triangle] = 1;
+
+			for (size_t c = 0; c < 3; ++c)
+			{
+				const VertexIndex vertex = input[triangle * 3 + c];
+				cpu_writeIndex(
+					destination, indexSize, nofOutputIndices++, vertex
+				);
+				deadEnd[nofDeadEnds++] = vertex;
+				candidates[nofCandidates++] = vertex;
+				--liveTriangles[vertex];
+				cpu_accessVertexCache(timestamps, &timestamp, cacheSize, vertex);
+			}
+		}
+
+		fanningVertex = cpu_selectFanningVertex(
+			candidates, nofCandidates, liveTriangles, timestamps, timestamp,
+			cacheSize, deadEnd, &nofDeadEnds, &cursor, nofVertices
+		);
+	}
+	assert(nofOutputIndices == nofIndices);
+
+	free(candidates);
+	free(deadEnd);
+	free(emitted);
+	free(timestamps);
+	free(adjacency);
+	free(offsets);
+	free(liveTriangles);
+	free(input);
+}
+
+
+/**
+ * @brief This structure describes cluster of triangles of overdraw
+ * optimization.
+ */
+typedef struct MeshCluster
+{
+	size_t first; ///<first triangle of cluster
+	size_t nofTriangles; ///<number of triangles of cluster
+	float sortKey; ///<clusters are drawn in descending order of sortKey
+} MeshCluster;
+
+
+/**
+ * @brief This function compares clusters by descending sort key, ties keep
+ * input order.
+ *
+ * @param a first cluster
+ * @param b second cluster
+ *
+ * @return negative if a is drawn before b
+ */
+static int cpu_compareClusters(const void *const a, const void *const b)
+{
+	const MeshCluster *const clusterA = (const MeshCluster *) a;
+	const MeshCluster *const clusterB = (const MeshCluster *) b;
+
+	if (clusterA->sortKey != clusterB->sortKey)
+	{ return clusterA->sortKey > clusterB->sortKey ? -1 : 1; }
+
+	return clusterA->first < clusterB->first ? -1 : 1;
+}
+
+
+/**
+ * @brief This function computes area weighted normal (cross product of
+ * edges) and centroid of triangle.
+ *
+ * @param normal output area weighted normal
+ * @param centroid output centroid
+ * @param indices indices of triangle
+ * @param positions pointer to position of the first vertex
+ * @param positionStride distance between positions in bytes
+ */
+static void cpu_computeTriangleGeometry(
+	Vec3 *const normal, Vec3 *const centroid, const VertexIndex *const indices,
+	const float *const positions, const size_t positionStride
+)
+{
+	const float *p[3];
+	for (size_t c = 0; c < 3; ++c)
+	{
+		p[c] = (const float *)
+			((const uint8_t *) positions + indices[c] * positionStride);
+	}
+
+	Vec3 a, b;
+	init_Vec3(&a, p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2]);
+	init_Vec3(&b, p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2]);
+	init_Vec3(
+		normal, a.data[1] * b.data[2] - a.data[2] * b.data[1],
+		a.data[2] * b.data[0] - a.data[0] * b.data[2],
+		a.data[0] * b.data[1] - a.data[1] * b.data[0]
+	);
+	init_Vec3(
+		centroid, (p[0][0] + p[1][0] + p[2][0]) / 3.f,
+		(p[0][1] + p[1][1] + p[2][1]) / 3.f,
+		(p[0][2] + p[1][2] + p[2][2]) / 3.f
+	);
+}
+
+
+void cpu_optimizeOverdraw(
+	void *const destination, const void *const indices, const size_t indexSize,
+	const size_t nofIndices, const float *const positions,
+	const size_t positionStride, const size_t nofVertices,
+	const size_t cacheSize, const float threshold
+)
+{
+	assert(destination != NULL || nofIndices == 0);
+	assert(positions != NULL || nofIndices == 0);
+	assert(nofIndices % 3 == 0);
+	assert(threshold >= 1.f);
+
+	const size_t nofTriangles = nofIndices / 3;
+	if (nofTriangles == 0)
+	{ return; }
+	VertexIndex *const input = cpu_readIndices(indices, indexSize, nofIndices);
+
+	// hard boundaries are triangles with all vertices missing in cache
+	unsigned char *const triangleMisses =
+		(unsigned char *) cpu_allocateMeshMemory(nofTriangles);
+	cpu_countCacheMisses(
+		input, nofIndices, nofVertices, cacheSize, triangleMisses
+	);
+
+	// soft boundaries split hard clusters where ACMR of split part with cold
+	// cache drops under threshold * ACMR of whole hard cluster
+	MeshCluster *const clusters = (MeshCluster *)
+		cpu_allocateMeshMemory(nofTriangles * sizeof(MeshCluster));
+	size_t nofClusters = 0;
+	size_t *const timestamps =
+		(size_t *) cpu_allocateMeshMemory(nofVertices * sizeof(size_t));
+	memset(timestamps, 0, nofVertices * sizeof(size_t));
+	size_t timestamp = cacheSize + 1;
+	for (size_t first = 0, last; first < nofTriangles; first = last)
+	{
+		for (last = first + 1; last < nofTriangles; ++last)
+		{
+			if (triangleMisses[last] == 3)
+			{ break; }
+		}
+
+		// skipping cacheSize timestamps flushes cache
+		timestamp += cacheSize + 1;
+		size_t hardMisses = 0;
+		for (size_t i = first * 3; i < last * 3; ++i)
+		{
+			hardMisses += cpu_accessVertexCache(
+				timestamps, &timestamp, cacheSize, input[i]
+			);
+		}
+		const float target =
+			threshold * (float) hardMisses / (float) (last - first);
+
+		timestamp += cacheSize + 1;
+		size_t clusterMisses = 0;
+		for (size_t t = first; t < last; ++t)
+		{
+			if (t == first || clusterMisses == 0)
+			{
+				clusters[nofClusters].first = t;
+				clusters[nofClusters].nofTriangles = 0;
+				clusters[nofClusters].sortKey = 0.f;
+				++nofClusters;
+			}
+			MeshCluster *const cluster = &clusters[nofClusters - 1];
+			++cluster->nofTriangles;
+			for (size_t c = 0; c < 3; ++c)
+			{
+				clusterMisses += cpu_accessVertexCache(
+					timestamps, &timestamp, cacheSize, input[t * 3 + c]
+				);
+			}
+
+			if (
+				(float) clusterMisses <= target * (float) cluster->nofTriangles
+			)
+			{
+				timestamp += cacheSize + 1;
+				clusterMisses = 0;
+			}
+		}
+	}
+	free(timestamps);
+	free(triangleMisses);
+
+	// mesh centroid
+	Vec3 meshCentroid;
+	init_Vec3(&meshCentroid, 0.f, 0.f, 0.f);
+	float meshArea = 0.f;
+	for (size_t t = 0; t < nofTriangles; ++t)
+	{
+		Vec3 normal, centroid;
+		cpu_computeTriangleGeometry(
+			&normal, &centroid, input + t * 3, positions, positionStride
+		);
+		const float area = length_Vec3(&normal);
+		multiply_Vec3_Float(&centroid, &centroid, area);
+		add_Vec3(&meshCentroid, &meshCentroid, &centroid);
+		meshArea += area;
+	}
+	if (meshArea > 0.f)
+	{ multiply_Vec3_Float(&meshCentroid, &meshCentroid, 1.f / meshArea); }
+
+	// clusters facing outwards of mesh centroid occlude the rest of mesh
+	for (size_t c = 0; c < nofClusters; ++c)
+	{
+		Vec3 clusterNormal, clusterCentroid;
+		init_Vec3(&clusterNormal, 0.f, 0.f, 0.f);
+		init_Vec3(&clusterCentroid, 0.f, 0.f, 0.f);
+		float clusterArea = 0.f;
+		for (size_t i = 0; i < clusters[c].nofTriangles; ++i)
+		{
+			Vec3 normal, centroid;
+			cpu_computeTriangleGeometry(
+				&normal, &centroid, input + (clusters[c].first + i) * 3,
+				positions, positionStride
+			);
+			const float area = length_Vec3(&normal);
+			multiply_Vec3_Float(&centroid, &centroid, area);
+			add_Vec3(&clusterCentroid, &clusterCentroid, &centroid);
+			add_Vec3(&clusterNormal, &clusterNormal, &normal);
+			clusterArea += area;
+		}
+		const float normalLength = length_Vec3(&clusterNormal);
+		if (clusterArea <= 0.f || normalLength <= 0.f)
+		{ continue; }
+
+		multiply_Vec3_Float(
+			&clusterCentroid, &clusterCentroid, 1.f / clusterArea
+		);
+		sub_Vec3(&clusterCentroid, &clusterCentroid, &meshCentroid);
+		clusters[c].sortKey =
+			dot_Vec3(&clusterCentroid, &clusterNormal) / normalLength;
+	}
+	qsort(clusters, nofClusters, sizeof(MeshCluster), cpu_compareClusters);
+
+	size_t nofOutputIndices = 0;
+	for (size_t c = 0; c < nofClusters; ++c)
+	{
+		for (size_t i = 0; i < clusters[c].nofTriangles * 3; ++i)
+		{
+			cpu_writeIndex(
+				destination, indexSize, nofOutputIndices++,
+				input[clusters[c].first * 3 + i]
+			);
+		}
+	}
+	assert(nofOutputIndices == nofIndices);
+
+	free(clusters);
+	free(input);
+}
+
+
+size_t cpu_optimizeVertexFetch(
+	void *const destination, const void *const vertices,
+	const size_t vertexSize, void *const indices, const size_t indexSize,
+	const size_t nofIndices, const size_t nofVertices
+)
+{
+	assert(destination != NULL || nofIndices == 0);
+	assert(vertices != NULL || nofIndices == 0);
+	assert(destination != vertices || nofIndices == 0);
+
+	VertexIndex *const input = cpu_readIndices(indices, indexSize, nofIndices);
+	VertexIndex *const remap = (VertexIndex *)
+		cpu_allocateMeshMemory(nofVertices * sizeof(VertexIndex));
+	for (size_t v = 0; v < nofVertices; ++v)
+	{ remap[v] = nofVertices; }
+
+	size_t nofUsedVertices = 0;
+	for (size_t i = 0; i < nofIndices; ++i)
+	{
+		const VertexIndex vertex = input[i];
+		assert(vertex < nofVertices);
+		if (remap[vertex] == nofVertices)
+		{
+			remap[vertex] = nofUsedVertices;
+			memcpy(
+				(uint8_t *) destination + nofUsedVertices * vertexSize,
+				(const uint8_t *) vertices + vertex * vertexSize, vertexSize
+			);
+			++nofUsedVertices;
+		}
+		cpu_writeIndex(indices, indexSize, i, remap[vertex]);
+	}
+
+	free(remap);
+	free(input);
+
+	return nofUsedVertices;
+}
+
+
+void cpu_printMeshOptimizationReport(
+	FILE *const stream, const char *const name, const void *const vertices,
+	const size_t vertexSize, const size_t positionOffset,
+	const size_t nofVertices, const void *const indices,
+	const size_t indexSize, const size_t nofIndices
+)
+{
+	assert(stream != NULL);
+	assert(name != NULL);
+
+	void *const optimizedIndices = cpu_allocateMeshMemory(nofIndices * indexSize);
+	void *const optimizedVertices =
+		cpu_allocateMeshMemory(nofVertices * vertexSize);
+	const float *const positions = (const float *)
+		((const uint8_t *) vertices + positionOffset);
+	const size_t cacheSize = MESH_OPTIMIZER_CACHE_SIZE;
+
+	cpu_optimizeVertexCache(
+		optimizedIndices, indices, indexSize, nofIndices, nofVertices, cacheSize
+	);
+	const float cacheACMR = cpu_computeACMR(
+		optimizedIndices, indexSize, nofIndices, cacheSize
+	);
+	cpu_optimizeOverdraw(
+		optimizedIndices, optimizedIndices, indexSize, nofIndices, positions,
+		vertexSize, nofVertices, cacheSize, MESH_OPTIMIZER_OVERDRAW_THRESHOLD
+	);
+	const size_t nofUsedVertices = cpu_optimizeVertexFetch(
+		optimizedVertices, vertices, vertexSize, optimizedIndices, indexSize,
+		nofIndices, nofVertices
+	);
+
+	fprintf(
+		stream,
+		"%s: %zu triangles, %zu vertices, FIFO cache of %zu vertices\n"
+		"  original:        ACMR %.3f, ATVR %.3f\n"
+		"  vertex cache:    ACMR %.3f\n"
+		"  + overdraw:      ACMR %.3f, ATVR %.3f\n",
+		name, nofIndices / 3, nofUsedVertices, cacheSize,
+		(double) cpu_computeACMR(indices, indexSize, nofIndices, cacheSize),
+		(double) cpu_computeATVR(
+			indices, indexSize, nofIndices, nofVertices, cacheSize
+		),
+		(double) cacheACMR,
+		(double) cpu_computeACMR(
+			optimizedIndices, indexSize, nofIndices, cacheSize
+		),
+		(double) cpu_computeATVR(
+			optimizedIndices, indexSize, nofIndices, nofUsedVertices, cacheSize
+		)
+	);
+
+	free(optimizedVertices);
+	free(optimizedIndices);
+}
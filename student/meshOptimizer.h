@@ -0,0 +1,156 @@
+/**
+ * @file
+ * @brief This file contains declarations of mesh optimization functions.
+ * They reorder indexed triangle lists before upload (cpu_bufferData) for
+ * post-transform vertex cache locality, reduced overdraw and sequential
+ * vertex fetch.
+ *
+ * @author Dominik Harmim <harmim6@gmail.com>
+ */
+
+
+#pragma once
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <student/fwd.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief size of FIFO post-transform vertex cache that is used by default
+ */
+#define MESH_OPTIMIZER_CACHE_SIZE 16
+
+/**
+ * @brief default ratio of ACMR that splits vertex cache clusters in overdraw
+ * optimization, 1 means that only hard boundaries are used
+ */
+#define MESH_OPTIMIZER_OVERDRAW_THRESHOLD 1.05f
+
+
+/**
+ * @brief This function computes average cache miss ratio (number of vertex
+ * shader invocations per triangle) of triangle list with FIFO vertex cache.
+ *
+ * @param indices indices of triangle list
+ * @param indexSize size of one index in bytes (1, 2 or 4)
+ * @param nofIndices number of indices (multiple of 3)
+ * @param cacheSize number of vertices in FIFO cache
+ *
+ * @return ACMR, 0 for empty triangle list
+ */
+float cpu_computeACMR(
+	const void *indices, size_t indexSize, size_t nofIndices, size_t cacheSize
+);
+
+/**
+ * @brief This function computes average transformed to vertex ratio (number
+ * of vertex shader invocations per unique vertex) of triangle list with FIFO
+ * vertex cache.
+ *
+ * @param indices indices of triangle list
+ * @param indexSize size of one index in bytes (1, 2 or 4)
+ * @param nofIndices number of indices (multiple of 3)
+ * @param nofVertices number of vertices, all indices have to be lower
+ * @param cacheSize number of vertices in FIFO cache
+ *
+ * @return ATVR, 0 for empty triangle list
+ */
+float cpu_computeATVR(
+	const void *indices, size_t indexSize, size_t nofIndices,
+	size_t nofVertices, size_t cacheSize
+);
+
+/**
+ * @brief This function reorders triangles for post-transform vertex cache
+ * locality (Tipsify). Triangles are emitted as fans around vertices that are
+ * still in cache, dead ends continue with the most recently used vertex that
+ * has remaining triangles.
+ *
+ * @param destination output indices, can be the same as indices
+ * @param indices indices of triangle list
+ * @param indexSize size of one index in bytes (1, 2 or 4)
+ * @param nofIndices number of indices (multiple of 3)
+ * @param nofVertices number of vertices, all indices have to be lower
+ * @param cacheSize number of vertices in FIFO cache
+ */
+void cpu_optimizeVertexCache(
+	void *destination, const void *indices, size_t indexSize,
+	size_t nofIndices, size_t nofVertices, size_t cacheSize
+);
+
+/**
+ * @brief This function reorders clusters of cache optimized triangle list to
+ * reduce overdraw. Clusters are split where FIFO cache has to transform whole
+ * triangle and where ACMR of cluster drops under threshold * ACMR of mesh.
+ * Clusters that face outwards of mesh centroid are drawn first, so they
+ * occlude the rest of mesh.
+ *
+ * @param destination output indices, can be the same as indices
+ * @param indices indices of cache optimized triangle list
+ * @param indexSize size of one index in bytes (1, 2 or 4)
+ * @param nofIndices number of indices (multiple of 3)
+ * @param positions pointer to position (3 floats) of the first vertex
+ * @param positionStride distance between positions in bytes
+ * @param nofVertices number of vertices, all indices have to be lower
+ * @param cacheSize number of vertices in FIFO cache
+ * @param threshold ACMR ratio that splits clusters (>= 1)
+ */
+void cpu_optimizeOverdraw(
+	void *destination, const void *indices, size_t indexSize,
+	size_t nofIndices, const float *positions, size_t positionStride,
+	size_t nofVertices, size_t cacheSize, float threshold
+);
+
+/**
+ * @brief This function remaps vertices to the order of their first use in
+ * triangle list, so vertex fetch reads vertex buffer sequentially.
+ * Unused vertices are dropped.
+ *
+ * @param destination output vertices (different from vertices)
+ * @param vertices input vertices
+ * @param vertexSize size of one vertex in bytes
+ * @param indices indices of triangle list, they are remapped in place
+ * @param indexSize size of one index in bytes (1, 2 or 4)
+ * @param nofIndices number of indices
+ * @param nofVertices number of input vertices, all indices have to be lower
+ *
+ * @return number of vertices written to destination
+ */
+size_t cpu_optimizeVertexFetch(
+	void *destination, const void *vertices, size_t vertexSize,
+	void *indices, size_t indexSize, size_t nofIndices, size_t nofVertices
+);
+
+/**
+ * @brief This function optimizes copy of triangle list (vertex cache,
+ * overdraw and vertex fetch order) and prints ACMR and ATVR before and after
+ * optimization.
+ *
+ * @param stream output stream
+ * @param name name of mesh
+ * @param vertices vertices of mesh, position (3 floats) is at positionOffset
+ * @param vertexSize size of one vertex in bytes
+ * @param positionOffset offset of position in vertex in bytes
+ * @param nofVertices number of vertices
+ * @param indices indices of triangle list
+ * @param indexSize size of one index in bytes (1, 2 or 4)
+ * @param nofIndices number of indices (multiple of 3)
+ */
+void cpu_printMeshOptimizationReport(
+	FILE *stream, const char *name, const void *vertices, size_t vertexSize,
+	size_t positionOffset, size_t nofVertices, const void *indices,
+	size_t indexSize, size_t nofIndices
+);
+
+
+#ifdef __cplusplus
+}
+#endif
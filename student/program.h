@@ -55,6 +55,35 @@ typedef enum InterpolationType
 	SMOOTH,         ///< linear interpolation with perspective correction
 } InterpolationType;
 
+/**
+ * @brief This enum represents when depth test is performed.
+ */
+typedef enum DepthTestMode
+{
+	///< early depth test is used if fragment shader neither writes depth nor
+	///  discards fragments, late depth test is used otherwise
+	DEPTH_TEST_AUTO,
+	DEPTH_TEST_EARLY, ///< depth test is performed before fragment shader
+	DEPTH_TEST_LATE,  ///< depth test is performed after fragment shader
+} DepthTestMode;
+
+/**
+ * @brief This enum represents effects of fragment shader on per-fragment
+ * operations, effects are combined as bit flags.
+ */
+typedef enum FragmentShaderEffect
+{
+	FRAGMENT_WRITES_DEPTH = 1u, ///< fragment shader modifies depth
+	FRAGMENT_DISCARDS = 2u,     ///< fragment shader can discard fragments
+} FragmentShaderEffect;
+
+
+/**
+ * @brief maximal number of vertices processed by one invocation of batched
+ * vertex shader
+ */
+#define VERTEX_SHADER_BATCH_SIZE 8
+
 
 /**
  * @brief This struct represents input interface of vertex shader.
@@ -63,6 +92,36 @@ struct GPUVertexShaderInput
 {
 	GPUVertexPullerOutput const *attributes; ///< read only attributes
 	VertexIndex gl_VertexID; ///< vertex id
+	VertexIndex gl_InstanceID; ///< instance id of instanced draw call
+};
+
+/**
+ * @brief This struct represents input interface of batched vertex shader.
+ * Attributes are in structure-of-arrays form, component c of attribute a of
+ * vertex v is attributes[a][c][v]. Only attributes with declared input type
+ * are filled.
+ */
+struct GPUVertexShaderInputBatch
+{
+	size_t nofVertices; ///< number of vertices in batch
+	VertexIndex gl_VertexID[VERTEX_SHADER_BATCH_SIZE]; ///< vertex ids
+	VertexIndex gl_InstanceID; ///< instance id of all vertices in batch
+	///< components of attributes of vertices
+	float attributes[MAX_ATTRIBUTES][MAX_NUMBER_OF_ATTRIBUTE_COMPONENTS]
+		[VERTEX_SHADER_BATCH_SIZE];
+};
+
+/**
+ * @brief This struct represents output interface of batched vertex shader.
+ * Outputs are in structure-of-arrays form like inputs.
+ */
+struct GPUVertexShaderOutputBatch
+{
+	///< components of positions of vertices in clip-space
+	float gl_Position[4][VERTEX_SHADER_BATCH_SIZE];
+	///< components of attributes of vertices
+	float attributes[MAX_ATTRIBUTES][MAX_NUMBER_OF_ATTRIBUTE_COMPONENTS]
+		[VERTEX_SHADER_BATCH_SIZE];
 };
 
 /**
@@ -93,6 +152,7 @@ struct GPUFragmentShaderOutput
 {
 	Vec4 color; ///< color of the fragment
 	float depth; ///< depth of the fragment
+	int discard; ///< fragment is discarded, it is initialized to 0
 };
 
 /**
@@ -315,6 +375,40 @@ void cpu_deleteProgram(GPU gpu, ProgramID program);
  */
 void cpu_attachVertexShader(GPU gpu, ProgramID program, VertexShader shader);
 
+/**
+ * @brief This function attachs batched vertex shader to program.
+ *
+ * Batched vertex shader is used instead of vertex shader when it is attached,
+ * it has to compute the same outputs. Types of its input attributes have to be
+ * declared by cpu_setVertexShaderInputType().
+ * This function does not exist in OpenGL.
+ *
+ * @param gpu GPU handler
+ * @param program id of program
+ * @param shader function pointer to batched vertex shader, NULL detaches it
+ */
+void cpu_attachBatchedVertexShader(
+	GPU gpu, ProgramID program, BatchedVertexShader shader
+);
+
+/**
+ * @brief This function declares type of input vertex attribute of batched
+ * vertex shader.
+ *
+ * Attributes with \link ATTRIB_EMPTY\endlink type (default) are not pulled
+ * into input batch.
+ * This function does not exist in OpenGL - shader source analysis does its work
+ * automatically.
+ *
+ * @param gpu GPU handler
+ * @param program id of program
+ * @param attribIndex index of attribute
+ * @param type type of attribute
+ */
+void cpu_setVertexShaderInputType(
+	GPU gpu, ProgramID program, AttribIndex attribIndex, AttributeType type
+);
+
 /**
  * @brief This function attachs fragment shader to program.
  *
@@ -367,6 +461,34 @@ void cpu_setAttributeInterpolation(
 	InterpolationType interpolation
 );
 
+/**
+ * @brief This function declares effects of fragment shader of program.
+ *
+ * Programs that write depth or discard fragments use late depth test in
+ * \link DEPTH_TEST_AUTO\endlink mode.
+ * This function does not exist in OpenGL - shader source analysis does its work
+ * automatically.
+ *
+ * @param gpu GPU handler
+ * @param program id of program
+ * @param effects combination of FragmentShaderEffect flags
+ */
+void cpu_setFragmentShaderEffects(
+	GPU gpu, ProgramID program, unsigned effects
+);
+
+/**
+ * @brief This function sets when depth test of fragments of program is
+ * performed.
+ *
+ * Default mode is \link DEPTH_TEST_AUTO\endlink.
+ *
+ * @param gpu GPU handler
+ * @param program id of program
+ * @param mode depth test mode
+ */
+void cpu_setDepthTestMode(GPU gpu, ProgramID program, DepthTestMode mode);
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,408 @@
+/**
+ * @file
+ * @brief This file contains implementation of rasterization kernels.
+ *
+ * @author Dominik Harmim <harmim6@gmail.com>
+ */
+
+
+#include <assert.h>
+
+#include <student/rasterizationKernel.h>
+#include <student/student_pipeline.h>
+
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+/**
+ * @brief SIMD kernels are compiled for x86 with target attributes, instruction
+ * set is selected at runtime, so the binary runs on CPUs without AVX2 too.
+ */
+#define KERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+
+/**
+ * @brief This function evaluates plane at point.
+ *
+ * @param plane plane (a,b,c)
+ * @param x x coord
+ * @param y y coord
+ *
+ * @return ax+by+c
+ */
+static inline float gpu_evaluatePlane(
+	const Vec3 *const plane, const float x, const float y
+)
+{
+	return plane->data[0] * x + plane->data[1] * y + plane->data[2];
+}
+
+
+/**
+ * @brief This function writes fragment coords and depth into covered lanes
+ * of quads.
+ *
+ * @param quads fragment quads
+ * @param nofQuads number of quads
+ * @param depths depths of lanes
+ */
+static void gpu_storeLaneFragments(
+	GPUFragmentQuad *const quads, const size_t nofQuads,
+	const float *const depths
+)
+{
+	for (size_t q = 0; q < nofQuads; ++q)
+	{
+		for (size_t lane = 0; lane < FRAGMENTS_PER_QUAD; ++lane)
+		{
+			if (!(quads[q].mask & (1u << lane)))
+			{ continue; }
+
+			GPUFragmentShaderInput *const input = quads[q].inputs + lane;
+			input->coords.data[0] =
+				(float) (quads[q].x + lane % QUAD_SIZE) + PIXEL_CENTER;
+			input->coords.data[1] =
+				(float) (quads[q].y + lane / QUAD_SIZE) + PIXEL_CENTER;
+			input->depth = depths[q * FRAGMENTS_PER_QUAD + lane];
+		}
+	}
+}
+
+
+/**
+ * @brief This function writes one interpolated attribute component into
+ * covered lanes of quads.
+ *
+ * @param quads fragment quads
+ * @param nofQuads number of quads
+ * @param values values of lanes
+ * @param attribute attribute index
+ * @param component component index
+ */
+static void gpu_storeLaneAttribute(
+	GPUFragmentQuad *const quads, const size_t nofQuads,
+	const float *const values, const size_t attribute, const size_t component
+)
+{
+	for (size_t q = 0; q < nofQuads; ++q)
+	{
+		for (size_t lane = 0; lane < FRAGMENTS_PER_QUAD; ++lane)
+		{
+			if (!(quads[q].mask & (1u << lane)))
+			{ continue; }
+			((float *) quads[q].inputs[lane].attributes.attributes[attribute])
+				[component] = values[q * FRAGMENTS_PER_QUAD + lane];
+		}
+	}
+}
+
+
+/**
+ * @brief This function is scalar rasterization kernel that processes one
+ * quad.
+ *
+ * @param quads fragment quad
+ * @param setup triangle setup
+ *
+ * @return coverage mask of quad
+ */
+static unsigned gpu_rasterizationKernelScalar(
+	GPUFragmentQuad *const quads, const GPUTriangleSetup *const setup
+)
+{
+	GPUFragmentQuad *const quad = quads;
+	const Vec3 *const edges = setup->edges;
+
+	float xs[FRAGMENTS_PER_QUAD];
+	float ys[FRAGMENTS_PER_QUAD];
+	for (size_t lane = 0; lane < FRAGMENTS_PER_QUAD; ++lane)
+	{
+		xs[lane] = (float) quad->x + PIXEL_CENTER + (float) (lane % QUAD_SIZE);
+		ys[lane] = (float) quad->y + PIXEL_CENTER + (float) (lane / QUAD_SIZE);
+		if (setup->fixedPoint)
+		{ continue; }
+		for (size_t edge = 0; edge < EDGES_PER_TRIANGLE; ++edge)
+		{
+			const float e = gpu_evaluatePlane(edges + edge, xs[lane], ys[lane]);
+			if (!(e > 0.f || (e == 0.f && setup->topLeft[edge])))
+			{ quad->mask &= ~(1u << lane); }
+		}
+	}
+	if (quad->mask == 0)
+	{ return 0; }
+
+	// depth is interpolated w, one reciprocal per lane
+	float depths[FRAGMENTS_PER_QUAD];
+	for (size_t lane = 0; lane < FRAGMENTS_PER_QUAD; ++lane)
+	{
+		depths[lane] = 1.f / gpu_evaluatePlane(
+			&setup->inverseDepthPlane, xs[lane], ys[lane]
+		);
+	}
+	gpu_storeLaneFragments(quad, 1, depths);
+
+	for (size_t p = 0; p < setup->nofAttributePlanes; ++p)
+	{
+		const GPUAttributePlane *const plane = setup->attributePlanes + p;
+		float values[FRAGMENTS_PER_QUAD];
+		for (size_t lane = 0; lane < FRAGMENTS_PER_QUAD; ++lane)
+		{
+			values[lane] = gpu_evaluatePlane(&plane->plane, xs[lane], ys[lane]);
+			if (plane->perspective)
+			{ values[lane] *= depths[lane]; }
+		}
+		gpu_storeLaneAttribute(
+			quad, 1, values, plane->attribute, plane->component
+		);
+	}
+
+	return quad->mask;
+}
+
+
+#ifdef KERNEL_X86
+/**
+ * @brief This function evaluates plane at 4 points.
+ *
+ * @param plane plane (a,b,c)
+ * @param x x coords
+ * @param y y coords
+ *
+ * @return ax+by+c
+ */
+__attribute__((target("sse2")))
+static inline __m128 gpu_evaluatePlaneSSE2(
+	const Vec3 *const plane, const __m128 x, const __m128 y
+)
+{
+	return _mm_add_ps(
+		_mm_add_ps(
+			_mm_mul_ps(_mm_set1_ps(plane->data[0]), x),
+			_mm_mul_ps(_mm_set1_ps(plane->data[1]), y)
+		),
+		_mm_set1_ps(plane->data[2])
+	);
+}
+
+
+/**
+ * @brief This function evaluates plane at 8 points.
+ *
+ * @param plane plane (a,b,c)
+ * @param x x coords
+ * @param y y coords
+ *
+ * @return ax+by+c
+ */
+__attribute__((target("avx2")))
+static inline __m256 gpu_evaluatePlaneAVX2(
+	const Vec3 *const plane, const __m256 x, const __m256 y
+)
+{
+	return _mm256_add_ps(
+		_mm256_add_ps(
+			_mm256_mul_ps(_mm256_set1_ps(plane->data[0]), x),
+			_mm256_mul_ps(_mm256_set1_ps(plane->data[1]), y)
+		),
+		_mm256_set1_ps(plane->data[2])
+	);
+}
+
+
+/**
+ * @brief This function is SSE2 rasterization kernel that processes one quad
+ * (4 lanes).
+ *
+ * @param quads fragment quad
+ * @param setup triangle setup
+ *
+ * @return coverage mask of quad
+ */
+__attribute__((target("sse2")))
+static unsigned gpu_rasterizationKernelSSE2(
+	GPUFragmentQuad *const quads, const GPUTriangleSetup *const setup
+)
+{
+	GPUFragmentQuad *const quad = quads;
+	const Vec3 *const edges = setup->edges;
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 x = _mm_add_ps(
+		_mm_set1_ps((float) quad->x + PIXEL_CENTER),
+		_mm_setr_ps(0.f, 1.f, 0.f, 1.f)
+	);
+	const __m128 y = _mm_add_ps(
+		_mm_set1_ps((float) quad->y + PIXEL_CENTER),
+		_mm_setr_ps(0.f, 0.f, 1.f, 1.f)
+	);
+
+	// lanes inside of region
+	const __m128i laneBits = _mm_setr_epi32(1, 2, 4, 8);
+	__m128 inside = _mm_castsi128_ps(_mm_cmpeq_epi32(
+		_mm_and_si128(_mm_set1_epi32((int) quad->mask), laneBits), laneBits
+	));
+
+	for (size_t edge = 0; edge < EDGES_PER_TRIANGLE && !setup->fixedPoint;
+		++edge)
+	{
+		const __m128 e = gpu_evaluatePlaneSSE2(edges + edge, x, y);
+		__m128 edgeInside = _mm_cmpgt_ps(e, zero);
+		if (setup->topLeft[edge])
+		{ edgeInside = _mm_or_ps(edgeInside, _mm_cmpeq_ps(e, zero)); }
+		inside = _mm_and_ps(inside, edgeInside);
+	}
+	quad->mask = (unsigned) _mm_movemask_ps(inside);
+	if (quad->mask == 0)
+	{ return 0; }
+
+	// depth is interpolated w, one reciprocal per lane
+	const __m128 depth = _mm_div_ps(
+		_mm_set1_ps(1.f),
+		gpu_evaluatePlaneSSE2(&setup->inverseDepthPlane, x, y)
+	);
+	float depths[FRAGMENTS_PER_QUAD];
+	_mm_storeu_ps(depths, depth);
+	gpu_storeLaneFragments(quad, 1, depths);
+
+	for (size_t p = 0; p < setup->nofAttributePlanes; ++p)
+	{
+		const GPUAttributePlane *const plane = setup->attributePlanes + p;
+		__m128 value = gpu_evaluatePlaneSSE2(&plane->plane, x, y);
+		if (plane->perspective)
+		{ value = _mm_mul_ps(value, depth); }
+		float values[FRAGMENTS_PER_QUAD];
+		_mm_storeu_ps(values, value);
+		gpu_storeLaneAttribute(
+			quad, 1, values, plane->attribute, plane->component
+		);
+	}
+
+	return quad->mask;
+}
+
+
+/**
+ * @brief This function is AVX2 rasterization kernel that processes two quads
+ * (8 lanes).
+ *
+ * @param quads fragment quads
+ * @param setup triangle setup
+ *
+ * @return union of coverage masks of quads
+ */
+__attribute__((target("avx2")))
+static unsigned gpu_rasterizationKernelAVX2(
+	GPUFragmentQuad *const quads, const GPUTriangleSetup *const setup
+)
+{
+	const size_t nofQuads = 2;
+	const Vec3 *const edges = setup->edges;
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 x = _mm256_add_ps(
+		_mm256_set1_ps((float) quads[0].x + PIXEL_CENTER),
+		_mm256_setr_ps(0.f, 1.f, 0.f, 1.f, 2.f, 3.f, 2.f, 3.f)
+	);
+	const __m256 y = _mm256_add_ps(
+		_mm256_set1_ps((float) quads[0].y + PIXEL_CENTER),
+		_mm256_setr_ps(0.f, 0.f, 1.f, 1.f, 0.f, 0.f, 1.f, 1.f)
+	);
+
+	// lanes inside of region
+	const __m256i laneBits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+	const int regionMask =
+		(int) (quads[0].mask | quads[1].mask << FRAGMENTS_PER_QUAD);
+	__m256 inside = _mm256_castsi256_ps(_mm256_cmpeq_epi32(
+		_mm256_and_si256(_mm256_set1_epi32(regionMask), laneBits), laneBits
+	));
+
+	for (size_t edge = 0; edge < EDGES_PER_TRIANGLE && !setup->fixedPoint;
+		++edge)
+	{
+		const __m256 e = gpu_evaluatePlaneAVX2(edges + edge, x, y);
+		__m256 edgeInside = _mm256_cmp_ps(e, zero, _CMP_GT_OQ);
+		if (setup->topLeft[edge])
+		{
+			edgeInside = _mm256_or_ps(
+				edgeInside, _mm256_cmp_ps(e, zero, _CMP_EQ_OQ)
+			);
+		}
+		inside = _mm256_and_ps(inside, edgeInside);
+	}
+	const unsigned mask = (unsigned) _mm256_movemask_ps(inside);
+	quads[0].mask = mask & QUAD_FULL_MASK;
+	quads[1].mask = mask >> FRAGMENTS_PER_QUAD;
+	if (mask == 0)
+	{ return 0; }
+
+	// depth is interpolated w, one reciprocal per lane
+	const __m256 depth = _mm256_div_ps(
+		_mm256_set1_ps(1.f),
+		gpu_evaluatePlaneAVX2(&setup->inverseDepthPlane, x, y)
+	);
+	float depths[KERNEL_MAX_QUADS * FRAGMENTS_PER_QUAD];
+	_mm256_storeu_ps(depths, depth);
+	gpu_storeLaneFragments(quads, nofQuads, depths);
+
+	for (size_t p = 0; p < setup->nofAttributePlanes; ++p)
+	{
+		const GPUAttributePlane *const plane = setup->attributePlanes + p;
+		__m256 value = gpu_evaluatePlaneAVX2(&plane->plane, x, y);
+		if (plane->perspective)
+		{ value = _mm256_mul_ps(value, depth); }
+		float values[KERNEL_MAX_QUADS * FRAGMENTS_PER_QUAD];
+		_mm256_storeu_ps(values, value);
+		gpu_storeLaneAttribute(
+			quads, nofQuads, values, plane->attribute, plane->component
+		);
+	}
+
+	return mask;
+}
+#endif
+
+
+/**
+ * @brief rasterization kernels ordered from the fastest one, the scalar
+ * kernel has to be the last one
+ */
+static const GPURasterizationKernelInfo kernels[] = {
+#ifdef KERNEL_X86
+	{gpu_rasterizationKernelAVX2, 2, "AVX2"},
+	{gpu_rasterizationKernelSSE2, 1, "SSE2"},
+#endif
+	{gpu_rasterizationKernelScalar, 1, "scalar"},
+};
+
+
+size_t gpu_getSupportedKernelLevel(void)
+{
+	size_t level = 0;
+#ifdef KERNEL_X86
+	// every CPU with AVX2 supports SSE2 too
+	__builtin_cpu_init();
+	if (!__builtin_cpu_supports("avx2"))
+	{
+		level = __builtin_cpu_supports("sse2") ? 1 : 2;
+	}
+#endif
+	return level;
+}
+
+
+const GPURasterizationKernelInfo *gpu_getRasterizationKernels(
+	size_t *const nofKernels
+)
+{
+	assert(nofKernels != NULL);
+
+	const size_t first = gpu_getSupportedKernelLevel();
+	*nofKernels = sizeof(kernels) / sizeof(kernels[0]) - first;
+	return kernels + first;
+}
+
+
+const GPURasterizationKernelInfo *gpu_getRasterizationKernel(void)
+{
+	size_t nofKernels;
+	return gpu_getRasterizationKernels(&nofKernels);
+}
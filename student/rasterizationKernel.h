@@ -0,0 +1,95 @@
+/**
+ * @file
+ * @brief This file contains declarations of rasterization kernels that
+ * evaluate coverage and interpolate fragments of several quads at once.
+ *
+ * @author Dominik Harmim <harmim6@gmail.com>
+ */
+
+
+#pragma once
+
+
+#include <stdlib.h>
+
+#include <student/fwd.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief maximal number of fragment quads processed by one kernel call
+ */
+#define KERNEL_MAX_QUADS 2
+
+
+/**
+ * @brief This function type represents rasterization kernel.
+ * Kernel processes horizontally adjacent quads, quad q has to lie at
+ * [quads[0].x + q * QUAD_SIZE, quads[0].y]. Coords and masks of quads are
+ * filled by caller, mask selects lanes that lie inside of rasterized region.
+ * Kernel clears lanes that are not covered by triangle from masks and creates
+ * fragment shader inputs (coords, depth and attributes) of covered lanes.
+ * Coverage of fixed-point triangle setup is computed by caller and kernel
+ * uses masks as they are.
+ *
+ * @param quads fragment quads
+ * @param setup triangle setup
+ *
+ * @return union of coverage masks of all quads
+ */
+typedef unsigned (*GPURasterizationKernel)(
+	GPUFragmentQuad *quads, const GPUTriangleSetup *setup
+);
+
+/**
+ * @brief This structure describes rasterization kernel.
+ */
+struct GPURasterizationKernelInfo
+{
+	GPURasterizationKernel kernel; ///<kernel function
+	size_t nofQuads; ///<number of quads processed by one kernel call
+	const char *name; ///<name of instruction set used by kernel
+};
+
+
+/**
+ * @brief This function detects the fastest instruction set supported by CPU
+ * at runtime.
+ * Tables of kernels are ordered AVX2, SSE2, scalar and SIMD kernels are only
+ * compiled for x86, so result is index of the first supported kernel of such
+ * table.
+ *
+ * @return 0 for AVX2, 1 for SSE2, 2 for scalar (always 0 without x86 kernels)
+ */
+size_t gpu_getSupportedKernelLevel(void);
+
+/**
+ * @brief This function returns rasterization kernels that are supported by
+ * CPU, the fastest kernel is the first one and the scalar kernel is always
+ * the last one.
+ *
+ * @param nofKernels output number of supported kernels
+ *
+ * @return supported kernels
+ */
+const GPURasterizationKernelInfo *gpu_getRasterizationKernels(
+	size_t *nofKernels
+);
+
+/**
+ * @brief This function returns the fastest rasterization kernel that is
+ * supported by CPU.
+ * Instruction set is detected at runtime (AVX2, SSE2, scalar fallback).
+ *
+ * @return rasterization kernel
+ */
+const GPURasterizationKernelInfo *gpu_getRasterizationKernel(void);
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -9,6 +9,8 @@
 
 #include <assert.h>
 #include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
 
 #include <student/student_cpu.h>
 #include <student/fwd.h>
@@ -24,6 +26,7 @@
 #include <student/vertexPuller.h>
 #include <student/globals.h>
 #include <student/student_pipeline.h>
+#include <student/meshOptimizer.h>
 
 
 /**
@@ -56,6 +59,15 @@ void phong_onInit(int32_t width, int32_t height)
 	cpu_initMatrices(width, height);
 	// init lightPosition
 	init_Vec3(&phong.lightPosition, 1000.f, 1000.f, 1000.f);
+	// rasterize in parallel tiles with watertight fixed-point coverage
+	cpu_enable(phong.gpu, TILED_RASTERIZATION);
+	cpu_enable(phong.gpu, FIXED_POINT_RASTERIZATION);
+	// reject occluded triangles before shading
+	cpu_enable(phong.gpu, HIERARCHICAL_DEPTH_TEST);
+	// shade vertices of draw call in parallel before assembly
+	cpu_enable(phong.gpu, PARALLEL_VERTEX_SHADING);
+	// skip draw calls of bunny when it is outside of view frustum
+	cpu_enable(phong.gpu, BOUNDING_VOLUME_CULLING);
 
 /**
  * @todo Doprogramujte inicializační funkci.
@@ -110,6 +122,10 @@ void phong_onInit(int32_t width, int32_t height)
 	cpu_attachVertexShader(
 		phong.gpu, phong.program, (VertexShader) phong_vertexShader
 	);
+	cpu_attachBatchedVertexShader(
+		phong.gpu, phong.program,
+		(BatchedVertexShader) phong_batchedVertexShader
+	);
 	cpu_attachFragmentShader(
 		phong.gpu, phong.program, (FragmentShader) phong_fragmentShader
 	);
@@ -121,6 +137,12 @@ void phong_onInit(int32_t width, int32_t height)
 	cpu_setAttributeInterpolation( // vertex normal
 		phong.gpu, phong.program, 1, ATTRIB_VEC3, SMOOTH
 	);
+	cpu_setVertexShaderInputType( // vertex position
+		phong.gpu, phong.program, 0, ATTRIB_VEC3
+	);
+	cpu_setVertexShaderInputType( // vertex normal
+		phong.gpu, phong.program, 1, ATTRIB_VEC3
+	);
 
 	// create buffers
 	BufferID bunnyVerticesBuffer;
@@ -128,13 +150,53 @@ void phong_onInit(int32_t width, int32_t height)
 	BufferID bunnyIndicesBuffer;
 	cpu_createBuffers(phong.gpu, 1, &bunnyIndicesBuffer);
 
+	// reorder bunny for vertex cache, overdraw and vertex fetch
+	const size_t nofIndices =
+		sizeof(bunnyIndices) / sizeof(bunnyIndices[0][0]);
+	const size_t nofVertices = sizeof(bunnyVertices) / sizeof(bunnyVertices[0]);
+	uint16_t *const indices = (uint16_t *) malloc(sizeof(bunnyIndices));
+	BunnyVertex *const vertices = (BunnyVertex *) malloc(sizeof(bunnyVertices));
+	assert(indices != NULL && vertices != NULL);
+	cpu_optimizeVertexCache(
+		indices, bunnyIndices, sizeof(bunnyIndices[0][0]), nofIndices,
+		nofVertices, MESH_OPTIMIZER_CACHE_SIZE
+	);
+	cpu_optimizeOverdraw(
+		indices, indices, sizeof(bunnyIndices[0][0]), nofIndices,
+		bunnyVertices[0].position, sizeof(bunnyVertices[0]), nofVertices,
+		MESH_OPTIMIZER_CACHE_SIZE, MESH_OPTIMIZER_OVERDRAW_THRESHOLD
+	);
+	const size_t nofUsedVertices = cpu_optimizeVertexFetch(
+		vertices, bunnyVertices, sizeof(bunnyVertices[0]), indices,
+		sizeof(bunnyIndices[0][0]), nofIndices, nofVertices
+	);
+
+	// compute bounding box of bunny for frustum culling
+	Vec3 boundingBoxMin;
+	Vec3 boundingBoxMax;
+	init_Vec3(&boundingBoxMin, +INFINITY, +INFINITY, +INFINITY);
+	init_Vec3(&boundingBoxMax, -INFINITY, -INFINITY, -INFINITY);
+	for (size_t v = 0; v < nofUsedVertices; ++v)
+	{
+		for (size_t c = 0; c < 3; ++c)
+		{
+			boundingBoxMin.data[c] =
+				fminf(boundingBoxMin.data[c], vertices[v].position[c]);
+			boundingBoxMax.data[c] =
+				fmaxf(boundingBoxMax.data[c], vertices[v].position[c]);
+		}
+	}
+
 	// set data to buffers
 	cpu_bufferData(
-		phong.gpu, bunnyVerticesBuffer, sizeof(bunnyVertices), bunnyVertices
+		phong.gpu, bunnyVerticesBuffer,
+		nofUsedVertices * sizeof(bunnyVertices[0]), vertices
 	);
 	cpu_bufferData(
-		phong.gpu, bunnyIndicesBuffer, sizeof(bunnyIndices), bunnyIndices
+		phong.gpu, bunnyIndicesBuffer, sizeof(bunnyIndices), indices
 	);
+	free(vertices);
+	free(indices);
 
 	// create vertex puller
 	cpu_createVertexPullers(phong.gpu, 1, &phong.puller);
@@ -156,7 +218,14 @@ void phong_onInit(int32_t width, int32_t height)
 	cpu_enableVertexPullerHead(phong.gpu, phong.puller, 1);
 
 	// set vertex puller indexing
-	cpu_setIndexing(phong.gpu, phong.puller, bunnyIndicesBuffer, sizeof(float));
+	cpu_setIndexing(
+		phong.gpu, phong.puller, bunnyIndicesBuffer, sizeof(bunnyIndices[0][0])
+	);
+
+	// set bounding box of bunny
+	cpu_setVertexPullerBoundingBox(
+		phong.gpu, phong.puller, &boundingBoxMin, &boundingBoxMax
+	);
 }
 /**
  * @}
@@ -217,6 +286,10 @@ void phong_onDraw(SDL_Surface *surface)
 		phong.gpu, getUniformLocation(phong.gpu, "projectionMatrix"),
 		(float *) &projectionMatrix
 	);
+	// bunny is drawn in world-space, so it is culled by projection * view
+	Mat4 cullingMatrix;
+	multiply_Mat4_Mat4(&cullingMatrix, &projectionMatrix, &viewMatrix);
+	cpu_setCullingMatrix(phong.gpu, &cullingMatrix);
 	// set camera position uniform data
 	cpu_uniform3f(
 		phong.gpu, getUniformLocation(phong.gpu, "cameraPosition"),
@@ -233,7 +306,9 @@ void phong_onDraw(SDL_Surface *surface)
 	);
 
 	// let's draw
-	cpu_drawTriangles(phong.gpu, sizeof(bunnyIndices) / sizeof(VertexIndex));
+	cpu_drawTriangles(
+		phong.gpu, sizeof(bunnyIndices) / sizeof(bunnyIndices[0][0])
+	);
 
 	// copy image from gpu to SDL surface
 	cpu_swapBuffers(surface, phong.gpu);
@@ -9,11 +9,16 @@
 
 #include <assert.h>
 #include <math.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <student/student_pipeline.h>
 #include <student/gpu.h>
+#include <student/rasterizationKernel.h>
+#include <student/clipKernel.h>
 
 
 /**
@@ -21,7 +26,7 @@
  * @{
  */
 VertexIndex gpu_computeGLVertexID(
-	const VertexIndex *const indices,
+	const void *const indices, const size_t indexSize,
 	const VertexShaderInvocation vertexShaderInvocation
 )
 {
@@ -43,8 +48,21 @@ VertexIndex gpu_computeGLVertexID(
 		return (VertexIndex) vertexShaderInvocation;
 	}
 
-	// indexing is used
-	return indices[vertexShaderInvocation];
+	// indexing is used, indices are read with their declared width
+	if (indexSize == sizeof(uint8_t))
+	{
+		return ((const uint8_t *) indices)[vertexShaderInvocation];
+	}
+	if (indexSize == sizeof(uint16_t))
+	{
+		return ((const uint16_t *) indices)[vertexShaderInvocation];
+	}
+	if (indexSize == sizeof(uint32_t))
+	{
+		return ((const uint32_t *) indices)[vertexShaderInvocation];
+	}
+	assert(indexSize == sizeof(VertexIndex));
+	return ((const VertexIndex *) indices)[vertexShaderInvocation];
 }
 
 
@@ -96,8 +114,9 @@ void gpu_runVertexPuller(
 	assert(puller != NULL);
 
 	// compute vertex ID
-	const VertexIndex gl_VertexID =
-		gpu_computeGLVertexID(puller->indices, vertexShaderInvocation);
+	const VertexIndex gl_VertexID = gpu_computeGLVertexID(
+		puller->indices, puller->indexSize, vertexShaderInvocation
+	);
 
 	// set vertex puller attributes
 	for (int i = 0; i < MAX_ATTRIBUTES; i++)
@@ -157,8 +176,9 @@ void gpu_runPrimitiveAssembly(
 		);
 
 		// compute vertex ID
-		const VertexIndex gl_VertexID =
-			gpu_computeGLVertexID(puller->indices, vertexShaderInvocation);
+		const VertexIndex gl_VertexID = gpu_computeGLVertexID(
+			puller->indices, puller->indexSize, vertexShaderInvocation
+		);
 
 		// run vertex shader
 		GPUVertexShaderInput vertexShaderInput = {
@@ -177,480 +197,827 @@ void gpu_runPrimitiveAssembly(
 
 
 /**
- * @brief This function does clipping of an edge by frustum plane.
+ * @brief This function reallocates memory and terminates application if there
+ * is not enough memory.
  *
- * A point P(t) on the edge is: P(t) = vertexA + t*(vertexB - vertexA), t in
- * [0,1].
- * This function returns interval of possible values of parameter t for which
- * P(t) is in front of frustum plane.
- * The interval is returned in arguments: minT and maxT.
- * If the edge lies in front of the frustum plane, this function return minT =
- * 0.f and maxT = 1.f
- * If the edge lies behind frustum plane, this function returns minT = 1.f and
- * maxT = 0.f
- * The axis selects frustum planes according to: x - LEFT,RIGHT, y - BOTTOM,TOP,
- * z - NEAR,FAR
- * The positive flag selects frustum planes according to: positive = 1 -
- * LEFT,BOTTOM,NEAR, positive = 0 - RIGHT,TOP,FAR.
+ * @param data pointer to reallocated memory (can be NULL)
+ * @param size new size in bytes
  *
- * @param minT     minimal allowed value of parameter t
- * @param maxT     maximal allowed value of parameter t
- * @param vertexA  vertex A of the edge
- * @param vertexB  vertex B of the edge
- * @param axis     axis of frustum plane
- * @param positive positive flag of frustum plane
+ * @return pointer to reallocated memory
  */
-static void gpu_runFrustumPlaneClippingOnEdge(
-	float *const minT, float *const maxT,
-	const Vec4 *const vertexA, const Vec4 *const vertexB,
-	const size_t axis, const size_t positive
+static void *gpu_reallocate(void *const data, const size_t size)
+{
+	void *const result = realloc(data, size);
+	if (result == NULL && size != 0)
+	{
+		fprintf(stderr, "ERROR: gpu_reallocate(..., %zu) failed\n", size);
+		exit(1);
+	}
+	return result;
+}
+
+
+void gpu_compileVertexFetch(
+	GPUVertexFetch *const fetch,
+	const GPUVertexPullerConfiguration *const puller,
+	const size_t nofVertices, const int primitiveRestart,
+	const VertexIndex restartIndex
+)
+{
+	assert(fetch != NULL);
+	assert(puller != NULL);
+
+	fetch->indices = puller->indices;
+	fetch->indexSize = puller->indexSize;
+	fetch->primitiveRestart = primitiveRestart && puller->indices != NULL;
+	fetch->restartIndex = restartIndex;
+	gpu_setVertexFetchRange(fetch, 0, nofVertices, 0);
+
+	fetch->gl_InstanceID = 0;
+	fetch->nofHeads = 0;
+	for (size_t a = 0; a < MAX_ATTRIBUTES; ++a)
+	{
+		const GPUVertexPullerHead *const head = puller->heads + a;
+		if (head->enabled != 1)
+		{ continue; }
+		const size_t h = fetch->nofHeads++;
+		const int instanced = head->divisor != 0;
+		fetch->attributes[h] = a;
+		fetch->origins[h] = (const uint8_t *) head->buffer + head->offset;
+		fetch->bases[h] = fetch->origins[h];
+		fetch->strides[h] = instanced ? 0 : head->stride;
+		fetch->instanceStrides[h] = instanced ? head->stride : 0;
+		fetch->divisors[h] = instanced ? head->divisor : 1;
+	}
+}
+
+
+void gpu_setVertexFetchRange(
+	GPUVertexFetch *const fetch, const VertexShaderInvocation first,
+	const size_t nofVertices, const ptrdiff_t baseVertex
+)
+{
+	assert(fetch != NULL);
+
+	fetch->first = first;
+	fetch->baseVertex = baseVertex;
+	fetch->firstVertexID = 0;
+	fetch->nofVertexIDs = 0;
+	int empty = 1;
+	for (VertexShaderInvocation i = 0; i < nofVertices; ++i)
+	{
+		if (gpu_isPrimitiveRestart(fetch, i))
+		{ continue; }
+		const VertexIndex gl_VertexID = gpu_fetchGLVertexID(fetch, i);
+		if (empty || gl_VertexID < fetch->firstVertexID)
+		{ fetch->firstVertexID = gl_VertexID; }
+		if (gl_VertexID >= fetch->nofVertexIDs)
+		{ fetch->nofVertexIDs = gl_VertexID + 1; }
+		empty = 0;
+		if (fetch->indices == NULL) // vertices are consecutive
+		{
+			fetch->nofVertexIDs = gl_VertexID + nofVertices;
+			break;
+		}
+	}
+}
+
+
+VertexIndex gpu_fetchGLVertexID(
+	const GPUVertexFetch *const fetch,
+	const VertexShaderInvocation vertexShaderInvocation
+)
+{
+	assert(fetch != NULL);
+
+	const VertexIndex index = gpu_computeGLVertexID(
+		fetch->indices, fetch->indexSize, fetch->first + vertexShaderInvocation
+	);
+	assert(fetch->baseVertex >= 0 || index >= (VertexIndex) -fetch->baseVertex);
+	return index + (VertexIndex) fetch->baseVertex;
+}
+
+
+int gpu_isPrimitiveRestart(
+	const GPUVertexFetch *const fetch,
+	const VertexShaderInvocation vertexShaderInvocation
 )
 {
-	// A point on a triangle edge:
-	// A(a,b,t) = a + t*(b-a)
-	// a,b are positions of triangle vertices
-	// t in [0,1]
-	//
-	// -A(a,b,t)w <= (2p-1)*A(a,b,t)i
-	// i - axis
-	// p - positive flag
-	//
-	// solve for t
-	// -aw - t*(bw-aw) <= (1-2p)*(ai + t*(bi-ai))
-	// -t*(bw-aw) - (1-2p)*t*(bi-ai) <= (1-2p)*ai + aw
-	// t*(-bw+aw-(1-2p)*(bi-ai)) <= (1-2p)*ai + aw
-	// t*M <= N
-	// M>0 -> t <= N/M
-	// M<0 -> t >= N/M
-	// M=0 and N>=0 -> t = any value
-	// M=0 and N< 0 -> t = no value
+	assert(fetch != NULL);
+
+	return fetch->primitiveRestart && gpu_computeGLVertexID(
+		fetch->indices, fetch->indexSize, fetch->first + vertexShaderInvocation
+	) == fetch->restartIndex;
+}
 
-	assert(vertexA != NULL);
-	assert(vertexB != NULL);
-	assert(axis <= 2);
-	assert(positive <= 1);
 
-	*minT = 0.f;
-	*maxT = 1.f;
-	const float ai = vertexA->data[axis];
-	const float aw = vertexA->data[3];
-	const float bi = vertexB->data[axis];
-	const float bw = vertexB->data[3];
-	const float s = (2.f * (float) positive - 1.f);
-	const float M = -bw + aw - s * (bi - ai);
-	const float N = s * ai + aw;
+void gpu_setVertexFetchInstance(
+	GPUVertexFetch *const fetch, const VertexIndex gl_InstanceID
+)
+{
+	assert(fetch != NULL);
 
-	if (M > 0.f)
+	fetch->gl_InstanceID = gl_InstanceID;
+	for (size_t h = 0; h < fetch->nofHeads; ++h)
 	{
-		*maxT = fminf(*maxT, N / M);
+		fetch->bases[h] = fetch->origins[h]
+			+ fetch->instanceStrides[h] * (gl_InstanceID / fetch->divisors[h]);
 	}
-	else if (M < 0.f)
+}
+
+
+void gpu_runVertexFetch(
+	GPUVertexPullerOutput *const output, const GPUVertexFetch *const fetch,
+	const VertexIndex gl_VertexID
+)
+{
+	assert(output != NULL);
+	assert(fetch != NULL);
+	assert(gl_VertexID < fetch->nofVertexIDs);
+
+	for (size_t a = 0; a < MAX_ATTRIBUTES; ++a)
 	{
-		*minT = fmaxf(*minT, N / M);
+		output->attributes[a] = NULL;
 	}
-	else if (N < 0.f)
+	for (size_t h = 0; h < fetch->nofHeads; ++h)
 	{
-		*maxT = 0.f;
-		*minT = 1.f;
+		output->attributes[fetch->attributes[h]] =
+			fetch->bases[h] + fetch->strides[h] * gl_VertexID;
 	}
 }
 
 
+void gpu_initVertexCache(
+	GPUVertexCache *const cache, const GPUVertexFetch *const fetch,
+	const int shared
+)
+{
+	assert(cache != NULL);
+	assert(fetch != NULL);
+
+	cache->vertices = NULL;
+	cache->shaded = NULL;
+	cache->outcodes = NULL;
+	cache->firstVertexID = fetch->firstVertexID;
+	cache->nofVertices = fetch->indices != NULL || shared
+		? fetch->nofVertexIDs - fetch->firstVertexID : 0;
+	cache->nofHits = 0;
+	cache->nofInvocations = 0;
+	cache->complete = 0;
+	if (cache->nofVertices == 0)
+	{ return; }
+	cache->vertices = (GPUVertexShaderOutput *) gpu_reallocate(
+		NULL, cache->nofVertices * sizeof(GPUVertexShaderOutput)
+	);
+	cache->shaded = (unsigned char *) gpu_reallocate(NULL, cache->nofVertices);
+	cache->outcodes = (uint16_t *) gpu_reallocate(
+		NULL, cache->nofVertices * sizeof(uint16_t)
+	);
+	memset(cache->shaded, 0, cache->nofVertices);
+}
+
+
+void gpu_resetVertexCache(GPUVertexCache *const cache)
+{
+	assert(cache != NULL);
+
+	if (cache->nofVertices != 0)
+	{ memset(cache->shaded, 0, cache->nofVertices); }
+	cache->complete = 0;
+}
+
+
+void gpu_freeVertexCache(GPUVertexCache *const cache)
+{
+	assert(cache != NULL);
+
+	free(cache->vertices);
+	free(cache->shaded);
+	free(cache->outcodes);
+	cache->vertices = NULL;
+	cache->shaded = NULL;
+	cache->outcodes = NULL;
+	cache->nofVertices = 0;
+}
+
+
 /**
- * @brief This function writes one triangle when only one vertex is visible.
+ * @brief This function shades batch of vertices by batched vertex shader and
+ * stores them into vertex cache.
+ * It writes only slots of the batch, so batches can be shaded in parallel.
  *
- * @param triangles output list of clipped triangles
- * @param nofTriangles number of triangles
- * @param visible visibility mask for triangle vertices
- * @param tMin minimal t parameters
- * @param tMax maximal t parameters
- * @param triangle input triangle
+ * @param gpu GPU handle
+ * @param cache vertex cache
+ * @param fetch compiled vertex fetch
+ * @param input input batch with filled vertex ids
+ * @param shader batched vertex shader
  */
-static void gpu_writeClippedTriangle_OneVertexVisible(
-	GPUTriangle *const triangles, size_t *const nofTriangles,
-	const size_t visible, const float tMin[3], const float tMax[3],
-	const GPUTriangle *const triangle
+static void gpu_shadeVertexBatch(
+	const GPU gpu, GPUVertexCache *const cache,
+	const GPUVertexFetch *const fetch,
+	GPUVertexShaderInputBatch *const input, const BatchedVertexShader shader
 )
 {
-	assert(triangles != NULL);
-	assert(nofTriangles != NULL);
-	assert(triangle != NULL);
+	// pull attributes into structure of arrays, every enabled head has
+	// declared type that is validated before vertices are shaded (see
+	// gpu_canShadeVertexBatches())
+	for (size_t h = 0; h < fetch->nofHeads; ++h)
+	{
+		const size_t a = fetch->attributes[h];
+		const AttributeType type = gpu_getVertexShaderInputType(gpu, a);
+		assert(type != ATTRIB_EMPTY);
+		assert(gpu_isAttributeFetchValidated(
+			gpu, a, sizeof(float) * (size_t) type
+		));
+		for (size_t v = 0; v < input->nofVertices; ++v)
+		{
+			const float *const data = (const float *) (
+				fetch->bases[h] + fetch->strides[h] * input->gl_VertexID[v]
+			);
+			for (size_t c = 0; c < (size_t) type; ++c)
+			{ input->attributes[a][c][v] = data[c]; }
+		}
+	}
 
-	const size_t vertex = visible >> 1;
-	const size_t prevVertex = (vertex + 2) % VERTICES_PER_TRIANGLE;
-	const size_t nextVertex = (vertex + 1) % VERTICES_PER_TRIANGLE;
-	const float prevT = tMin[prevVertex];
-	const float nextT = tMax[vertex];
+	GPUVertexShaderOutputBatch output;
+	shader(&output, input, gpu);
 
-	Vec3 *const dstCoords = triangles[*nofTriangles].coords;
-	const Vec3 *const srcCoords = triangle->coords;
-	Vec4 *const dstPositions = triangles[*nofTriangles].positions;
-	const Vec4 *const srcPositions = triangle->positions;
+	// scatter outputs into cache, only components of used output attributes
+	// are written by shader
+	size_t nofComponents[MAX_ATTRIBUTES];
+	for (size_t a = 0; a < MAX_ATTRIBUTES; ++a)
+	{
+		const AttributeType type = gpu_getAttributeType(gpu, a);
+		nofComponents[a] = type == ATTRIB_EMPTY ? 0 : (size_t) type;
+	}
+	for (size_t v = 0; v < input->nofVertices; ++v)
+	{
+		const size_t slot = input->gl_VertexID[v] - cache->firstVertexID;
+		GPUVertexShaderOutput *const vertex = cache->vertices + slot;
+		vertex->gpu = gpu;
+		for (size_t c = 0; c < 4; ++c)
+		{ vertex->gl_Position.data[c] = output.gl_Position[c][v]; }
+		cache->outcodes[slot] =
+			(uint16_t) gpu_computeClipOutcode(&vertex->gl_Position);
+		for (size_t a = 0; a < MAX_ATTRIBUTES; ++a)
+		{
+			float *const attribute = (float *) vertex->attributes[a];
+			for (size_t c = 0; c < nofComponents[a]; ++c)
+			{ attribute[c] = output.attributes[a][c][v]; }
+		}
+	}
+	input->nofVertices = 0;
+}
 
-	copy_Vec3(dstCoords + 0, srcCoords + vertex);
 
-	mix_Vec3(dstCoords + 1, srcCoords + vertex, srcCoords + nextVertex, nextT);
+int gpu_canShadeVertexBatches(const GPU gpu, const GPUVertexFetch *const fetch)
+{
+	assert(fetch != NULL);
 
-	mix_Vec3(dstCoords + 2, srcCoords + prevVertex, srcCoords + vertex, prevT);
+	// enabled head without declared type would not be pulled
+	for (size_t h = 0; h < fetch->nofHeads; ++h)
+	{
+		if (gpu_getVertexShaderInputType(gpu, fetch->attributes[h])
+			== ATTRIB_EMPTY)
+		{ return 0; }
+	}
+	// declared attribute has to lie inside of its buffer
+	for (size_t a = 0; a < MAX_ATTRIBUTES; ++a)
+	{
+		const AttributeType type = gpu_getVertexShaderInputType(gpu, a);
+		if (type != ATTRIB_EMPTY && !gpu_isAttributeFetchValidated(
+			gpu, a, sizeof(float) * (size_t) type
+		))
+		{ return 0; }
+	}
+	return 1;
+}
 
-	copy_Vec4(dstPositions + 0, srcPositions + vertex);
 
-	mix_Vec4(
-		dstPositions + 1, srcPositions + vertex, srcPositions + nextVertex,
-		nextT
-	);
+void gpu_runBatchedVertexShader(
+	const GPU gpu, GPUVertexCache *const cache,
+	const GPUVertexFetch *const fetch,
+	const size_t nofVertices, const BatchedVertexShader shader
+)
+{
+	assert(cache != NULL);
+	assert(fetch != NULL);
+	assert(shader != NULL);
+
+	GPUVertexShaderInputBatch input;
+	input.nofVertices = 0;
+	input.gl_InstanceID = fetch->gl_InstanceID;
+	for (VertexShaderInvocation i = 0; i < nofVertices; ++i)
+	{
+		if (gpu_isPrimitiveRestart(fetch, i))
+		{ continue; }
+		const VertexIndex gl_VertexID = gpu_fetchGLVertexID(fetch, i);
+		const size_t slot = gl_VertexID - cache->firstVertexID;
+		assert(slot < cache->nofVertices);
+		if (cache->shaded[slot])
+		{
+			cache->nofHits++;
+			continue;
+		}
+		cache->shaded[slot] = 1;
+		cache->nofInvocations++;
+		input.gl_VertexID[input.nofVertices++] = gl_VertexID;
+		if (input.nofVertices == VERTEX_SHADER_BATCH_SIZE)
+		{ gpu_shadeVertexBatch(gpu, cache, fetch, &input, shader); }
+	}
+	if (input.nofVertices != 0)
+	{ gpu_shadeVertexBatch(gpu, cache, fetch, &input, shader); }
+	cache->complete = 1;
+}
 
-	mix_Vec4(
-		dstPositions + 2, srcPositions + prevVertex, srcPositions + vertex,
-		prevT
-	);
 
-	(*nofTriangles)++;
+/**
+ * @brief This function runs vertex shader on one vertex fetched by compiled
+ * vertex fetch.
+ *
+ * @param gpu GPU handle
+ * @param output output vertex
+ * @param fetch compiled vertex fetch
+ * @param gl_VertexID vertex index
+ * @param vertexShader vertex shader
+ */
+static void gpu_shadeVertex(
+	const GPU gpu, GPUVertexShaderOutput *const output,
+	const GPUVertexFetch *const fetch, const VertexIndex gl_VertexID,
+	const VertexShader vertexShader
+)
+{
+	GPUVertexPullerOutput vertexPullerOutput;
+	gpu_runVertexFetch(&vertexPullerOutput, fetch, gl_VertexID);
+	GPUVertexShaderInput vertexShaderInput = {
+		.attributes = &vertexPullerOutput,
+		.gl_VertexID = gl_VertexID,
+		.gl_InstanceID = fetch->gl_InstanceID,
+	};
+	vertexShader(output, &vertexShaderInput, gpu);
 }
 
 
 /**
- * @brief This function writes first clipped triangle when two vertices are
- * visible.
+ * @brief This structure contains everything that is needed for shading of
+ * unique vertices of draw call by GPU worker threads.
+ */
+typedef struct GPUVertexShading
+{
+	GPU gpu; ///<GPU handle
+	GPUVertexCache *cache; ///<vertex cache that receives shaded vertices
+	const GPUVertexFetch *fetch; ///<compiled vertex fetch of draw call
+	const VertexIndex *vertexIDs; ///<unique vertices of draw call
+	size_t nofVertices; ///<number of unique vertices
+	VertexShader vertexShader; ///<vertex shader
+	BatchedVertexShader batchedVertexShader; ///<batched vertex shader or NULL
+} GPUVertexShading;
+
+
+/**
+ * @brief This function shades one chunk of unique vertices of draw call.
+ * It is executed as GPU task.
  *
- * @param dstCoords pointer to destination barycentrics
- * @param srcCoords pointer to source barycentrics
- * @param dstPositions pointer to destination positions
- * @param srcPositions pointer to source positions
- * @param vertex id of not visible vertex
- * @param nextVertex id of next visible vertex in respect to vertex
- * @param prevVertex id of previous visible vertex in respect to vertex
- * @param nextT t parameter of next triangle edge
- * @param prevT t parameter of previous triangle edge
+ * @param data vertex shading (GPUVertexShading)
+ * @param task index of task
+ * @param thread index of thread
  */
-static void gpu_writeClippedTriangle_TwoVerticesVisible_FirstTriangle(
-	Vec3 *const dstCoords, const Vec3 *const srcCoords,
-	Vec4 *const dstPositions, const Vec4 *const srcPositions,
-	const size_t vertex, const size_t nextVertex, const size_t prevVertex,
-	const float nextT, const float prevT
+static void gpu_shadeVertexChunk(
+	void *const data, const size_t task, const size_t thread
 )
 {
-	assert(dstCoords != NULL);
-	assert(srcCoords != NULL);
-	assert(dstPositions != NULL);
-	assert(srcPositions != NULL);
+	(void) thread;
+	const GPUVertexShading *const s = (const GPUVertexShading *) data;
+	const size_t begin = task * VERTEX_SHADING_TASK_SIZE;
+	const size_t end = begin + VERTEX_SHADING_TASK_SIZE < s->nofVertices
+		? begin + VERTEX_SHADING_TASK_SIZE : s->nofVertices;
 
-	mix_Vec3(dstCoords + 0, srcCoords + vertex, srcCoords + nextVertex, nextT);
+	if (s->batchedVertexShader == NULL)
+	{
+		for (size_t v = begin; v < end; ++v)
+		{
+			const size_t slot = s->vertexIDs[v] - s->cache->firstVertexID;
+			gpu_shadeVertex(
+				s->gpu, s->cache->vertices + slot, s->fetch, s->vertexIDs[v],
+				s->vertexShader
+			);
+			s->cache->outcodes[slot] = (uint16_t) gpu_computeClipOutcode(
+				&s->cache->vertices[slot].gl_Position
+			);
+		}
+		return;
+	}
 
-	copy_Vec3(dstCoords + 1, srcCoords + nextVertex);
+	GPUVertexShaderInputBatch input;
+	input.nofVertices = 0;
+	input.gl_InstanceID = s->fetch->gl_InstanceID;
+	for (size_t v = begin; v < end; ++v)
+	{
+		input.gl_VertexID[input.nofVertices++] = s->vertexIDs[v];
+		if (input.nofVertices == VERTEX_SHADER_BATCH_SIZE || v + 1 == end)
+		{
+			gpu_shadeVertexBatch(
+				s->gpu, s->cache, s->fetch, &input, s->batchedVertexShader
+			);
+		}
+	}
+}
 
-	mix_Vec3(dstCoords + 2, srcCoords + prevVertex, srcCoords + vertex, prevT);
 
-	mix_Vec4(
-		dstPositions + 0, srcPositions + vertex, srcPositions + nextVertex,
-		nextT
+void gpu_runParallelVertexShader(
+	const GPU gpu, GPUVertexCache *const cache,
+	const GPUVertexFetch *const fetch, const size_t nofVertices,
+	const VertexShader vertexShader,
+	const BatchedVertexShader batchedVertexShader
+)
+{
+	assert(cache != NULL);
+	assert(fetch != NULL);
+	assert(vertexShader != NULL || batchedVertexShader != NULL);
+	assert(batchedVertexShader == NULL
+		|| gpu_canShadeVertexBatches(gpu, fetch));
+
+	// collect unique vertices, cache slots are claimed serially, so workers
+	// write disjoint slots
+	VertexIndex *const vertexIDs = (VertexIndex *) gpu_reallocate(
+		NULL, cache->nofVertices * sizeof(VertexIndex)
+	);
+	size_t nofUniqueVertices = 0;
+	for (VertexShaderInvocation i = 0; i < nofVertices; ++i)
+	{
+		if (gpu_isPrimitiveRestart(fetch, i))
+		{ continue; }
+		const VertexIndex gl_VertexID = gpu_fetchGLVertexID(fetch, i);
+		const size_t slot = gl_VertexID - cache->firstVertexID;
+		assert(slot < cache->nofVertices);
+		if (cache->shaded[slot])
+		{
+			cache->nofHits++;
+			continue;
+		}
+		cache->shaded[slot] = 1;
+		vertexIDs[nofUniqueVertices++] = gl_VertexID;
+	}
+	cache->nofInvocations += nofUniqueVertices;
+
+	GPUVertexShading shading = {
+		.gpu = gpu,
+		.cache = cache,
+		.fetch = fetch,
+		.vertexIDs = vertexIDs,
+		.nofVertices = nofUniqueVertices,
+		.vertexShader = vertexShader,
+		.batchedVertexShader = batchedVertexShader,
+	};
+	gpu_runTasks(
+		gpu,
+		(nofUniqueVertices + VERTEX_SHADING_TASK_SIZE - 1)
+			/ VERTEX_SHADING_TASK_SIZE,
+		gpu_shadeVertexChunk, &shading
 	);
+	free(vertexIDs);
+	cache->complete = 1;
+}
 
-	copy_Vec4(dstPositions + 1, srcPositions + nextVertex);
 
-	mix_Vec4(
-		dstPositions + 2, srcPositions + prevVertex, srcPositions + vertex,
-		prevT
-	);
+void gpu_initPrimitiveAssembler(
+	GPUPrimitiveAssembler *const assembler, const PrimitiveTopology topology,
+	const GPUVertexFetch *const fetch, const size_t nofVertices
+)
+{
+	assert(assembler != NULL);
+	assert(fetch != NULL);
+
+	assembler->topology = topology;
+	assembler->fetch = fetch;
+	assembler->nofInvocations = nofVertices;
+	assembler->next = 0;
+	assembler->nofPrimitiveVertices = 0;
+	assembler->odd = 0;
 }
 
 
-/**
- * @brief This function writes second clipped triangle when two vertices are
- * visible.
- *
- * @param dstCoords pointer to destination barycentrics
- * @param srcCoords pointer to source barycentrics
- * @param dstPositions pointer to destination positions
- * @param srcPositions pointer to source positions
- * @param vertex id of not visible vertex
- * @param nextVertex id of next visible vertex in respect to vertex
- * @param prevVertex id of previous visible vertex in respect to vertex
- * @param prevT t parameter of previous triangle edge
- */
-static void gpu_writeClippedTriangle_TwoVerticesVisible_SecondTriangle(
-	Vec3 *const dstCoords, const Vec3 *const srcCoords,
-	Vec4 *const dstPositions, const Vec4 *const srcPositions,
-	const size_t vertex, const size_t nextVertex, const size_t prevVertex,
-	const float prevT
+int gpu_assembleTriangle(
+	GPUPrimitiveAssembler *const assembler,
+	VertexShaderInvocation invocations[VERTICES_PER_TRIANGLE]
 )
 {
-	assert(dstCoords != NULL);
-	assert(srcCoords != NULL);
-	assert(dstPositions != NULL);
-	assert(srcPositions != NULL);
+	assert(assembler != NULL);
+	assert(invocations != NULL);
 
-	mix_Vec3(dstCoords + 0, srcCoords + prevVertex, srcCoords + vertex, prevT);
+	VertexShaderInvocation *const vertices = assembler->vertices;
+	while (assembler->next < assembler->nofInvocations)
+	{
+		const VertexShaderInvocation invocation = assembler->next++;
+		if (gpu_isPrimitiveRestart(assembler->fetch, invocation))
+		{
+			assembler->nofPrimitiveVertices = 0;
+			assembler->odd = 0;
+			continue;
+		}
+		if (assembler->nofPrimitiveVertices < VERTICES_PER_TRIANGLE - 1)
+		{
+			vertices[assembler->nofPrimitiveVertices++] = invocation;
+			continue;
+		}
+
+		switch (assembler->topology)
+		{
+			case TOPOLOGY_TRIANGLE_STRIP:
+				// odd triangles keep winding of the first triangle
+				invocations[0] = vertices[assembler->odd];
+				invocations[1] = vertices[!assembler->odd];
+				invocations[2] = invocation;
+				vertices[0] = vertices[1];
+				vertices[1] = invocation;
+				assembler->odd = !assembler->odd;
+				return 1;
+			case TOPOLOGY_TRIANGLE_FAN:
+				invocations[0] = vertices[0];
+				invocations[1] = vertices[1];
+				invocations[2] = invocation;
+				vertices[1] = invocation;
+				return 1;
+			default:
+				invocations[0] = vertices[0];
+				invocations[1] = vertices[1];
+				invocations[2] = invocation;
+				assembler->nofPrimitiveVertices = 0;
+				return 1;
+		}
+	}
 
-	copy_Vec3(dstCoords + 1, srcCoords + nextVertex);
+	return 0;
+}
 
-	copy_Vec3(dstCoords + 2, srcCoords + prevVertex);
 
-	mix_Vec4(
-		dstPositions + 0, srcPositions + prevVertex, srcPositions + vertex,
-		prevT
-	);
+void gpu_assembleCachedPrimitive(
+	const GPU gpu, GPUPrimitive *const primitive,
+	const size_t nofPrimitiveVertices, const GPUVertexFetch *const fetch,
+	const VertexShaderInvocation *const invocations,
+	const VertexShader vertexShader, GPUVertexCache *const cache
+)
+{
+	assert(primitive != NULL);
+	assert(nofPrimitiveVertices <= VERTICES_PER_TRIANGLE);
+	assert(fetch != NULL);
+	assert(invocations != NULL);
+	assert(cache != NULL);
 
-	copy_Vec4(dstPositions + 1, srcPositions + nextVertex);
+	for (size_t i = 0; i < nofPrimitiveVertices; i++)
+	{
+		const VertexIndex gl_VertexID =
+			gpu_fetchGLVertexID(fetch, invocations[i]);
+		if (cache->nofVertices == 0)
+		{
+			gpu_shadeVertex(
+				gpu, primitive->vertices + i, fetch, gl_VertexID, vertexShader
+			);
+			primitive->outcodes[i] =
+				gpu_computeClipOutcode(&primitive->vertices[i].gl_Position);
+			cache->nofInvocations++;
+			continue;
+		}
 
-	copy_Vec4(dstPositions + 2, srcPositions + prevVertex);
+		const size_t slot = gl_VertexID - cache->firstVertexID;
+		assert(slot < cache->nofVertices);
+		if (!cache->shaded[slot])
+		{
+			gpu_shadeVertex(
+				gpu, cache->vertices + slot, fetch, gl_VertexID, vertexShader
+			);
+			cache->outcodes[slot] = (uint16_t) gpu_computeClipOutcode(
+				&cache->vertices[slot].gl_Position
+			);
+			cache->shaded[slot] = 1;
+			cache->nofInvocations++;
+		}
+		else if (!cache->complete)
+		{
+			cache->nofHits++;
+		}
+		primitive->vertices[i] = cache->vertices[slot];
+		primitive->outcodes[i] = cache->outcodes[slot];
+	}
+	primitive->nofUsedVertices = nofPrimitiveVertices;
 }
 
 
-/**
- * @brief This function writes two clipped triangle when two vertices are
- * visible.
- *
- * @param triangles triangle list
- * @param nofTriangles number of triangles
- * @param visible visibility mask of triangle vertices
- * @param tMin minimal t parameters
- * @param tMax maximal t parameters
- * @param triangle input triangle
- */
-static void gpu_writeClippedTriangle_TwoVerticesVisible(
-	GPUTriangle *const triangles, size_t *const nofTriangles,
-	const size_t visible, const float tMin[3], const float tMax[3],
-	const GPUTriangle *const triangle
+void gpu_runCachedPrimitiveAssembly(
+	const GPU gpu, GPUPrimitive *const primitive,
+	const size_t nofPrimitiveVertices, const GPUVertexFetch *const fetch,
+	const VertexShaderInvocation baseVertexShaderInvocation,
+	const VertexShader vertexShader, GPUVertexCache *const cache
 )
 {
-	assert(triangles != NULL);
-	assert(nofTriangles != NULL);
-	assert(triangle != NULL);
-
-	const size_t vertex = (~visible & 0x7) >> 1;
-	const size_t prevVertex = (vertex + 2) % VERTICES_PER_TRIANGLE;
-	const size_t nextVertex = (vertex + 1) % VERTICES_PER_TRIANGLE;
-	const float prevT = tMax[prevVertex];
-	const float nextT = tMin[vertex];
+	assert(nofPrimitiveVertices <= VERTICES_PER_TRIANGLE);
 
-	gpu_writeClippedTriangle_TwoVerticesVisible_FirstTriangle(
-		triangles[*nofTriangles].coords, triangle->coords,
-		triangles[*nofTriangles].positions, triangle->positions, vertex,
-		nextVertex, prevVertex, nextT, prevT
+	VertexShaderInvocation invocations[VERTICES_PER_TRIANGLE];
+	for (size_t i = 0; i < nofPrimitiveVertices; i++)
+	{ invocations[i] = baseVertexShaderInvocation + i; }
+	gpu_assembleCachedPrimitive(
+		gpu, primitive, nofPrimitiveVertices, fetch, invocations, vertexShader,
+		cache
 	);
+}
 
-	(*nofTriangles)++;
 
-	gpu_writeClippedTriangle_TwoVerticesVisible_SecondTriangle(
-		triangles[*nofTriangles].coords, triangle->coords,
-		triangles[*nofTriangles].positions, triangle->positions, vertex,
-		nextVertex, prevVertex, prevT
-	);
+void gpu_getFrustumPlane(Vec4 *const plane, const FrustumPlane frustumPlane)
+{
+	assert(plane != NULL);
 
-	(*nofTriangles)++;
+	// A point in clip-space P=(Px,Py,Pz,Pw) lies in camera view if and only if:
+	// forall i in {x,y,z}: -Pw <= Pi <= +Pw
+	// -Pw <= +Pi - LEFT , BOTTOM, NEAR -> 0 <= Pw + Pi
+	// -Pw <= -Pi - RIGHT, TOP   , FAR  -> 0 <= Pw - Pi
+	const size_t axis = (size_t) frustumPlane / 2;
+	zero_Vec4(plane);
+	plane->data[axis] = frustumPlane % 2 == 0 ? 1.f : -1.f;
+	plane->data[3] = 1.f;
 }
 
 
-/**
- * @brief This function copies input triangle into output triangle list.
- *
- * @param triangles output triangle list
- * @param nofTriangles number of triangles in output triangle list
- * @param triangle input triangle
- */
-static void gpu_writeClippedTriangle_ThreeVerticesVisible(
-	GPUTriangle triangles[MAX_CLIPPED_TRIANGLES], size_t *const nofTriangles,
-	const GPUTriangle *const triangle
+void gpu_initClipPolygon(
+	GPUClipPolygon *const polygon, const GPUTriangle *const triangle
 )
 {
-	assert(triangles != NULL);
-	assert(nofTriangles != NULL);
+	assert(polygon != NULL);
 	assert(triangle != NULL);
 
 	for (size_t v = 0; v < VERTICES_PER_TRIANGLE; ++v)
 	{
-		copy_Vec4(
-			triangles[*nofTriangles].positions + v, triangle->positions + v
-		);
-		copy_Vec3(triangles[*nofTriangles].coords + v, triangle->coords + v);
+		copy_Vec4(polygon->positions + v, triangle->positions + v);
+		copy_Vec3(polygon->coords + v, triangle->coords + v);
 	}
-	(*nofTriangles)++;
+	polygon->nofVertices = VERTICES_PER_TRIANGLE;
 }
 
 
 /**
- * @brief This function performs frustum plane clipping on a triangle.
- * Triangles can be splitted into multiple triangle (0-2) if they intersect a
- * frustum plane.
+ * @brief This function appends intersection of polygon edge with clip plane
+ * to polygon. Intersection is always interpolated from the vertex in front of
+ * plane, so edge shared by two triangles is clipped to the same point.
  *
- * @param triangles    output array of triangles
- * @param nofTriangles number of already clipped triangles in output array of
- * triangles (this number will be increased by 0-2)
- * @param triangle     input triangle
- * @param plane        id of frustum plane
+ * @param polygon output polygon
+ * @param input input polygon
+ * @param distances signed distances of input vertices from plane
+ * @param inside index of vertex in front of plane
+ * @param outside index of vertex behind plane
  */
-static void gpu_runFrustumPlaneClippingOnTriangle(
-	GPUTriangle triangles[MAX_CLIPPED_TRIANGLES], size_t *const nofTriangles,
-	const GPUTriangle *const triangle, const FrustumPlane plane
+static void gpu_appendClipIntersection(
+	GPUClipPolygon *const polygon, const GPUClipPolygon *const input,
+	const float *const distances, const size_t inside, const size_t outside
 )
 {
-	assert(triangles != NULL);
-	assert(nofTriangles != NULL);
-	assert(triangle != NULL);
+	const float t = distances[inside]
+		/ (distances[inside] - distances[outside]);
+	const size_t v = polygon->nofVertices++;
+	assert(v < MAX_CLIP_POLYGON_VERTICES);
+	mix_Vec4(
+		polygon->positions + v, input->positions + inside,
+		input->positions + outside, t
+	);
+	mix_Vec3(
+		polygon->coords + v, input->coords + inside, input->coords + outside, t
+	);
+}
 
-	// A point in clip-space P=(Px,Py,Pz,Pw) lies in camera view if and only if:
-	// forall i in {x,y,z}: -Pw <= Pi <= +Pw
-	// forall i in {x,y,z}: -Pw <= Pi and Pi <= +Pw
-	// forall i in {x,y,z}: -Pw <= Pi and -Pi >= -Pw
-	// forall i in {x,y,z}: -Pw <= Pi and -Pw <= -Pi
-	//
-	// i - axis {x,y,z}
-	//
-	// A axis refers to frustum planes:
-	// x axis - LEFT  , RIGHT
-	// y axis - BOTTOM, TOP
-	// z axis - NEAR  , FAR
-	//
-	// A part of comparison refers to frustum planes:
-	// -Pw <= +Pi - LEFT , BOTTOM, NEAR
-	// -Pw <= -Pi - RIGHT, TOP   , FAR
-	//
-	// -Pw <= (2p-1)Pi
-	// n - positive/negative {0,1}
-	// p = 1 -> LEFT , BOTTOM, NEAR
-	// p = 0 -> RIGHT, TOP   , FAR
-	//
-	// Comparison: -Pw <= Py refers to BOTTOM frustum plane
 
-	size_t axis = 0;
-	if (plane == LEFT || plane == RIGHT)
-	{
-		axis = 0;
-	}
-	else if (plane == BOTTOM || plane == TOP)
-	{
-		axis = 1;
-	}
-	else if (plane == FAR || plane == NEAR)
-	{
-		axis = 2;
-	}
-	size_t positive = 0;
-	if (plane == LEFT || plane == BOTTOM || plane == NEAR)
+void gpu_clipPolygon(GPUClipPolygon *const polygon, const Vec4 *const plane)
+{
+	assert(polygon != NULL);
+	assert(plane != NULL);
+
+	const size_t n = polygon->nofVertices;
+	float distances[MAX_CLIP_POLYGON_VERTICES];
+	size_t nofInside = 0;
+	for (size_t v = 0; v < n; ++v)
 	{
-		positive = 1;
+		distances[v] = dot_Vec4(plane, polygon->positions + v);
+		nofInside += distances[v] >= 0.f;
 	}
-	else if (plane == RIGHT || plane == TOP || plane == FAR)
+	if (nofInside == n)
+	{ return; }
+	if (nofInside == 0)
 	{
-		positive = 0;
+		polygon->nofVertices = 0;
+		return;
 	}
 
-	float tMin[VERTICES_PER_TRIANGLE], tMax[VERTICES_PER_TRIANGLE];
-	for (size_t v = 0; v < VERTICES_PER_TRIANGLE; ++v)
+	// polygon is copied only if it crosses plane
+	const GPUClipPolygon input = *polygon;
+	polygon->nofVertices = 0;
+	for (size_t v = 0; v < n; ++v)
 	{
-		const size_t nextV = (v + 1) % VERTICES_PER_TRIANGLE;
-		gpu_runFrustumPlaneClippingOnEdge(
-			tMin + v, tMax + v, &triangle->positions[v],
-			&triangle->positions[nextV], axis, positive
+		const size_t next = (v + 1) % n;
+		const int inside = distances[v] >= 0.f;
+		if (inside)
+		{
+			const size_t o = polygon->nofVertices++;
+			assert(o < MAX_CLIP_POLYGON_VERTICES);
+			copy_Vec4(polygon->positions + o, input.positions + v);
+			copy_Vec3(polygon->coords + o, input.coords + v);
+		}
+		if (inside == (distances[next] >= 0.f))
+		{ continue; }
+		gpu_appendClipIntersection(
+			polygon, &input, distances, inside ? v : next, inside ? next : v
 		);
 	}
+}
 
-	// Binary mask of visible vertices
-	uint32_t visible = 0u;
-	for (size_t i = 0; i < VERTICES_PER_TRIANGLE; ++i)
-	{
-		visible |= ((uint32_t) (tMin[i] == 0.f && tMin[i] <= tMax[i])) << i;
-	}
 
-	// no vertex is in front of frustum plane
-	if (visible == 0x0)
-	{
-		// fprintf(stderr,"zero\n");
-		return;
-	}
+void gpu_getClipPolygonTriangle(
+	GPUTriangle *const triangle, const GPUClipPolygon *const polygon,
+	const size_t index
+)
+{
+	assert(triangle != NULL);
+	assert(polygon != NULL);
+	assert(index + 2 < polygon->nofVertices);
 
-	// only one vertex is in front of frustum plane
-	if (visible == 0x1 || visible == 0x2 || visible == 0x4)
+	// fan around the first vertex
+	const size_t vertices[VERTICES_PER_TRIANGLE] = {0, index + 1, index + 2};
+	for (size_t v = 0; v < VERTICES_PER_TRIANGLE; ++v)
 	{
-		// fprintf(stderr,"one\n");
-		gpu_writeClippedTriangle_OneVertexVisible(
-			triangles, nofTriangles, visible,
-			tMin, tMax, triangle
-		);
-		return;
+		copy_Vec4(triangle->positions + v, polygon->positions + vertices[v]);
+		copy_Vec3(triangle->coords + v, polygon->coords + vertices[v]);
 	}
+}
 
-	// two vertrices are in front of frustum plane
-	if (visible == 0x3 || visible == 0x5 || visible == 0x6)
-	{
-		// fprintf(stderr,"two\n");
-		gpu_writeClippedTriangle_TwoVerticesVisible(
-			triangles, nofTriangles,
-			visible, tMin, tMax, triangle
-		);
-		return;
-	}
 
-	// all vertices are in front of frustum plane
-	if (visible == 0x7)
+unsigned gpu_computeClipOutcode(const Vec4 *const position)
+{
+	assert(position != NULL);
+
+	const float w = position->data[3];
+	const float guardBand = GUARD_BAND_SIZE * w;
+	unsigned outcode = 0;
+	for (unsigned axis = 0; axis < 3; ++axis)
 	{
-		// fprintf(stderr,"three\n");
-		gpu_writeClippedTriangle_ThreeVerticesVisible(
-			triangles, nofTriangles,
-			triangle
-		);
-		return;
+		const float coord = position->data[axis];
+		// planes of axis are (LEFT, RIGHT), (BOTTOM, TOP) and (NEAR, FAR)
+		outcode |= (unsigned) (coord < -w) << (2 * axis);
+		outcode |= (unsigned) (coord > w) << (2 * axis + 1);
+		if (axis == 2)
+		{ continue; }
+		outcode |= (unsigned) (coord < -guardBand)
+			<< (FAR + 1 + 2 * axis);
+		outcode |= (unsigned) (coord > guardBand) << (FAR + 2 + 2 * axis);
 	}
+	return outcode;
 }
 
 
-/**
- * @brief This function performs frustum plane clipping on triangle list.
- * Triangles can be splitted into multiple triangles if they intersect a frustum
- * plane.
- * This function performs clipping using only one selected frustum plane.
- * This function has to be called 6 times in order to do full frustum clipping.
- * Every triangle in input triangle list is subject of clipping.
- *
- * @param output output triangle list
- * @param input input triangle list
- * @param plane id of plane
- */
-static void gpu_runFrustumPlaneClippingOnTriangleList(
-	GPUTriangleList *const output, const GPUTriangleList *const input,
-	const FrustumPlane plane
+int gpu_isBoundingBoxOutsideFrustum(
+	const Mat4 *const matrix, const float min[3], const float max[3]
 )
 {
-	assert(output != NULL);
-	assert(input != NULL);
+	assert(matrix != NULL);
+	assert(min != NULL);
+	assert(max != NULL);
 
-	output->nofTriangles = 0;
-	for (size_t i = 0; i < input->nofTriangles; ++i)
+	unsigned outside = FRUSTUM_OUTCODES;
+	for (unsigned corner = 0; corner < 8; ++corner)
 	{
-		gpu_runFrustumPlaneClippingOnTriangle(
-			output->triangles, &output->nofTriangles, input->triangles + i,
-			plane
+		Vec4 position;
+		init_Vec4(
+			&position, corner & 1 ? max[0] : min[0],
+			corner & 2 ? max[1] : min[1], corner & 4 ? max[2] : min[2], 1.f
 		);
+		Vec4 clipPosition;
+		multiply_Mat4_Vec4(&clipPosition, matrix, &position);
+		outside &= gpu_computeClipOutcode(&clipPosition);
+		if (outside == 0)
+		{ return 0; }
 	}
+
+	return 1;
 }
 
 
 void gpu_runTriangleClipping(
-	GPUTriangleList *const output, const GPUTriangle *const input
+	GPUClipPolygon *const output, const GPUTriangle *const input,
+	const unsigned planes
 )
 {
 	assert(output != NULL);
 	assert(input != NULL);
 
-	output->nofTriangles = 0;
-
-	// full clipping
-//	GPUTriangleList c;
-//	c.nofTriangles = 0;
-//	gpu_runFrustumPlaneClippingOnTriangle(
-//		c.triangles,&c.nofTriangles,input,NEAR
-//	);
-//	gpu_runFrustumPlaneClippingOnTriangleList(output,&c    ,FAR   );
-//	gpu_runFrustumPlaneClippingOnTriangleList(&c    ,output,LEFT  );
-//	gpu_runFrustumPlaneClippingOnTriangleList(output,&c    ,RIGHT );
-//	gpu_runFrustumPlaneClippingOnTriangleList(&c    ,output,BOTTOM);
-//	gpu_runFrustumPlaneClippingOnTriangleList(output,&c    ,TOP   );
-
-	// near plane clipping
-	gpu_runFrustumPlaneClippingOnTriangle(
-		output->triangles, &output->nofTriangles, input, NEAR
-	);
+	gpu_initClipPolygon(output, input);
+	// near plane is clipped first, so the other planes never see vertices
+	// with w <= 0
+	static const FrustumPlane order[] = {NEAR, LEFT, RIGHT, BOTTOM, TOP, FAR};
+	for (size_t p = 0; p < sizeof(order) / sizeof(order[0]); ++p)
+	{
+		if (!(planes & FRUSTUM_OUTCODE(order[p])))
+		{ continue; }
+		Vec4 plane;
+		gpu_getFrustumPlane(&plane, order[p]);
+		gpu_clipPolygon(output, &plane);
+		if (output->nofVertices == 0)
+		{ return; }
+	}
 }
 
 
@@ -842,193 +1209,46 @@ float gpu_noperspectiveInterpolate(
 }
 
 
-float gpu_smoothInterpolate(
-	const float values[WEIGHTS_PER_BARYCENTRICS],
-	const float weights[WEIGHTS_PER_BARYCENTRICS],
-	const float homogeneousCoords[WEIGHTS_PER_BARYCENTRICS]
-)
-{
-	float dividend = 0.f;
-	float divisor = 0.f;
-	for (size_t i = 0; i < WEIGHTS_PER_BARYCENTRICS; ++i)
-	{
-		const float divInc = weights[i] / homogeneousCoords[i];
-		dividend += values[i] * divInc;
-		divisor += divInc;
-	}
-	return dividend / divisor;
-}
-
-
-/**
- * @brief This function creates fragment attribute using flat interpolation.
- *
- * @param fragment output fragment
- * @param primitive input primitive
- * @param attribute attribute index
- * @param nofComponents number of components of selected attribute
- */
-static void gpu_createFlatFragmentAttribute(
-	GPUFragmentShaderInput *const fragment, const GPUPrimitive *const primitive,
-	size_t attribute, size_t nofComponents
-)
-{
-	for (size_t component = 0; component < nofComponents; ++component)
-	{
-		((float *) fragment->attributes.attributes[attribute])[component] =
-			((float *) primitive->vertices[0].attributes[attribute])[component];
-	}
-}
-
-
-/**
- * @brief This function creates fragment attribute using noperspective
- * interpolation.
- *
- * @param fragment output fragment
- * @param primitive input primitive
- * @param attribute attrbute index
- * @param nofComponents number of components of selected attribute
- * @param barycentrics barycentric coordinates
- */
-static void gpu_createNoPerspectiveFragmentAttribute(
-	GPUFragmentShaderInput *const fragment, const GPUPrimitive *const primitive,
-	size_t attribute, size_t nofComponents, const Vec3 *const barycentrics
-)
-{
-	for (size_t component = 0; component < nofComponents; ++component)
-	{
-		const float values[WEIGHTS_PER_BARYCENTRICS] = {
-			((float *) primitive->vertices[0].attributes[attribute])[component],
-			((float *) primitive->vertices[1].attributes[attribute])[component],
-			((float *) primitive->vertices[2].attributes[attribute])[component],
-		};
-		((float *) fragment->attributes.attributes[attribute])[component] =
-			gpu_noperspectiveInterpolate(values, barycentrics->data);
-	}
-}
-
-
-/**
- * @brief This function create fragment attribute using smooth interpolation.
- *
- * @param fragment output fragment
- * @param primitive input primitive
- * @param attribute attribute index
- * @param nofComponents number of components of selected attribute
- * @param barycentrics barycentric coordinates
- * @param homogeneousCoords weights of triangle vertices
- */
-static void gpu_createSmoothFragmentAttribute(
-	GPUFragmentShaderInput *const fragment, const GPUPrimitive *const primitive,
-	size_t attribute, size_t nofComponents, const Vec3 *const barycentrics,
-	const float homogeneousCoords[WEIGHTS_PER_BARYCENTRICS]
-)
-{
-	for (size_t component = 0; component < nofComponents; ++component)
-	{
-		const float values[WEIGHTS_PER_BARYCENTRICS] = {
-			((float *) primitive->vertices[0].attributes[attribute])[component],
-			((float *) primitive->vertices[1].attributes[attribute])[component],
-			((float *) primitive->vertices[2].attributes[attribute])[component],
-		};
-		((float *) fragment->attributes.attributes[attribute])[component] =
-			gpu_smoothInterpolate(
-				values, barycentrics->data, homogeneousCoords
-			);
-	}
-}
-
-
-/**
- * @brief This function creates interpolated fragment attribute.
- *
- * @param fragment output fragment
- * @param primitive input primitive
- * @param attribute attribute index
- * @param barycentrics barycentric coordinates
- * @param homogeneousCoords weights of triangle vertices
- */
-static void gpu_createInterpolatedFragmentAttribute(
-	GPUFragmentShaderInput *const fragment, const GPUPrimitive *const primitive,
-	size_t attribute, const Vec3 *const barycentrics,
-	const float homogeneousCoords[WEIGHTS_PER_BARYCENTRICS]
-)
-{
-	const size_t nofComponents = (size_t) primitive->types[attribute];
-	if (primitive->interpolations[attribute] == FLAT)
-	{
-		gpu_createFlatFragmentAttribute(
-			fragment, primitive, attribute,
-			nofComponents
-		);
-	}
-	else if (primitive->interpolations[attribute] == NOPERSPECTIVE)
-	{
-		gpu_createNoPerspectiveFragmentAttribute(
-			fragment, primitive, attribute,
-			nofComponents, barycentrics
-		);
-	}
-	else if (primitive->interpolations[attribute] == SMOOTH)
-	{
-		gpu_createSmoothFragmentAttribute(
-			fragment, primitive, attribute,
-			nofComponents, barycentrics,
-			homogeneousCoords
-		);
-	}
-}
-
-
-void gpu_createFragment(
-	GPUFragmentShaderInput *const fragment, const GPUPrimitive *const primitive,
-	const Vec3 *const barycentrics, const Vec2 *const pixelCoord
+void gpu_perFragmentOperations(
+	const GPU gpu, const GPUFragmentShaderOutput *const fragment,
+	const size_t x, const size_t y
 )
 {
 	assert(fragment != NULL);
-	assert(primitive != NULL);
-	assert(barycentrics != NULL);
 
-	const float homogeneousCoords[WEIGHTS_PER_BARYCENTRICS] = {
-		primitive->vertices[0].gl_Position.data[3],
-		primitive->vertices[1].gl_Position.data[3],
-		primitive->vertices[2].gl_Position.data[3],
-	};
-
-	for (size_t attribute = 0; attribute < MAX_ATTRIBUTES; ++attribute)
+	if (!fragment->discard && fragment->depth < gpu_getDepth(gpu, x, y))
 	{
-		if (primitive->types[attribute] == ATTRIB_EMPTY)
-		{ continue; }
-		gpu_createInterpolatedFragmentAttribute(
-			fragment, primitive, attribute,
-			barycentrics, homogeneousCoords
-		);
+		gpu_setColor(gpu, x, y, &fragment->color);
+		gpu_setDepth(gpu, x, y, fragment->depth);
 	}
-	copy_Vec2(&fragment->coords, pixelCoord);
-
-	const float depths[WEIGHTS_PER_BARYCENTRICS] = {
-		primitive->vertices[0].gl_Position.data[3],
-		primitive->vertices[1].gl_Position.data[3],
-		primitive->vertices[2].gl_Position.data[3],
-	};
-	fragment->depth =
-		gpu_smoothInterpolate(depths, barycentrics->data, homogeneousCoords);
 }
 
 
-void gpu_perFragmentOperations(
-	const GPU gpu, const GPUFragmentShaderOutput *const fragment,
-	const size_t x, const size_t y
+unsigned gpu_perQuadOperations(
+	const GPU gpu, const GPUFragmentQuad *const quad
 )
 {
-	assert(fragment != NULL);
+	assert(quad != NULL);
 
-	if (fragment->depth < gpu_getDepth(gpu, x, y))
+	const size_t width = gpu_getViewportWidth(gpu);
+	const size_t offset = quad->y * width + quad->x;
+	float *const depthBuffer = gpu_getDepthBuffer(gpu) + offset;
+	Vec4 *const colorBuffer = gpu_getColorBuffer(gpu) + offset;
+	unsigned written = 0;
+	for (size_t lane = 0; lane < FRAGMENTS_PER_QUAD; ++lane)
 	{
-		gpu_setColor(gpu, x, y, &fragment->color);
-		gpu_setDepth(gpu, x, y, fragment->depth);
+		if (!(quad->mask & (1u << lane)))
+		{ continue; }
+		const size_t pixel = (lane / QUAD_SIZE) * width + lane % QUAD_SIZE;
+		const GPUFragmentShaderOutput *const fragment = quad->outputs + lane;
+		if (!fragment->discard && fragment->depth < depthBuffer[pixel])
+		{
+			copy_Vec4(colorBuffer + pixel, &fragment->color);
+			depthBuffer[pixel] = fragment->depth;
+			written |= 1u << lane;
+		}
 	}
+	return written;
 }
 
 
@@ -1067,6 +1287,54 @@ void gpu_initPrimitive(GPUPrimitive *const primitive, const GPU gpu)
 }
 
 
+void gpu_createClippedVertex(
+	GPUVertexShaderOutput *const vertex, const GPUPrimitive *const primitive,
+	const Vec4 *const position, const Vec3 *const coords
+)
+{
+	assert(vertex != NULL);
+	assert(primitive != NULL);
+	assert(position != NULL);
+	assert(coords != NULL);
+
+	// vertices of original triangle are copied without interpolation
+	for (size_t v = 0; v < VERTICES_PER_TRIANGLE; ++v)
+	{
+		if (coords->data[v] == 1.f
+			&& coords->data[(v + 1) % VERTICES_PER_TRIANGLE] == 0.f
+			&& coords->data[(v + 2) % VERTICES_PER_TRIANGLE] == 0.f)
+		{
+			*vertex = primitive->vertices[v];
+			return;
+		}
+	}
+
+	// position is already computed by clipping
+	vertex->gl_Position = *position;
+	for (size_t attributeIndex = 0; attributeIndex < MAX_ATTRIBUTES;
+		++attributeIndex)
+	{
+		if (primitive->types[attributeIndex] == ATTRIB_EMPTY)
+		{ continue; }
+		const size_t dimension = (size_t) primitive->types[attributeIndex];
+		for (size_t componentIndex = 0; componentIndex < dimension;
+			++componentIndex)
+		{
+			const float values[WEIGHTS_PER_BARYCENTRICS] = {
+				((float *) primitive->vertices[0]
+					.attributes[attributeIndex])[componentIndex],
+				((float *) primitive->vertices[1]
+					.attributes[attributeIndex])[componentIndex],
+				((float *) primitive->vertices[2]
+					.attributes[attributeIndex])[componentIndex]
+			};
+			((float *) vertex->attributes[attributeIndex])[componentIndex] =
+				gpu_noperspectiveInterpolate(values, coords->data);
+		}
+	}
+}
+
+
 void gpu_createSubPrimitive(
 	GPUPrimitive *const subPrimitive, const GPUPrimitive *const primitive,
 	const GPUTriangle *const clippedTriangle
@@ -1083,50 +1351,12 @@ void gpu_createSubPrimitive(
 		subPrimitive->types[a] = primitive->types[a];
 	}
 
-	// interpolate vertex attributes to subPrimitive
-	for (size_t vertexIndex = 0; vertexIndex < VERTICES_PER_TRIANGLE;
-		++vertexIndex)
+	for (size_t v = 0; v < VERTICES_PER_TRIANGLE; ++v)
 	{
-		// interpolate positions of vertices
-		for (size_t componentIndex = 0; componentIndex < 4; ++componentIndex)
-		{
-			const float values[WEIGHTS_PER_BARYCENTRICS] = {
-				primitive->vertices[0].gl_Position.data[componentIndex],
-				primitive->vertices[1].gl_Position.data[componentIndex],
-				primitive->vertices[2].gl_Position.data[componentIndex]
-			};
-			subPrimitive
-				->vertices[vertexIndex].gl_Position.data[componentIndex] =
-				gpu_noperspectiveInterpolate(
-					values, clippedTriangle->coords[vertexIndex].data
-				);
-		}
-
-		// interpolate vertex attributes
-		for (size_t attributeIndex = 0; attributeIndex < MAX_ATTRIBUTES;
-			++attributeIndex)
-		{
-			if (primitive->types[attributeIndex] == ATTRIB_EMPTY)
-			{ continue; }
-			const size_t dimension = (size_t) primitive->types[attributeIndex];
-			for (size_t componentIndex = 0; componentIndex < dimension;
-				++componentIndex)
-			{
-				const float values[WEIGHTS_PER_BARYCENTRICS] = {
-					((float *) primitive->vertices[0]
-						.attributes[attributeIndex])[componentIndex],
-					((float *) primitive->vertices[1]
-						.attributes[attributeIndex])[componentIndex],
-					((float *) primitive->vertices[2]
-						.attributes[attributeIndex])[componentIndex]
-				};
-				((float *) subPrimitive->vertices[vertexIndex]
-					.attributes[attributeIndex])[componentIndex] =
-					gpu_noperspectiveInterpolate(
-						values, clippedTriangle->coords[vertexIndex].data
-					);
-			}
-		}
+		gpu_createClippedVertex(
+			subPrimitive->vertices + v, primitive,
+			clippedTriangle->positions + v, clippedTriangle->coords + v
+		);
 	}
 }
 
@@ -1149,129 +1379,1417 @@ void gpu_initTriangle(
 }
 
 
-void gpu_rasterizeTriangle(
-	const GPU gpu, const GPUPrimitive *const primitive,
-	const size_t width, const size_t height
+float gpu_computeTriangleSignedArea(const GPUPrimitive *const primitive)
+{
+	assert(primitive != NULL);
+
+	const float *const a = primitive->vertices[0].gl_Position.data;
+	const float *const b = primitive->vertices[1].gl_Position.data;
+	const float *const c = primitive->vertices[2].gl_Position.data;
+	return (b[0] - a[0]) * (c[1] - a[1]) - (c[0] - a[0]) * (b[1] - a[1]);
+}
+
+
+int gpu_isTriangleCulled(
+	const GPUPrimitive *const primitive, const CullFaceMode mode,
+	const FrontFace frontFace
 )
 {
 	assert(primitive != NULL);
 
-	// bounding quad of primitive
-	float yMin = +INFINITY;
-	float yMax = -INFINITY;
-	for (size_t v = 0; v < primitive->nofUsedVertices; ++v)
+	if (mode == CULL_NONE)
+	{ return 0; }
+
+	const float area = gpu_computeTriangleSignedArea(primitive);
+	if (area == 0.f)
+	{ return 0; }
+	const int frontFacing = (area > 0.f) == (frontFace == FRONT_FACE_CCW);
+	return mode == CULL_BACK ? !frontFacing : frontFacing;
+}
+
+
+/**
+ * @brief scale and half pixel of fixed-point screen-space coords
+ */
+#define SUBPIXEL_SCALE ((int64_t) 1 << SUBPIXEL_BITS)
+#define SUBPIXEL_HALF (SUBPIXEL_SCALE / 2) ///<@copydoc SUBPIXEL_SCALE
+
+
+/**
+ * @brief This function computes the first pixel whose center is not lower
+ * than fixed-point coord.
+ *
+ * @param coord fixed-point coord
+ *
+ * @return pixel coord
+ */
+static size_t gpu_fixedPointFirstPixel(const int64_t coord)
+{
+	if (coord <= SUBPIXEL_HALF)
+	{ return 0; }
+	return (size_t) ((coord - SUBPIXEL_HALF + SUBPIXEL_SCALE - 1)
+		/ SUBPIXEL_SCALE);
+}
+
+
+/**
+ * @brief This function computes pixel after the last pixel whose center is
+ * not greater than fixed-point coord.
+ *
+ * @param coord fixed-point coord
+ *
+ * @return pixel coord
+ */
+static size_t gpu_fixedPointEndPixel(const int64_t coord)
+{
+	if (coord < SUBPIXEL_HALF)
+	{ return 0; }
+	return (size_t) ((coord - SUBPIXEL_HALF) / SUBPIXEL_SCALE + 1);
+}
+
+
+/**
+ * @brief This function snaps vertices of triangle to sub-pixel grid and
+ * computes fixed-point edge functions and bounding box.
+ *
+ * @param setup triangle setup with primitive
+ * @param width screen width in pixels
+ * @param height screen height in pixels
+ *
+ * @return 0 if snapped triangle is degenerate or clockwise, otherwise 1
+ */
+static int gpu_setupFixedPointTriangle(
+	GPUTriangleSetup *const setup, const size_t width, const size_t height
+)
+{
+	int64_t x[VERTICES_PER_TRIANGLE];
+	int64_t y[VERTICES_PER_TRIANGLE];
+	for (size_t v = 0; v < VERTICES_PER_TRIANGLE; ++v)
 	{
-		yMin = fminf(yMin, primitive->vertices[v].gl_Position.data[1]);
-		yMax = fmaxf(yMax, primitive->vertices[v].gl_Position.data[1]);
+		float *const position = setup->primitive.vertices[v].gl_Position.data;
+		x[v] = (int64_t) llrintf(position[0] * (float) SUBPIXEL_SCALE);
+		y[v] = (int64_t) llrintf(position[1] * (float) SUBPIXEL_SCALE);
+		position[0] = (float) x[v] / (float) SUBPIXEL_SCALE;
+		position[1] = (float) y[v] / (float) SUBPIXEL_SCALE;
 	}
-	if (yMin < 0.f)
-	{ yMin = 0.f; }
-	if (yMax < 0.f)
-	{ yMax = 0.f; }
 
-	Vec3 triangleLines[EDGES_PER_TRIANGLE];
-	Vec2 triangleVertices[VERTICES_PER_TRIANGLE];
-	for (size_t vertex = 0; vertex < VERTICES_PER_TRIANGLE; ++vertex)
+	for (size_t edge = 0; edge < EDGES_PER_TRIANGLE; ++edge)
 	{
-		copy_Vec4_To_Vec2(
-			triangleVertices + vertex,
-			&primitive->vertices[vertex].gl_Position
+		const size_t i = edge;
+		const size_t j = (edge + 1) % VERTICES_PER_TRIANGLE;
+		const size_t opposite = (edge + 2) % VERTICES_PER_TRIANGLE;
+		const int64_t a = y[i] - y[j];
+		const int64_t b = x[j] - x[i];
+		const int64_t c = -a * x[i] - b * y[i];
+		// twice the area of triangle in sub-pixel units
+		if (a * x[opposite] + b * y[opposite] + c <= 0)
+		{ return 0; }
+
+		// left edge or top edge (row 0 is at the bottom of screen)
+		setup->topLeft[edge] = a > 0 || (a == 0 && b < 0);
+		setup->fixedEdges[edge][0] = a;
+		setup->fixedEdges[edge][1] = b;
+		setup->fixedEdges[edge][2] = c - !setup->topLeft[edge];
+	}
+
+	const int64_t xMin = x[0] < x[1] ? (x[0] < x[2] ? x[0] : x[2])
+		: (x[1] < x[2] ? x[1] : x[2]);
+	const int64_t xMax = x[0] > x[1] ? (x[0] > x[2] ? x[0] : x[2])
+		: (x[1] > x[2] ? x[1] : x[2]);
+	const int64_t yMin = y[0] < y[1] ? (y[0] < y[2] ? y[0] : y[2])
+		: (y[1] < y[2] ? y[1] : y[2]);
+	const int64_t yMax = y[0] > y[1] ? (y[0] > y[2] ? y[0] : y[2])
+		: (y[1] > y[2] ? y[1] : y[2]);
+	setup->xMin = gpu_fixedPointFirstPixel(xMin);
+	setup->xMax = gpu_fixedPointEndPixel(xMax);
+	setup->yMin = gpu_fixedPointFirstPixel(yMin);
+	setup->yMax = gpu_fixedPointEndPixel(yMax);
+	if (setup->xMax >= width)
+	{ setup->xMax = width; }
+	if (setup->yMax >= height)
+	{ setup->yMax = height; }
+
+	return 1;
+}
+
+
+/**
+ * @brief This function computes screen-space plane of value that is given in
+ * vertices of triangle, plane is combination of edge functions of setup.
+ *
+ * @param plane output plane
+ * @param setup triangle setup with computed edge functions
+ * @param values values in vertices of triangle
+ */
+static void gpu_computeValuePlane(
+	Vec3 *const plane, const GPUTriangleSetup *const setup,
+	const float values[VERTICES_PER_TRIANGLE]
+)
+{
+	zero_Vec3(plane);
+	for (size_t v = 0; v < VERTICES_PER_TRIANGLE; ++v)
+	{
+		// barycentric coordinate of vertex v is edge (v + 1) % 3
+		Vec3 term;
+		multiply_Vec3_Float(
+			&term, setup->edges + (v + 1) % VERTICES_PER_TRIANGLE, values[v]
 		);
+		add_Vec3(plane, plane, &term);
+	}
+}
+
+
+/**
+ * @brief This function computes planes of 1/w and of all attribute
+ * components of triangle setup.
+ *
+ * @param setup triangle setup with computed edge functions
+ */
+static void gpu_setupAttributePlanes(GPUTriangleSetup *const setup)
+{
+	const GPUPrimitive *const primitive = &setup->primitive;
+	float inverseW[VERTICES_PER_TRIANGLE];
+	for (size_t v = 0; v < VERTICES_PER_TRIANGLE; ++v)
+	{
+		inverseW[v] = 1.f / primitive->vertices[v].gl_Position.data[3];
+	}
+	gpu_computeValuePlane(&setup->inverseDepthPlane, setup, inverseW);
+
+	setup->nofAttributePlanes = 0;
+	for (size_t a = 0; a < MAX_ATTRIBUTES; ++a)
+	{
+		if (primitive->types[a] == ATTRIB_EMPTY)
+		{ continue; }
+		for (size_t c = 0; c < (size_t) primitive->types[a]; ++c)
+		{
+			GPUAttributePlane *const plane =
+				setup->attributePlanes + setup->nofAttributePlanes++;
+			plane->attribute = a;
+			plane->component = c;
+			plane->perspective = primitive->interpolations[a] == SMOOTH;
+
+			float values[VERTICES_PER_TRIANGLE];
+			for (size_t v = 0; v < VERTICES_PER_TRIANGLE; ++v)
+			{
+				values[v] = ((const float *)
+					primitive->vertices[v].attributes[a])[c];
+				if (plane->perspective)
+				{ values[v] *= inverseW[v]; }
+			}
+			if (primitive->interpolations[a] == FLAT)
+			{ init_Vec3(&plane->plane, 0.f, 0.f, values[0]); }
+			else
+			{ gpu_computeValuePlane(&plane->plane, setup, values); }
+		}
 	}
-	gpu_computeTriangleLines(triangleLines, triangleVertices);
+}
+
+
+int gpu_setupTriangle(
+	GPUTriangleSetup *const setup, const GPUPrimitive *const primitive,
+	const size_t width, const size_t height, const int fixedPoint
+)
+{
+	assert(setup != NULL);
+	assert(primitive != NULL);
+
+	setup->primitive = *primitive;
+	// clockwise triangles are rasterized with reversed winding
+	if (gpu_computeTriangleSignedArea(primitive) < 0.f)
+	{
+		setup->primitive.vertices[1] = primitive->vertices[2];
+		setup->primitive.vertices[2] = primitive->vertices[1];
+	}
+
+	// triangles with too large coords are rasterized in floating point
+	setup->fixedPoint = fixedPoint;
+	for (size_t v = 0; v < VERTICES_PER_TRIANGLE && setup->fixedPoint; ++v)
+	{
+		const float *const position =
+			setup->primitive.vertices[v].gl_Position.data;
+		setup->fixedPoint = fabsf(position[0]) < FIXED_POINT_MAX_COORD
+			&& fabsf(position[1]) < FIXED_POINT_MAX_COORD;
+	}
+	if (setup->fixedPoint
+		&& !gpu_setupFixedPointTriangle(setup, width, height))
+	{ return 0; }
 
-	size_t yMinI = gpu_roundDownPixelCoord(yMin);
-	size_t yMaxI = gpu_roundUpPixelCoord(yMax);
-	if (yMaxI >= height)
-	{ yMaxI = height; }
+	// the nearest depth of triangle, depth is interpolated w
+	setup->minDepth = fminf(
+		primitive->vertices[0].gl_Position.data[3],
+		fminf(
+			primitive->vertices[1].gl_Position.data[3],
+			primitive->vertices[2].gl_Position.data[3]
+		)
+	);
+
+	// bounding quad of primitive
+	Vec2 vertices[VERTICES_PER_TRIANGLE];
+	float xMin = +INFINITY;
+	float xMax = -INFINITY;
+	float yMin = +INFINITY;
+	float yMax = -INFINITY;
+	for (size_t v = 0; v < VERTICES_PER_TRIANGLE; ++v)
+	{
+		copy_Vec4_To_Vec2(
+			vertices + v, &setup->primitive.vertices[v].gl_Position
+		);
+		xMin = fminf(xMin, vertices[v].data[0]);
+		xMax = fmaxf(xMax, vertices[v].data[0]);
+		yMin = fminf(yMin, vertices[v].data[1]);
+		yMax = fmaxf(yMax, vertices[v].data[1]);
+	}
 
-	const FragmentShader fragmentShader = gpu_getActiveFragmentShader(gpu);
-	for (size_t y = yMinI; y < yMaxI; ++y)
+	// edge functions, normals of lines point inside of triangle
+	Vec3 lines[EDGES_PER_TRIANGLE];
+	gpu_computeTriangleLines(lines, vertices);
+	for (size_t edge = 0; edge < EDGES_PER_TRIANGLE; ++edge)
 	{
-		Vec2 pixelCoord;
-		pixelCoord.data[1] = (float) y + PIXEL_CENTER;
-		float xMin, xMax;
-		gpu_computeLineBorders(&xMin, &xMax, pixelCoord.data[1], triangleLines);
+		const size_t opposite = (edge + 2) % VERTICES_PER_TRIANGLE;
+		const float distance =
+			distanceTo2DLine(lines + edge, vertices + opposite);
+		// degenerate or clockwise triangle (also NaN lines)
+		if (!(distance > 0.f))
+		{ return 0; }
+		multiply_Vec3_Float(setup->edges + edge, lines + edge, 1.f / distance);
+		if (setup->fixedPoint)
+		{ continue; }
+
+		// left edge or top edge (row 0 is at the bottom of screen)
+		const float a = lines[edge].data[0];
+		const float b = lines[edge].data[1];
+		setup->topLeft[edge] = a > 0.f || (a == 0.f && b < 0.f);
+	}
 
+	// bounding box of fixed-point triangle is computed exactly
+	if (!setup->fixedPoint)
+	{
 		if (xMin < 0.f)
 		{ xMin = 0.f; }
 		if (xMax < 0.f)
 		{ xMax = 0.f; }
-		if (xMin >= xMax)
-		{ continue; }
+		if (yMin < 0.f)
+		{ yMin = 0.f; }
+		if (yMax < 0.f)
+		{ yMax = 0.f; }
+
+		setup->xMin = gpu_roundDownPixelCoord(xMin);
+		setup->xMax = gpu_roundUpPixelCoord(xMax);
+		setup->yMin = gpu_roundDownPixelCoord(yMin);
+		setup->yMax = gpu_roundUpPixelCoord(yMax);
+		if (setup->xMax >= width)
+		{ setup->xMax = width; }
+		if (setup->yMax >= height)
+		{ setup->yMax = height; }
+	}
+	if (setup->xMin >= setup->xMax || setup->yMin >= setup->yMax)
+	{ return 0; }
 
-		size_t xMinI = gpu_roundDownPixelCoord(xMin);
-		size_t xMaxI = gpu_roundUpPixelCoord(xMax);
-		if (xMaxI >= width)
-		{ xMaxI = width; }
+	gpu_setupAttributePlanes(setup);
 
-		for (size_t x = xMinI; x < xMaxI; ++x)
-		{
-			GPUFragmentShaderInput fragmentShaderInput;
-			GPUFragmentShaderOutput fragmentShaderOutput;
-			pixelCoord.data[0] = (float) x + PIXEL_CENTER;
-			Vec3 barycentrics;
-			gpu_computeScreenSpaceBarycentrics(
-				&barycentrics, &pixelCoord,
-				triangleVertices, triangleLines
-			);
-			gpu_createFragment(
-				&fragmentShaderInput, primitive, &barycentrics,
-				&pixelCoord
-			);
-			fragmentShaderOutput.depth = fragmentShaderInput.depth;
-			fragmentShader(&fragmentShaderOutput, &fragmentShaderInput, gpu);
+	return 1;
+}
 
-			gpu_clampFragmentColor(&fragmentShaderOutput);
 
-			gpu_perFragmentOperations(
-				gpu, &fragmentShaderOutput,
-				(size_t) pixelCoord.data[0],
-				(size_t) pixelCoord.data[1]
-			);
+/**
+ * @brief This function decides whether triangle with fixed-point coords cannot
+ * cover any sample.
+ *
+ * @param x fixed-point x coords of vertices
+ * @param y fixed-point y coords of vertices
+ * @param width width of viewport
+ * @param height height of viewport
+ * @param statistics statistics of draw call
+ *
+ * @return 1 if triangle is rejected, otherwise 0
+ */
+static int gpu_rejectFixedPointTriangle(
+	const int64_t x[VERTICES_PER_TRIANGLE],
+	const int64_t y[VERTICES_PER_TRIANGLE],
+	const size_t width, const size_t height,
+	PipelineStatistics *const statistics
+)
+{
+	const int64_t area =
+		(x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (area == 0)
+	{
+		statistics->nofDegenerateTriangles++;
+		return 1;
+	}
+
+	int64_t xMin = x[0];
+	int64_t xMax = x[0];
+	int64_t yMin = y[0];
+	int64_t yMax = y[0];
+	for (size_t v = 1; v < VERTICES_PER_TRIANGLE; ++v)
+	{
+		xMin = x[v] < xMin ? x[v] : xMin;
+		xMax = x[v] > xMax ? x[v] : xMax;
+		yMin = y[v] < yMin ? y[v] : yMin;
+		yMax = y[v] > yMax ? y[v] : yMax;
+	}
+	const size_t xFirst = gpu_fixedPointFirstPixel(xMin);
+	const size_t yFirst = gpu_fixedPointFirstPixel(yMin);
+	size_t xEnd = gpu_fixedPointEndPixel(xMax);
+	size_t yEnd = gpu_fixedPointEndPixel(yMax);
+	if (xEnd >= width)
+	{ xEnd = width; }
+	if (yEnd >= height)
+	{ yEnd = height; }
+	if (xFirst >= xEnd || yFirst >= yEnd)
+	{
+		statistics->nofEmptyTriangles++;
+		return 1;
+	}
+	if (xEnd - xFirst > 1 || yEnd - yFirst > 1)
+	{ return 0; }
+
+	// sub-pixel triangle, the only candidate sample is tested with the same
+	// fill rule as setup (clockwise triangle has reversed edges)
+	statistics->nofSubPixelTriangles++;
+	const int64_t sign = area > 0 ? 1 : -1;
+	const int64_t centerX = (int64_t) xFirst * SUBPIXEL_SCALE + SUBPIXEL_HALF;
+	const int64_t centerY = (int64_t) yFirst * SUBPIXEL_SCALE + SUBPIXEL_HALF;
+	for (size_t edge = 0; edge < EDGES_PER_TRIANGLE; ++edge)
+	{
+		const size_t i = edge;
+		const size_t j = (edge + 1) % VERTICES_PER_TRIANGLE;
+		const int64_t a = sign * (y[i] - y[j]);
+		const int64_t b = sign * (x[j] - x[i]);
+		const int64_t c = -a * x[i] - b * y[i];
+		const int topLeft = a > 0 || (a == 0 && b < 0);
+		if (a * centerX + b * centerY + c - !topLeft < 0)
+		{
+			statistics->nofSubPixelRejectedTriangles++;
+			return 1;
 		}
 	}
+	return 0;
 }
 
 
-void cpu_drawTriangles(const GPU gpu, const size_t nofVertices)
+int gpu_rejectTriangle(
+	const Vec2 positions[VERTICES_PER_TRIANGLE],
+	const size_t width, const size_t height, const int fixedPoint,
+	PipelineStatistics *const statistics
+)
 {
-	const GPUVertexPullerConfiguration *const puller =
-		gpu_getActiveVertexPuller(gpu);
-	const VertexShader vertexShader = gpu_getActiveVertexShader(gpu);
-	const size_t width = gpu_getViewportWidth(gpu);
-	const size_t height = gpu_getViewportHeight(gpu);
+	assert(positions != NULL);
+	assert(statistics != NULL);
 
-	// loop over all triangles
-	for (size_t base = 0; base + VERTICES_PER_TRIANGLE - 1 < nofVertices;
-		base += VERTICES_PER_TRIANGLE)
+	int inRange = fixedPoint;
+	for (size_t v = 0; v < VERTICES_PER_TRIANGLE && inRange; ++v)
 	{
-		GPUPrimitive primitive;
-		gpu_initPrimitive(&primitive, gpu);
-		// assembly primitive
-		gpu_runPrimitiveAssembly(
-			gpu, &primitive, VERTICES_PER_TRIANGLE, puller, base, vertexShader
-		);
-
-		// perform primitive clipping
-		GPUTriangle triangle;
-		gpu_initTriangle(&triangle, &primitive);
-		GPUTriangleList clippedTriangles;
-		gpu_runTriangleClipping(&clippedTriangles, &triangle);
-
-		// draw sub primitives
-		for (size_t c = 0; c < clippedTriangles.nofTriangles; ++c)
+		inRange = fabsf(positions[v].data[0]) < FIXED_POINT_MAX_COORD
+			&& fabsf(positions[v].data[1]) < FIXED_POINT_MAX_COORD;
+	}
+	if (inRange)
+	{
+		int64_t x[VERTICES_PER_TRIANGLE];
+		int64_t y[VERTICES_PER_TRIANGLE];
+		for (size_t v = 0; v < VERTICES_PER_TRIANGLE; ++v)
 		{
-			// create sub primitive using clipped triangle and
-			// original primitive
-			GPUPrimitive subPrimitive;
-			gpu_createSubPrimitive(
-				&subPrimitive, &primitive,
-				clippedTriangles.triangles + c
+			x[v] = (int64_t) llrintf(
+				positions[v].data[0] * (float) SUBPIXEL_SCALE
+			);
+			y[v] = (int64_t) llrintf(
+				positions[v].data[1] * (float) SUBPIXEL_SCALE
 			);
-			gpu_runPerspectiveDivision(&subPrimitive);
-			gpu_runViewportTransformation(&subPrimitive, width, height);
-			gpu_rasterizeTriangle(gpu, &subPrimitive, width, height);
 		}
+		return gpu_rejectFixedPointTriangle(x, y, width, height, statistics);
 	}
+
+	const float *const a = positions[0].data;
+	const float *const b = positions[1].data;
+	const float *const c = positions[2].data;
+	const float area = (b[0] - a[0]) * (c[1] - a[1])
+		- (c[0] - a[0]) * (b[1] - a[1]);
+	if (area == 0.f)
+	{
+		statistics->nofDegenerateTriangles++;
+		return 1;
+	}
+	// invalid triangles are left to setup
+	if (!isfinite(area))
+	{ return 0; }
+
+	// the same bounding box as floating-point setup
+	const float xMin = fmaxf(fminf(a[0], fminf(b[0], c[0])), 0.f);
+	const float xMax = fmaxf(fmaxf(a[0], fmaxf(b[0], c[0])), 0.f);
+	const float yMin = fmaxf(fminf(a[1], fminf(b[1], c[1])), 0.f);
+	const float yMax = fmaxf(fmaxf(a[1], fmaxf(b[1], c[1])), 0.f);
+	size_t xEnd = gpu_roundUpPixelCoord(xMax);
+	size_t yEnd = gpu_roundUpPixelCoord(yMax);
+	if (xEnd >= width)
+	{ xEnd = width; }
+	if (yEnd >= height)
+	{ yEnd = height; }
+	if (gpu_roundDownPixelCoord(xMin) >= xEnd
+		|| gpu_roundDownPixelCoord(yMin) >= yEnd)
+	{
+		statistics->nofEmptyTriangles++;
+		return 1;
+	}
+	return 0;
+}
+
+
+/**
+ * @brief This function computes coverage mask of quad using fixed-point edge
+ * functions.
+ *
+ * @param setup fixed-point triangle setup
+ * @param x x coord of lower left pixel of quad
+ * @param y y coord of lower left pixel of quad
+ *
+ * @return coverage mask of quad
+ */
+static unsigned gpu_computeFixedPointCoverage(
+	const GPUTriangleSetup *const setup, const size_t x, const size_t y
+)
+{
+	const int64_t centerX = (int64_t) x * SUBPIXEL_SCALE + SUBPIXEL_HALF;
+	const int64_t centerY = (int64_t) y * SUBPIXEL_SCALE + SUBPIXEL_HALF;
+	unsigned mask = QUAD_FULL_MASK;
+	for (size_t edge = 0; edge < EDGES_PER_TRIANGLE; ++edge)
+	{
+		const int64_t *const e = setup->fixedEdges[edge];
+		const int64_t value = e[0] * centerX + e[1] * centerY + e[2];
+		const int64_t stepX = e[0] * SUBPIXEL_SCALE;
+		const int64_t stepY = e[1] * SUBPIXEL_SCALE;
+		if (value < 0)
+		{ mask &= ~1u; }
+		if (value + stepX < 0)
+		{ mask &= ~2u; }
+		if (value + stepY < 0)
+		{ mask &= ~4u; }
+		if (value + stepX + stepY < 0)
+		{ mask &= ~8u; }
+	}
+	return mask;
+}
+
+
+/**
+ * @brief This function shades covered lanes of fragment quad.
+ *
+ * @param gpu GPU handle
+ * @param quad fragment quad created by rasterization kernel
+ * @param fragmentShader active fragment shader
+ */
+static void gpu_shadeQuad(
+	const GPU gpu, GPUFragmentQuad *const quad,
+	const FragmentShader fragmentShader
+)
+{
+	for (size_t lane = 0; lane < FRAGMENTS_PER_QUAD; ++lane)
+	{
+		if (!(quad->mask & (1u << lane)))
+		{ continue; }
+		quad->outputs[lane].depth = quad->inputs[lane].depth;
+		quad->outputs[lane].discard = 0;
+		fragmentShader(quad->outputs + lane, quad->inputs + lane, gpu);
+		gpu_clampFragmentColor(quad->outputs + lane);
+	}
+}
+
+
+void gpu_initRasterizationState(
+	GPURasterizationState *const state, const GPU gpu
+)
+{
+	assert(state != NULL);
+
+	state->fragmentShader = gpu_getActiveFragmentShader(gpu);
+	state->kernel = gpu_getRasterizationKernel();
+	state->fixedPoint = gpu_isEnabled(gpu, FIXED_POINT_RASTERIZATION);
+	// interpolated depth is not depth of fragment that is written by shader
+	state->hierarchicalDepth = gpu_isEnabled(gpu, HIERARCHICAL_DEPTH_TEST)
+		&& !(gpu_getFragmentShaderEffects(gpu) & FRAGMENT_WRITES_DEPTH);
+	state->earlyDepthTest = gpu_isEarlyDepthTestActive(gpu);
+}
+
+
+/**
+ * @brief This function performs depth test of covered lanes of fragment quad
+ * before fragment shader. Lanes that fail depth test are removed from
+ * coverage mask.
+ *
+ * @param gpu GPU handle
+ * @param quad fragment quad with fragment inputs
+ */
+static void gpu_earlyDepthTest(const GPU gpu, GPUFragmentQuad *const quad)
+{
+	const size_t width = gpu_getViewportWidth(gpu);
+	const float *const depthBuffer =
+		gpu_getDepthBuffer(gpu) + quad->y * width + quad->x;
+	for (size_t lane = 0; lane < FRAGMENTS_PER_QUAD; ++lane)
+	{
+		const size_t pixel = (lane / QUAD_SIZE) * width + lane % QUAD_SIZE;
+		if ((quad->mask & (1u << lane))
+			&& !(quad->inputs[lane].depth < depthBuffer[pixel]))
+		{ quad->mask &= ~(1u << lane); }
+	}
+}
+
+
+/**
+ * @brief This function tests whether depth lies behind all tiles of level of
+ * hierarchical depth buffer that overlap screen region.
+ *
+ * @param gpu GPU handle
+ * @param depth the nearest depth
+ * @param tileSize tile size of level of hierarchical depth buffer
+ * @param xMin first pixel column of region
+ * @param yMin first pixel row of region
+ * @param xMax pixel column after region
+ * @param yMax pixel row after region
+ *
+ * @return 1 if depth is occluded in whole region, otherwise 0
+ */
+static int gpu_isOccluded(
+	const GPU gpu, const float depth, const size_t tileSize,
+	const size_t xMin, const size_t yMin, const size_t xMax, const size_t yMax
+)
+{
+	const float *const tiles = gpu_getHierarchicalDepth(gpu, tileSize);
+	const size_t nofTilesX =
+		(gpu_getViewportWidth(gpu) + tileSize - 1) / tileSize;
+	for (size_t ty = yMin / tileSize; ty <= (yMax - 1) / tileSize; ++ty)
+	{
+		for (size_t tx = xMin / tileSize; tx <= (xMax - 1) / tileSize; ++tx)
+		{
+			if (!(depth >= tiles[ty * nofTilesX + tx]))
+			{ return 0; }
+		}
+	}
+	return 1;
+}
+
+
+void gpu_rasterizeTriangleRegion(
+	const GPU gpu, const GPUTriangleSetup *const setup,
+	const GPURasterizationState *const state, const size_t xMin,
+	const size_t yMin, const size_t xMax, const size_t yMax
+)
+{
+	assert(setup != NULL);
+	assert(state != NULL);
+	assert(state->fragmentShader != NULL);
+	assert(state->kernel != NULL);
+	assert(state->kernel->nofQuads <= KERNEL_MAX_QUADS);
+
+	const GPURasterizationKernelInfo *const kernel = state->kernel;
+	const size_t yBegin = setup->yMin > yMin ? setup->yMin : yMin;
+	const size_t yEnd = setup->yMax < yMax ? setup->yMax : yMax;
+	const size_t xBegin = setup->xMin > xMin ? setup->xMin : xMin;
+	const size_t xEnd = setup->xMax < xMax ? setup->xMax : xMax;
+	if (yBegin >= yEnd || xBegin >= xEnd)
+	{ return; }
+
+	// whole triangle lies behind already rasterized geometry
+	const float *fineDepths = NULL;
+	size_t nofFineTilesX = 0;
+	if (state->hierarchicalDepth)
+	{
+		if (gpu_isOccluded(
+			gpu, setup->minDepth, HIZ_COARSE_TILE_SIZE, xBegin, yBegin, xEnd,
+			yEnd
+		))
+		{ return; }
+		fineDepths = gpu_getHierarchicalDepth(gpu, HIZ_FINE_TILE_SIZE);
+		nofFineTilesX = (gpu_getViewportWidth(gpu) + HIZ_FINE_TILE_SIZE - 1)
+			/ HIZ_FINE_TILE_SIZE;
+	}
+
+	// quads are aligned to even pixel coords
+	const size_t quadXBegin = xBegin - xBegin % QUAD_SIZE;
+	const size_t quadYBegin = yBegin - yBegin % QUAD_SIZE;
+	const size_t blockWidth = kernel->nofQuads * QUAD_SIZE;
+
+	// region of written depths
+	size_t writtenXMin = xEnd;
+	size_t writtenYMin = yEnd;
+	size_t writtenXMax = 0;
+	size_t writtenYMax = 0;
+
+	GPUFragmentQuad quads[KERNEL_MAX_QUADS];
+	for (size_t y = quadYBegin; y < yEnd; y += QUAD_SIZE)
+	{
+		// mask out rows of quads that lie outside of region
+		unsigned rowMask = QUAD_FULL_MASK;
+		if (y < yBegin)
+		{ rowMask &= ~QUAD_BOTTOM_ROW_MASK; }
+		if (y + 1 >= yEnd)
+		{ rowMask &= ~QUAD_TOP_ROW_MASK; }
+
+		for (size_t x = quadXBegin; x < xEnd; x += blockWidth)
+		{
+			// mask out columns of quads that lie outside of region and quads
+			// that lie behind hierarchical depth buffer
+			unsigned covered = 0;
+			for (size_t q = 0; q < kernel->nofQuads; ++q)
+			{
+				GPUFragmentQuad *const quad = quads + q;
+				quad->x = x + q * QUAD_SIZE;
+				quad->y = y;
+				quad->mask = rowMask;
+				if (quad->x < xBegin)
+				{ quad->mask &= ~QUAD_LEFT_COLUMN_MASK; }
+				if (quad->x >= xEnd)
+				{ quad->mask = 0; }
+				else if (quad->x + 1 >= xEnd)
+				{ quad->mask &= ~QUAD_RIGHT_COLUMN_MASK; }
+				if (fineDepths != NULL && quad->mask != 0
+					&& setup->minDepth >= fineDepths[
+						(quad->y / HIZ_FINE_TILE_SIZE) * nofFineTilesX
+						+ quad->x / HIZ_FINE_TILE_SIZE
+					])
+				{ quad->mask = 0; }
+				if (setup->fixedPoint && quad->mask != 0)
+				{
+					quad->mask &=
+						gpu_computeFixedPointCoverage(setup, quad->x, quad->y);
+				}
+				covered |= quad->mask;
+			}
+
+			if (covered == 0 || kernel->kernel(quads, setup) == 0)
+			{ continue; }
+			for (size_t q = 0; q < kernel->nofQuads; ++q)
+			{
+				if (state->earlyDepthTest && quads[q].mask != 0)
+				{ gpu_earlyDepthTest(gpu, quads + q); }
+				if (quads[q].mask == 0)
+				{ continue; }
+				gpu_shadeQuad(gpu, quads + q, state->fragmentShader);
+				if (gpu_perQuadOperations(gpu, quads + q) == 0)
+				{ continue; }
+
+				if (quads[q].x < writtenXMin)
+				{ writtenXMin = quads[q].x; }
+				if (quads[q].y < writtenYMin)
+				{ writtenYMin = quads[q].y; }
+				if (quads[q].x + QUAD_SIZE > writtenXMax)
+				{ writtenXMax = quads[q].x + QUAD_SIZE; }
+				if (quads[q].y + QUAD_SIZE > writtenYMax)
+				{ writtenYMax = quads[q].y + QUAD_SIZE; }
+			}
+		}
+	}
+
+	if (fineDepths != NULL && writtenXMin < writtenXMax)
+	{
+		gpu_updateHierarchicalDepth(
+			gpu, writtenXMin, writtenYMin, writtenXMax, writtenYMax
+		);
+	}
+}
+
+
+void gpu_rasterizeTriangle(
+	const GPU gpu, const GPUPrimitive *const primitive,
+	const GPURasterizationState *const state, const size_t width,
+	const size_t height
+)
+{
+	assert(primitive != NULL);
+	assert(state != NULL);
+
+	GPUTriangleSetup setup;
+	if (!gpu_setupTriangle(
+		&setup, primitive, width, height, state->fixedPoint
+	))
+	{ return; }
+
+	gpu_rasterizeTriangleRegion(gpu, &setup, state, 0, 0, width, height);
+}
+
+
+GPUTriangleSetup *gpu_appendTriangleSetup(GPUTriangleSetupList *const list)
+{
+	assert(list != NULL);
+
+	if (list->nofSetups == list->capacity)
+	{
+		list->capacity = list->capacity == 0 ? 64 : list->capacity * 2;
+		list->setups = (GPUTriangleSetup *) gpu_reallocate(
+			list->setups, list->capacity * sizeof(GPUTriangleSetup)
+		);
+	}
+	return list->setups + list->nofSetups++;
+}
+
+
+void gpu_binTriangles(
+	GPUTileBins *const bins, const GPUTriangleSetupList *const list,
+	const size_t width, const size_t height
+)
+{
+	assert(bins != NULL);
+	assert(list != NULL);
+
+	bins->nofTilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	bins->nofTilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+	const size_t nofTiles = bins->nofTilesX * bins->nofTilesY;
+	bins->offsets =
+		(size_t *) gpu_reallocate(NULL, (nofTiles + 1) * sizeof(size_t));
+	for (size_t t = 0; t <= nofTiles; ++t)
+	{
+		bins->offsets[t] = 0;
+	}
+
+	// count triangles in every tile
+	for (size_t i = 0; i < list->nofSetups; ++i)
+	{
+		const GPUTriangleSetup *const setup = list->setups + i;
+		for (size_t ty = setup->yMin / TILE_SIZE;
+			ty <= (setup->yMax - 1) / TILE_SIZE; ++ty)
+		{
+			for (size_t tx = setup->xMin / TILE_SIZE;
+				tx <= (setup->xMax - 1) / TILE_SIZE; ++tx)
+			{
+				bins->offsets[ty * bins->nofTilesX + tx + 1]++;
+			}
+		}
+	}
+	for (size_t t = 0; t < nofTiles; ++t)
+	{
+		bins->offsets[t + 1] += bins->offsets[t];
+	}
+
+	// fill tiles, triangles stay in submission order
+	bins->triangles = (size_t *) gpu_reallocate(
+		NULL, bins->offsets[nofTiles] * sizeof(size_t)
+	);
+	size_t *const cursors =
+		(size_t *) gpu_reallocate(NULL, (nofTiles + 1) * sizeof(size_t));
+	for (size_t t = 0; t < nofTiles; ++t)
+	{
+		cursors[t] = bins->offsets[t];
+	}
+	for (size_t i = 0; i < list->nofSetups; ++i)
+	{
+		const GPUTriangleSetup *const setup = list->setups + i;
+		for (size_t ty = setup->yMin / TILE_SIZE;
+			ty <= (setup->yMax - 1) / TILE_SIZE; ++ty)
+		{
+			for (size_t tx = setup->xMin / TILE_SIZE;
+				tx <= (setup->xMax - 1) / TILE_SIZE; ++tx)
+			{
+				bins->triangles[cursors[ty * bins->nofTilesX + tx]++] = i;
+			}
+		}
+	}
+	free(cursors);
+}
+
+
+void gpu_freeTileBins(GPUTileBins *const bins)
+{
+	assert(bins != NULL);
+
+	free(bins->offsets);
+	free(bins->triangles);
+	bins->offsets = NULL;
+	bins->triangles = NULL;
+}
+
+
+/**
+ * @brief This structure contains everything that is needed for rasterization
+ * of one tile.
+ */
+typedef struct GPUTileRasterization
+{
+	GPU gpu; ///<GPU handle
+	const GPUTriangleSetupList *list; ///<triangle setups
+	const GPUTileBins *bins; ///<binned triangles
+	const GPURasterizationState *state; ///<rasterization state of draw call
+	size_t width; ///<screen width in pixels
+	size_t height; ///<screen height in pixels
+} GPUTileRasterization;
+
+
+/**
+ * @brief This function rasterizes all triangles binned into one tile.
+ * It is executed as GPU task.
+ *
+ * @param data tile rasterization (GPUTileRasterization)
+ * @param tile index of tile
+ * @param thread index of thread
+ */
+static void gpu_rasterizeTile(
+	void *const data, const size_t tile, const size_t thread
+)
+{
+	(void) thread;
+	const GPUTileRasterization *const r = (const GPUTileRasterization *) data;
+	const size_t xMin = (tile % r->bins->nofTilesX) * TILE_SIZE;
+	const size_t yMin = (tile / r->bins->nofTilesX) * TILE_SIZE;
+	const size_t xMax = xMin + TILE_SIZE < r->width
+		? xMin + TILE_SIZE : r->width;
+	const size_t yMax = yMin + TILE_SIZE < r->height
+		? yMin + TILE_SIZE : r->height;
+
+	for (size_t i = r->bins->offsets[tile]; i < r->bins->offsets[tile + 1];
+		++i)
+	{
+		gpu_rasterizeTriangleRegion(
+			r->gpu, r->list->setups + r->bins->triangles[i],
+			r->state, xMin, yMin, xMax, yMax
+		);
+	}
+}
+
+
+void gpu_rasterizeTiles(
+	const GPU gpu, const GPUTriangleSetupList *const list,
+	const GPUTileBins *const bins, const GPURasterizationState *const state,
+	const size_t width, const size_t height
+)
+{
+	assert(list != NULL);
+	assert(bins != NULL);
+	assert(state != NULL);
+
+	GPUTileRasterization rasterization = {
+		.gpu = gpu,
+		.list = list,
+		.bins = bins,
+		.state = state,
+		.width = width,
+		.height = height,
+	};
+	gpu_runTasks(
+		gpu, bins->nofTilesX * bins->nofTilesY, gpu_rasterizeTile,
+		&rasterization
+	);
+}
+
+
+/**
+ * @brief This structure contains state of draw call that is resolved once
+ * for all draw commands and outputs of draw call.
+ */
+typedef struct GPUDrawState
+{
+	GPU gpu; ///<GPU handle
+	size_t width; ///<screen width in pixels
+	size_t height; ///<screen height in pixels
+	int tiled; ///<triangles are set up for binning
+	GPURasterizationState rasterization; ///<rasterization state of draw call
+	CullFaceMode cullFace; ///<cull face mode
+	FrontFace frontFace; ///<winding of front-facing triangles
+	Vec4 clipPlanes[MAX_USER_CLIP_PLANES]; ///<enabled user clip planes
+	size_t nofClipPlanes; ///<number of enabled user clip planes
+	GPUClipKernel clipKernel; ///<kernel that classifies triangle batches
+	GPUTriangleSetupList setups; ///<set up triangles of tiled rasterization
+	PipelineStatistics statistics; ///<counters of draw call
+} GPUDrawState;
+
+
+/**
+ * @brief This function rejects and culls one triangle in screen-space and
+ * rasterizes it or sets it up for tiled rasterization.
+ *
+ * @param state draw state
+ * @param primitive triangle after perspective division and viewport
+ * transformation
+ */
+static void gpu_drawScreenTriangle(
+	GPUDrawState *const state, const GPUPrimitive *const primitive
+)
+{
+	const size_t width = state->width;
+	const size_t height = state->height;
+
+	// reject triangles that cannot cover any sample before they are set up
+	Vec2 positions[VERTICES_PER_TRIANGLE];
+	for (size_t v = 0; v < VERTICES_PER_TRIANGLE; ++v)
+	{
+		copy_Vec4_To_Vec2(positions + v, &primitive->vertices[v].gl_Position);
+	}
+	if (gpu_rejectTriangle(
+		positions, width, height, state->rasterization.fixedPoint,
+		&state->statistics
+	))
+	{ return; }
+
+	if (gpu_isTriangleCulled(primitive, state->cullFace, state->frontFace))
+	{
+		state->statistics.nofCulledTriangles++;
+		return;
+	}
+	if (!state->tiled)
+	{
+		gpu_rasterizeTriangle(
+			state->gpu, primitive, &state->rasterization, width, height
+		);
+		return;
+	}
+
+	// set up triangle once, it is rasterized after binning
+	GPUTriangleSetup *const setup = gpu_appendTriangleSetup(&state->setups);
+	if (!gpu_setupTriangle(
+		setup, primitive, width, height, state->rasterization.fixedPoint
+	))
+	{
+		state->setups.nofSetups--;
+	}
+}
+
+
+/**
+ * @brief This function creates vertex of clipped polygon and transforms it
+ * to screen-space.
+ *
+ * @param state draw state
+ * @param vertex output vertex
+ * @param primitive original primitive
+ * @param polygon clipped polygon
+ * @param index index of vertex of polygon
+ */
+static void gpu_createScreenVertex(
+	const GPUDrawState *const state, GPUVertexShaderOutput *const vertex,
+	const GPUPrimitive *const primitive, const GPUClipPolygon *const polygon,
+	const size_t index
+)
+{
+	gpu_createClippedVertex(
+		vertex, primitive, polygon->positions + index, polygon->coords + index
+	);
+
+	// the same operations as gpu_runPerspectiveDivision() and
+	// gpu_runViewportTransformation()
+	Vec4 *const position = &vertex->gl_Position;
+	const float invDivisor = 1.f / position->data[3];
+	for (size_t k = 0; k < 3; ++k)
+	{ position->data[k] *= invDivisor; }
+	position->data[0] = (position->data[0] * .5f + .5f) * (float) state->width;
+	position->data[1] =
+		(position->data[1] * .5f + .5f) * (float) state->height;
+}
+
+
+/**
+ * @brief This function clips, rejects and culls assembled primitive and
+ * rasterizes it or sets it up for tiled rasterization.
+ * Clip outcodes of vertices and user clip plane masks decide whether
+ * primitive is trivially rejected, trivially accepted or clipped.
+ * Trivially accepted primitive is transformed to screen-space in place.
+ *
+ * @param state draw state
+ * @param primitive assembled primitive, it is modified
+ * @param outsideAll user clip planes that reject primitive
+ * @param outsideAny user clip planes that are crossed by primitive
+ */
+static void gpu_drawPrimitive(
+	GPUDrawState *const state, GPUPrimitive *const primitive,
+	const unsigned outsideAll, const unsigned outsideAny
+)
+{
+	const unsigned *const outcodes = primitive->outcodes;
+	// all vertices lie outside of the same frustum or user clip plane
+	if ((outcodes[0] & outcodes[1] & outcodes[2] & FRUSTUM_OUTCODES)
+		|| outsideAll != 0)
+	{ return; }
+
+	const unsigned crossed = outcodes[0] | outcodes[1] | outcodes[2];
+	// x/y planes inside of guard band are clipped by rasterization bounds,
+	// far plane is clipped only by trivial reject
+	if (!(crossed & (FRUSTUM_OUTCODE(NEAR) | GUARD_BAND_OUTCODES))
+		&& outsideAny == 0)
+	{
+		// unclipped primitive is passed through without sub primitive
+		state->statistics.nofClippedTriangles++;
+		gpu_runPerspectiveDivision(primitive);
+		gpu_runViewportTransformation(primitive, state->width, state->height);
+		gpu_drawScreenTriangle(state, primitive);
+		return;
+	}
+
+	// perform primitive clipping, near plane is clipped if it is crossed,
+	// x/y planes only if their guard band is crossed
+	unsigned planes = crossed & FRUSTUM_OUTCODE(NEAR);
+	for (FrustumPlane plane = LEFT; plane <= TOP; ++plane)
+	{
+		if (crossed & GUARD_BAND_OUTCODE(plane))
+		{ planes |= FRUSTUM_OUTCODE(plane); }
+	}
+	GPUTriangle triangle;
+	gpu_initTriangle(&triangle, primitive);
+	GPUClipPolygon polygon;
+	gpu_runTriangleClipping(&polygon, &triangle, planes);
+	for (size_t p = 0; p < state->nofClipPlanes && polygon.nofVertices != 0;
+		++p)
+	{
+		if (outsideAny & (1u << p))
+		{ gpu_clipPolygon(&polygon, state->clipPlanes + p); }
+	}
+	if (polygon.nofVertices < VERTICES_PER_TRIANGLE)
+	{ return; }
+	const size_t nofTriangles = polygon.nofVertices - 2;
+	state->statistics.nofClippedTriangles += nofTriangles;
+
+	// draw sub primitives, polygon is fan-triangulated, so every vertex of
+	// polygon is created once and the last vertex of triangle is shared with
+	// the next one
+	GPUPrimitive subPrimitive;
+	subPrimitive.nofUsedVertices = VERTICES_PER_TRIANGLE;
+	memcpy(subPrimitive.types, primitive->types, sizeof(subPrimitive.types));
+	memcpy(
+		subPrimitive.interpolations, primitive->interpolations,
+		sizeof(subPrimitive.interpolations)
+	);
+	gpu_createScreenVertex(state, subPrimitive.vertices, primitive, &polygon, 0);
+	gpu_createScreenVertex(
+		state, subPrimitive.vertices + 2, primitive, &polygon, 1
+	);
+	for (size_t c = 0; c < nofTriangles; ++c)
+	{
+		subPrimitive.vertices[1] = subPrimitive.vertices[2];
+		gpu_createScreenVertex(
+			state, subPrimitive.vertices + 2, primitive, &polygon, c + 2
+		);
+		gpu_drawScreenTriangle(state, &subPrimitive);
+	}
+}
+
+
+/**
+ * @brief This function draws batch of assembled primitives.
+ * If user clip planes are enabled, clip kernel classifies all primitives of
+ * batch at once and only primitives that cross some plane are clipped.
+ *
+ * @param state draw state
+ * @param primitives assembled primitives, they are modified
+ * @param nofPrimitives number of primitives (at most CLIP_BATCH_SIZE)
+ */
+static void gpu_drawPrimitiveBatch(
+	GPUDrawState *const state, GPUPrimitive *const primitives,
+	const size_t nofPrimitives
+)
+{
+	assert(nofPrimitives <= CLIP_BATCH_SIZE);
+
+	unsigned outsideAll[CLIP_BATCH_SIZE] = {0};
+	unsigned outsideAny[CLIP_BATCH_SIZE] = {0};
+	if (state->nofClipPlanes != 0)
+	{
+		GPUClipBatch batch;
+		// lanes of unused triangles are classified too
+		if (nofPrimitives < CLIP_BATCH_SIZE)
+		{ memset(&batch, 0, sizeof(batch)); }
+		batch.nofTriangles = nofPrimitives;
+		for (size_t t = 0; t < nofPrimitives; ++t)
+		{
+			for (size_t v = 0; v < VERTICES_PER_TRIANGLE; ++v)
+			{
+				for (size_t c = 0; c < 4; ++c)
+				{
+					batch.positions[c][v][t] =
+						primitives[t].vertices[v].gl_Position.data[c];
+				}
+			}
+		}
+		state->clipKernel(
+			outsideAll, outsideAny, &batch, state->clipPlanes,
+			state->nofClipPlanes
+		);
+	}
+
+	for (size_t t = 0; t < nofPrimitives; ++t)
+	{
+		gpu_drawPrimitive(
+			state, primitives + t, outsideAll[t], outsideAny[t]
+		);
+	}
+}
+
+
+/**
+ * @brief This function checks that draw command reads only indices of index
+ * buffer and that all its gl_VertexIDs are representable, invalid command is
+ * reported.
+ *
+ * @param fetch compiled vertex fetch
+ * @param command draw command
+ * @param nofIndices number of indices of index buffer
+ *
+ * @return 1 if command is valid, otherwise 0
+ */
+static int gpu_isDrawCommandValid(
+	const GPUVertexFetch *const fetch,
+	const DrawTrianglesCommand *const command, const size_t nofIndices
+)
+{
+	if (command->count > SIZE_MAX - command->first
+		|| (fetch->indices != NULL
+			&& command->first + command->count > nofIndices))
+	{
+		fprintf(
+			stderr, "ERROR: draw command: vertices [%zu, %zu + %zu) do not "
+			"fit into %zu indices\n", command->first, command->first,
+			command->count, nofIndices
+		);
+		return 0;
+	}
+
+	// consecutive vertices are checked by their bounds
+	const size_t nofChecked = fetch->indices == NULL ? 1 : command->count;
+	const ptrdiff_t baseVertex = command->baseVertex;
+	for (size_t i = 0; i < nofChecked; ++i)
+	{
+		VertexIndex index = gpu_computeGLVertexID(
+			fetch->indices, fetch->indexSize, command->first + i
+		);
+		if (fetch->primitiveRestart && index == fetch->restartIndex)
+		{ continue; }
+		if (fetch->indices == NULL && baseVertex > 0)
+		{ index += command->count - 1; }
+		if ((baseVertex < 0 && index < (VertexIndex) -baseVertex)
+			|| (baseVertex > 0 && index > SIZE_MAX - (VertexIndex) baseVertex))
+		{
+			fprintf(
+				stderr, "ERROR: draw command: index %zu with base vertex %td "
+				"is out of range\n", index, baseVertex
+			);
+			return 0;
+		}
+	}
+	return 1;
+}
+
+
+/**
+ * @brief This function draws array of draw commands.
+ * State of GPU (vertex puller, shaders, capabilities and attribute types) is
+ * resolved once for all commands, triangles of all commands are binned and
+ * rasterized together.
+ *
+ * @param gpu GPU handle
+ * @param commands the first draw command
+ * @param nofCommands number of draw commands
+ * @param stride distance between draw commands in bytes
+ */
+static void gpu_drawTriangleCommands(
+	const GPU gpu, const uint8_t *const commands, const size_t nofCommands,
+	const size_t stride
+)
+{
+	const GPUVertexPullerConfiguration *const puller =
+		gpu_getActiveVertexPuller(gpu);
+	const VertexShader vertexShader = gpu_getActiveVertexShader(gpu);
+	const BatchedVertexShader batchedVertexShader =
+		gpu_getActiveBatchedVertexShader(gpu);
+	const PrimitiveTopology topology = gpu_getPrimitiveTopology(gpu);
+	const int parallelVertexShading =
+		gpu_isEnabled(gpu, PARALLEL_VERTEX_SHADING);
+	GPUDrawState state = {
+		.gpu = gpu,
+		.width = gpu_getViewportWidth(gpu),
+		.height = gpu_getViewportHeight(gpu),
+		.tiled = gpu_isEnabled(gpu, TILED_RASTERIZATION),
+		.cullFace = gpu_getCullFace(gpu),
+		.frontFace = gpu_getFrontFace(gpu),
+		.clipKernel = gpu_getClipKernel()->kernel,
+		.setups = {NULL, 0, 0},
+	};
+	// fragment shader, kernel and capabilities are resolved once per draw
+	gpu_initRasterizationState(&state.rasterization, gpu);
+	state.nofClipPlanes = gpu_getClipPlanes(gpu, state.clipPlanes);
+	memset(&state.statistics, 0, sizeof(state.statistics));
+	state.statistics.nofDrawCalls = nofCommands;
+
+	// the whole draw call is skipped before any vertex is pulled
+	if (gpu_isEnabled(gpu, BOUNDING_VOLUME_CULLING) && puller->bounded
+		&& gpu_isBoundingBoxOutsideFrustum(
+			gpu_getCullingMatrix(gpu), puller->boundingBoxMin,
+			puller->boundingBoxMax
+		))
+	{
+		state.statistics.nofCulledDrawCalls = nofCommands;
+		gpu_addPipelineStatistics(gpu, &state.statistics);
+		return;
+	}
+
+	// vertex fetch is compiled once for all commands
+	GPUVertexFetch fetch;
+	gpu_compileVertexFetch(
+		&fetch, puller, 0, gpu_isEnabled(gpu, PRIMITIVE_RESTART),
+		gpu_getPrimitiveRestartIndex(gpu)
+	);
+	const size_t nofIndices = gpu_getNofIndices(gpu);
+	// attribute types and interpolations are shared by all primitives,
+	// primitives are assembled into batches that are clipped at once
+	GPUPrimitive primitives[CLIP_BATCH_SIZE];
+	for (size_t p = 0; p < CLIP_BATCH_SIZE; ++p)
+	{ gpu_initPrimitive(primitives + p, gpu); }
+	size_t nofPrimitives = 0;
+
+	for (size_t d = 0; d < nofCommands; ++d)
+	{
+		DrawTrianglesCommand command;
+		memcpy(&command, commands + d * stride, sizeof(command));
+		if (command.count == 0 || command.instanceCount == 0
+			|| !gpu_isDrawCommandValid(&fetch, &command, nofIndices))
+		{ continue; }
+
+		// range of command is validated once for all instances
+		gpu_setVertexFetchRange(
+			&fetch, command.first, command.count, command.baseVertex
+		);
+		gpu_validateVertexFetch(gpu, fetch.nofVertexIDs, command.instanceCount);
+		// batched vertex shader reads attributes without per-fetch checks
+		const BatchedVertexShader commandShader =
+			batchedVertexShader != NULL
+				&& gpu_canShadeVertexBatches(gpu, &fetch)
+			? batchedVertexShader : NULL;
+		if (commandShader == NULL && vertexShader == NULL)
+		{
+			fprintf(
+				stderr, "ERROR: vertex puller heads cannot be pulled by "
+				"batched vertex shader and program does not have vertex "
+				"shader\n"
+			);
+			continue;
+		}
+		GPUVertexCache cache;
+		gpu_initVertexCache(
+			&cache, &fetch,
+			parallelVertexShading || commandShader != NULL
+				|| topology != TOPOLOGY_TRIANGLES
+		);
+
+		for (VertexIndex instance = 0; instance < command.instanceCount;
+			++instance)
+		{
+			// vertices are shaded again for every instance
+			gpu_setVertexFetchInstance(&fetch, instance);
+			if (instance > 0)
+			{ gpu_resetVertexCache(&cache); }
+			if (parallelVertexShading)
+			{
+				gpu_runParallelVertexShader(
+					gpu, &cache, &fetch, command.count, vertexShader,
+					commandShader
+				);
+			}
+			else if (commandShader != NULL)
+			{
+				gpu_runBatchedVertexShader(
+					gpu, &cache, &fetch, command.count, commandShader
+				);
+			}
+
+			// loop over all triangles
+			GPUPrimitiveAssembler assembler;
+			gpu_initPrimitiveAssembler(
+				&assembler, topology, &fetch, command.count
+			);
+			VertexShaderInvocation invocations[VERTICES_PER_TRIANGLE];
+			while (gpu_assembleTriangle(&assembler, invocations))
+			{
+				gpu_assembleCachedPrimitive(
+					gpu, primitives + nofPrimitives, VERTICES_PER_TRIANGLE,
+					&fetch, invocations, vertexShader, &cache
+				);
+				state.statistics.nofAssembledTriangles++;
+				if (++nofPrimitives == CLIP_BATCH_SIZE)
+				{
+					gpu_drawPrimitiveBatch(&state, primitives, nofPrimitives);
+					nofPrimitives = 0;
+				}
+			}
+		}
+
+		state.statistics.nofVertexShaderInvocations += cache.nofInvocations;
+		state.statistics.nofVertexCacheHits += cache.nofHits;
+		gpu_freeVertexCache(&cache);
+	}
+	// primitives are copied from cache, so the last batch is drawn at the end
+	gpu_drawPrimitiveBatch(&state, primitives, nofPrimitives);
+
+	if (state.tiled)
+	{
+		GPUTileBins bins;
+		gpu_binTriangles(&bins, &state.setups, state.width, state.height);
+		gpu_rasterizeTiles(
+			gpu, &state.setups, &bins, &state.rasterization, state.width,
+			state.height
+		);
+		gpu_freeTileBins(&bins);
+		free(state.setups.setups);
+	}
+
+	gpu_invalidateVertexFetch(gpu);
+	gpu_addPipelineStatistics(gpu, &state.statistics);
+}
+
+
+void cpu_drawTriangles(const GPU gpu, const size_t nofVertices)
+{
+	cpu_drawTrianglesInstanced(gpu, nofVertices, 1);
+}
+
+
+void cpu_drawTrianglesInstanced(
+	const GPU gpu, const size_t nofVertices, const size_t nofInstances
+)
+{
+	const DrawTrianglesCommand command = {
+		.count = nofVertices,
+		.instanceCount = nofInstances,
+		.first = 0,
+		.baseVertex = 0,
+	};
+	gpu_drawTriangleCommands(
+		gpu, (const uint8_t *) &command, 1, sizeof(command)
+	);
+}
+
+
+void cpu_multiDrawTriangles(
+	const GPU gpu, const DrawTrianglesCommand *const commands,
+	const size_t nofCommands
+)
+{
+	assert(commands != NULL || nofCommands == 0);
+
+	gpu_drawTriangleCommands(
+		gpu, (const uint8_t *) commands, nofCommands,
+		sizeof(DrawTrianglesCommand)
+	);
+}
+
+
+void cpu_drawTrianglesIndirect(
+	const GPU gpu, const BufferID buffer, const size_t offset,
+	const size_t nofCommands, const size_t stride
+)
+{
+	const size_t commandStride =
+		stride == 0 ? sizeof(DrawTrianglesCommand) : stride;
+	size_t size;
+	const uint8_t *const data =
+		(const uint8_t *) gpu_getBufferData(gpu, buffer, &size);
+	if (data == NULL)
+	{ return; }
+	// the last command has to lie inside of buffer
+	if (nofCommands != 0 && (offset > size
+		|| size - offset < sizeof(DrawTrianglesCommand)
+		|| (size - offset - sizeof(DrawTrianglesCommand)) / commandStride
+			< nofCommands - 1))
+	{
+		fprintf(
+			stderr, "ERROR: cpu_drawTrianglesIndirect(...): %zu commands at "
+			"offset %zu do not fit into buffer of %zu bytes\n", nofCommands,
+			offset, size
+		);
+		return;
+	}
+
+	gpu_drawTriangleCommands(gpu, data + offset, nofCommands, commandStride);
 }
@@ -11,9 +11,12 @@
 #pragma once
 
 
+#include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 #include <student/fwd.h>
+#include <student/gpu.h>
 #include <student/linearAlgebra.h>
 #include <student/program.h>
 #include <student/vertexPuller.h>
@@ -39,6 +42,8 @@ struct GPUPrimitive
 	AttributeType types[MAX_ATTRIBUTES];
 	///< interpolation types of vertex attributes
 	InterpolationType interpolations[MAX_ATTRIBUTES];
+	///< clip outcodes of vertices (see gpu_computeClipOutcode())
+	unsigned outcodes[VERTICES_PER_TRIANGLE];
 };
 
 /**
@@ -57,13 +62,204 @@ struct GPUTriangle
 };
 
 /**
- * @brief This structure represents triangle list - input and output of
- * clipping.
+ * @brief This structure represents convex polygon in clip-space - output of
+ * clipping. Triangle is clipped plane by plane in place (Sutherland-Hodgman)
+ * and the result is fan-triangulated.
+ * Barycentric coords are in respect to original triangle.
  */
-struct GPUTriangleList
+struct GPUClipPolygon
 {
-	GPUTriangle triangles[MAX_CLIPPED_TRIANGLES]; ///<triangle slots
-	size_t nofTriangles; ///<number of used triangle slots
+	Vec4 positions[MAX_CLIP_POLYGON_VERTICES]; ///<positions of vertices
+	///<barycentric coords of vertices with respect to original triangle
+	Vec3 coords[MAX_CLIP_POLYGON_VERTICES];
+	size_t nofVertices; ///<number of vertices, 0 if triangle is clipped away
+};
+
+
+/**
+ * @brief This structure represents vertex puller configuration compiled for
+ * one draw call. It contains only enabled heads with precomputed addresses of
+ * the first vertex, so fetch of vertex is one multiply-add per enabled head.
+ */
+struct GPUVertexFetch
+{
+	const void *indices; ///<indices to vertices, NULL without indexing
+	size_t indexSize; ///<size in bytes of one index
+	VertexShaderInvocation first; ///<index of the first vertex of draw
+	ptrdiff_t baseVertex; ///<value added to indices
+	VertexIndex firstVertexID; ///<the lowest fetched gl_VertexID
+	size_t nofVertexIDs; ///<the highest fetched gl_VertexID + 1
+	int primitiveRestart; ///<restart index is skipped, it ends primitive
+	VertexIndex restartIndex; ///<primitive restart index
+	VertexIndex gl_InstanceID; ///<fetched instance
+	size_t nofHeads; ///<number of enabled heads
+	size_t attributes[MAX_ATTRIBUTES]; ///<attribute indices of enabled heads
+	///<addresses of vertex 0 of heads in fetched instance
+	const uint8_t *bases[MAX_ATTRIBUTES];
+	size_t strides[MAX_ATTRIBUTES]; ///<vertex strides, 0 for instanced heads
+	const uint8_t *origins[MAX_ATTRIBUTES]; ///<addresses of instance 0 of heads
+	///<instance strides, 0 for heads that advance per vertex
+	size_t instanceStrides[MAX_ATTRIBUTES];
+	size_t divisors[MAX_ATTRIBUTES]; ///<instances that share one element (>= 1)
+};
+
+
+/**
+ * @brief This structure represents one draw command of multi-draw and
+ * indirect draw calls, it is laid out like record of indirect buffer.
+ */
+struct DrawTrianglesCommand
+{
+	size_t count; ///<number of vertices of one instance
+	size_t instanceCount; ///<number of instances
+	size_t first; ///<index of the first vertex (in indices if indexing is used)
+	ptrdiff_t baseVertex; ///<value added to indices to get gl_VertexID
+};
+
+
+/**
+ * @brief This structure assembles vertex shader invocations of draw call into
+ * triangles according to primitive topology and primitive restart.
+ */
+struct GPUPrimitiveAssembler
+{
+	PrimitiveTopology topology; ///<primitive topology
+	const GPUVertexFetch *fetch; ///<compiled vertex fetch of draw call
+	size_t nofInvocations; ///<number of vertices of draw call
+	VertexShaderInvocation next; ///<next vertex shader invocation
+	///<invocations of current primitive that are reused by next triangle
+	VertexShaderInvocation vertices[VERTICES_PER_TRIANGLE];
+	size_t nofPrimitiveVertices; ///<number of vertices in vertices
+	int odd; ///<next triangle of strip has flipped winding
+};
+
+
+/**
+ * @brief This structure represents post-transform vertex cache of one draw
+ * call. Outputs of vertex shader are stored by gl_VertexID, so every unique
+ * vertex of indexed draw call is shaded only once.
+ */
+struct GPUVertexCache
+{
+	///<shaded vertices indexed by gl_VertexID - firstVertexID
+	GPUVertexShaderOutput *vertices;
+	unsigned char *shaded; ///<vertex in given slot is shaded
+	uint16_t *outcodes; ///<clip outcodes of shaded vertices
+	VertexIndex firstVertexID; ///<gl_VertexID of the first slot
+	size_t nofVertices; ///<number of cache slots, 0 disables cache
+	size_t nofHits; ///<number of vertices found in cache
+	size_t nofInvocations; ///<number of vertex shader invocations
+	///<all vertices of draw call were shaded in advance (by batches), so
+	///<lookups are not counted again
+	int complete;
+};
+
+
+/**
+ * @brief maximal number of interpolated attribute components of triangle
+ */
+#define MAX_ATTRIBUTE_PLANES (MAX_ATTRIBUTES * 4)
+
+
+/**
+ * @brief This structure represents plane of one attribute component in screen
+ * space, value(x,y) = ax+by+c.
+ * Plane of perspective correct attribute interpolates value/w and the result
+ * has to be multiplied by interpolated w.
+ */
+struct GPUAttributePlane
+{
+	Vec3 plane; ///<coefficients (a,b,c) of plane
+	size_t attribute; ///<attribute index
+	size_t component; ///<component index
+	int perspective; ///<plane interpolates value/w
+};
+
+
+/**
+ * @brief This structure represents triangle that is prepared for rasterization.
+ * Triangle setup is computed once per triangle (after viewport transformation)
+ * and it can be rasterized in several screen regions (tiles).
+ */
+struct GPUTriangleSetup
+{
+	GPUPrimitive primitive; ///<primitive in screen-space
+	/**
+	 * edge functions (a,b,c) of triangle edges, edge e(x,y) = ax+by+c is
+	 * scaled to 1 at vertex opposite to edge, so it is directly barycentric
+	 * coordinate of that vertex
+	 */
+	Vec3 edges[EDGES_PER_TRIANGLE];
+	int topLeft[EDGES_PER_TRIANGLE]; ///<edge owns pixels that lie on it
+	int fixedPoint; ///<coverage is evaluated by fixed-point edge functions
+	/**
+	 * fixed-point edge functions (A,B,C) in sub-pixel units, pixel with
+	 * fixed-point center [X,Y] is covered if AX+BY+C >= 0 for all edges,
+	 * fill rule is included in C
+	 */
+	int64_t fixedEdges[EDGES_PER_TRIANGLE][3];
+	float minDepth; ///<the nearest depth of triangle
+	Vec3 inverseDepthPlane; ///<plane of 1/w, reciprocal is depth of fragment
+	///<planes of all components of attributes (flat ones are constant)
+	GPUAttributePlane attributePlanes[MAX_ATTRIBUTE_PLANES];
+	size_t nofAttributePlanes; ///<number of used attribute planes
+	size_t xMin; ///<first pixel column of bounding box
+	size_t yMin; ///<first pixel row of bounding box
+	size_t xMax; ///<pixel column after bounding box
+	size_t yMax; ///<pixel row after bounding box
+};
+
+/**
+ * @brief This structure represents 2x2 block of fragments that are generated
+ * together.
+ * Fragment of pixel [x + i % QUAD_SIZE, y + i / QUAD_SIZE] is stored in lane
+ * i. Uncovered lanes (helper lanes) are not shaded and they are masked out of
+ * per-fragment operations.
+ */
+struct GPUFragmentQuad
+{
+	GPUFragmentShaderInput inputs[FRAGMENTS_PER_QUAD]; ///<fragment inputs
+	GPUFragmentShaderOutput outputs[FRAGMENTS_PER_QUAD]; ///<fragment outputs
+	unsigned mask; ///<coverage mask, bit i is set if lane i is covered
+	size_t x; ///<x coord of lower left pixel of quad
+	size_t y; ///<y coord of lower left pixel of quad
+};
+
+/**
+ * @brief This structure represents state of rasterization that is constant
+ * during draw call.
+ */
+struct GPURasterizationState
+{
+	FragmentShader fragmentShader; ///<active fragment shader
+	const GPURasterizationKernelInfo *kernel; ///<rasterization kernel
+	int fixedPoint; ///<FIXED_POINT_RASTERIZATION is enabled
+	///<HIERARCHICAL_DEPTH_TEST is enabled and shader does not write depth
+	int hierarchicalDepth;
+	int earlyDepthTest; ///<depth test is performed before fragment shader
+};
+
+/**
+ * @brief This structure represents growable list of triangle setups.
+ */
+struct GPUTriangleSetupList
+{
+	GPUTriangleSetup *setups; ///<triangle setups
+	size_t nofSetups; ///<number of used triangle setups
+	size_t capacity; ///<number of allocated triangle setups
+};
+
+/**
+ * @brief This structure represents triangles binned into screen tiles.
+ * Indices of triangles that overlap tile t are stored in
+ * triangles[offsets[t]] ... triangles[offsets[t + 1] - 1] in submission order.
+ */
+struct GPUTileBins
+{
+	size_t nofTilesX; ///<number of tiles in a row
+	size_t nofTilesY; ///<number of tiles in a column
+	size_t *offsets; ///<offsets of tiles into triangles (nofTiles + 1 items)
+	size_t *triangles; ///<indices of triangle setups
 };
 
 
@@ -80,19 +276,38 @@ typedef enum FrustumPlane
 	FAR,     ///< far    frustum plane
 } FrustumPlane;
 
+/**
+ * @brief outcode bit of vertex that lies outside of frustum plane
+ */
+#define FRUSTUM_OUTCODE(plane) (1u << (plane))
+
+/**
+ * @brief outcode bit of vertex that lies outside of guard band plane, only
+ * LEFT, RIGHT, BOTTOM and TOP planes have guard band
+ */
+#define GUARD_BAND_OUTCODE(plane) (1u << (FAR + 1 + (plane)))
+
+/**
+ * @brief all frustum outcode bits and all guard band outcode bits
+ */
+#define FRUSTUM_OUTCODES 0x3fu
+#define GUARD_BAND_OUTCODES 0x3c0u ///<@copydoc FRUSTUM_OUTCODES
+
 
 /**
  * @brief This function computes gl_VertexID from vertex shader invocation using
  * indexing.
  *
- * @param indices pointer to
+ * @param indices pointer to indices or NULL if indexing is not used
+ * @param indexSize size in bytes of one index (1, 2, 4 or sizeof(VertexIndex))
  * @param vertexShaderInvocation id of vertex shader invocation
  *
  * @return return index of vertex if indexing is used, otherwise it returns
  * vertexShaderInvocation
  */
 VertexIndex gpu_computeGLVertexID(
-	const VertexIndex *indices, VertexShaderInvocation vertexShaderInvocation
+	const void *indices, size_t indexSize,
+	VertexShaderInvocation vertexShaderInvocation
 );
 
 /**
@@ -143,13 +358,319 @@ void gpu_runPrimitiveAssembly(
 	VertexShaderInvocation baseVertexShaderInvocation, VertexShader vertexShader
 );
 
+/**
+ * @brief This function compiles vertex puller configuration for draw call.
+ * Indices are scanned once for the highest gl_VertexID, so fetched addresses
+ * can be validated once per draw instead of once per fetch.
+ * Primitive restart indices of indexed draw call are not fetched.
+ *
+ * @param fetch output compiled vertex fetch
+ * @param puller vertex puller configuration
+ * @param nofVertices number of vertices of draw call
+ * @param primitiveRestart primitive restart is enabled
+ * @param restartIndex primitive restart index
+ */
+void gpu_compileVertexFetch(
+	GPUVertexFetch *fetch, const GPUVertexPullerConfiguration *puller,
+	size_t nofVertices, int primitiveRestart, VertexIndex restartIndex
+);
+
+/**
+ * @brief This function sets range of draw command that is fetched by compiled
+ * vertex fetch. Invocation i of the command reads index first + i, baseVertex
+ * is added to index (or to first without indexing) to get gl_VertexID.
+ * Indices are scanned for the lowest and the highest gl_VertexID.
+ *
+ * @param fetch compiled vertex fetch
+ * @param first index of the first vertex of command
+ * @param nofVertices number of vertices of command
+ * @param baseVertex value added to indices
+ */
+void gpu_setVertexFetchRange(
+	GPUVertexFetch *fetch, VertexShaderInvocation first, size_t nofVertices,
+	ptrdiff_t baseVertex
+);
+
+/**
+ * @brief This function computes gl_VertexID of vertex shader invocation of
+ * draw command fetched by compiled vertex fetch.
+ *
+ * @param fetch compiled vertex fetch
+ * @param vertexShaderInvocation vertex shader invocation number in command
+ *
+ * @return gl_VertexID
+ */
+VertexIndex gpu_fetchGLVertexID(
+	const GPUVertexFetch *fetch, VertexShaderInvocation vertexShaderInvocation
+);
+
+/**
+ * @brief This function returns whether vertex shader invocation of compiled
+ * vertex fetch reads primitive restart index.
+ *
+ * @param fetch compiled vertex fetch
+ * @param vertexShaderInvocation vertex shader invocation number
+ *
+ * @return 1 if invocation restarts primitive, otherwise 0
+ */
+int gpu_isPrimitiveRestart(
+	const GPUVertexFetch *fetch, VertexShaderInvocation vertexShaderInvocation
+);
+
+/**
+ * @brief This function selects instance that is fetched by compiled vertex
+ * fetch. Heads with divisor read element gl_InstanceID / divisor for all
+ * vertices of instance.
+ *
+ * @param fetch compiled vertex fetch
+ * @param gl_InstanceID instance index
+ */
+void gpu_setVertexFetchInstance(
+	GPUVertexFetch *fetch, VertexIndex gl_InstanceID
+);
+
+/**
+ * @brief This function sets addresses of vertex attributes of vertex, it is
+ * compiled alternative of gpu_runVertexPuller().
+ *
+ * @param output output vertex
+ * @param fetch compiled vertex fetch
+ * @param gl_VertexID vertex index
+ */
+void gpu_runVertexFetch(
+	GPUVertexPullerOutput *output, const GPUVertexFetch *fetch,
+	VertexIndex gl_VertexID
+);
+
+/**
+ * @brief This function initializes post-transform vertex cache for draw call.
+ * Cache has a slot for every gl_VertexID referenced by indices, it is disabled
+ * when indexing is not used (every vertex is unique) unless vertices are
+ * shaded by batches or shared by triangles of strip or fan.
+ *
+ * @param cache output vertex cache
+ * @param fetch compiled vertex fetch of draw call
+ * @param shared vertices will be shaded by batched vertex shader or shared
+ * by several triangles
+ */
+void gpu_initVertexCache(
+	GPUVertexCache *cache, const GPUVertexFetch *fetch, int shared
+);
+
+/**
+ * @brief This function decides whether batched vertex shader can shade
+ * vertices of compiled vertex fetch. Every enabled head needs declared input
+ * type of batched vertex shader and every declared attribute has to be
+ * validated by gpu_validateVertexFetch().
+ *
+ * @param gpu GPU handle
+ * @param fetch compiled vertex fetch
+ *
+ * @return 1 if batched vertex shader can be used, otherwise 0
+ */
+int gpu_canShadeVertexBatches(GPU gpu, const GPUVertexFetch *fetch);
+
+/**
+ * @brief This function shades all vertices of draw call by batched vertex
+ * shader and stores them into vertex cache.
+ * Vertices are pulled into structure-of-arrays batches, each unique vertex is
+ * shaded once.
+ *
+ * @param gpu GPU handle
+ * @param cache vertex cache initialized for batched shading
+ * @param fetch compiled vertex fetch of draw call
+ * @param nofVertices number of vertices of draw call
+ * @param shader batched vertex shader
+ */
+void gpu_runBatchedVertexShader(
+	GPU gpu, GPUVertexCache *cache, const GPUVertexFetch *fetch,
+	size_t nofVertices, BatchedVertexShader shader
+);
+
+/**
+ * @brief This function shades all unique vertices of draw call in parallel
+ * and stores them into vertex cache, which serves as transient output array
+ * of vertex shading phase.
+ * Unique vertices are collected first, then they are split into tasks of
+ * VERTEX_SHADING_TASK_SIZE vertices that are executed by GPU worker threads.
+ * Batched vertex shader is used if it is not NULL, it has to be accepted by
+ * gpu_canShadeVertexBatches() because batches are pulled without checks.
+ *
+ * @param gpu GPU handle
+ * @param cache vertex cache initialized for shared vertices
+ * @param fetch compiled vertex fetch of draw call
+ * @param nofVertices number of vertices of draw call
+ * @param vertexShader vertex shader
+ * @param batchedVertexShader batched vertex shader or NULL
+ */
+void gpu_runParallelVertexShader(
+	GPU gpu, GPUVertexCache *cache, const GPUVertexFetch *fetch,
+	size_t nofVertices, VertexShader vertexShader,
+	BatchedVertexShader batchedVertexShader
+);
+
+/**
+ * @brief This function marks all vertices of post-transform vertex cache as
+ * not shaded, it is used when the next instance is drawn.
+ *
+ * @param cache vertex cache
+ */
+void gpu_resetVertexCache(GPUVertexCache *cache);
+
+/**
+ * @brief This function frees post-transform vertex cache.
+ *
+ * @param cache vertex cache
+ */
+void gpu_freeVertexCache(GPUVertexCache *cache);
+
+/**
+ * @brief This function initializes primitive assembler of draw call.
+ *
+ * @param assembler output primitive assembler
+ * @param topology primitive topology
+ * @param fetch compiled vertex fetch of draw call
+ * @param nofVertices number of vertices of draw call
+ */
+void gpu_initPrimitiveAssembler(
+	GPUPrimitiveAssembler *assembler, PrimitiveTopology topology,
+	const GPUVertexFetch *fetch, size_t nofVertices
+);
+
+/**
+ * @brief This function assembles next triangle of draw call.
+ * Strip triangles reuse the last two vertices, fan triangles reuse the first
+ * and the last vertex, so one new vertex makes one triangle. Primitive
+ * restart discards vertices of unfinished triangle.
+ *
+ * @param assembler primitive assembler
+ * @param invocations output vertex shader invocations of triangle vertices
+ *
+ * @return 1 if triangle was assembled, 0 if all vertices were consumed
+ */
+int gpu_assembleTriangle(
+	GPUPrimitiveAssembler *assembler,
+	VertexShaderInvocation invocations[VERTICES_PER_TRIANGLE]
+);
+
+/**
+ * @brief This function performs primitive assembly of given vertex shader
+ * invocations with post-transform vertex cache. Vertex shader runs only for
+ * vertices that are not in cache yet.
+ *
+ * @param gpu GPU handle
+ * @param primitive output primitive
+ * @param nofPrimitiveVertices number of primitive vertices
+ * @param fetch compiled vertex fetch of draw call
+ * @param invocations vertex shader invocation numbers of primitive vertices
+ * @param vertexShader vertex shader
+ * @param cache vertex cache
+ */
+void gpu_assembleCachedPrimitive(
+	GPU gpu, GPUPrimitive *primitive, size_t nofPrimitiveVertices,
+	const GPUVertexFetch *fetch, const VertexShaderInvocation *invocations,
+	VertexShader vertexShader, GPUVertexCache *cache
+);
+
+/**
+ * @brief This function performs primitive assembly with post-transform vertex
+ * cache. Vertex shader runs only for vertices that are not in cache yet.
+ *
+ * @param gpu GPU handle
+ * @param primitive output primitive
+ * @param nofPrimitiveVertices number of primitive vertices
+ * @param fetch compiled vertex fetch of draw call
+ * @param baseVertexShaderInvocation vertex shader invocation number of the
+ * first vertex of primitive
+ * @param vertexShader vertex shader
+ * @param cache vertex cache
+ */
+void gpu_runCachedPrimitiveAssembly(
+	GPU gpu, GPUPrimitive *primitive, size_t nofPrimitiveVertices,
+	const GPUVertexFetch *fetch,
+	VertexShaderInvocation baseVertexShaderInvocation,
+	VertexShader vertexShader, GPUVertexCache *cache
+);
+
+/**
+ * @brief This function tests whether object-space bounding box lies outside of
+ * view frustum. Corners of box are transformed into clip-space and box is
+ * outside if all of them lie outside of the same frustum plane, so boxes that
+ * only cross frustum corners are conservatively kept.
+ *
+ * @param matrix matrix that transforms box into clip-space
+ * @param min minimal corner of box
+ * @param max maximal corner of box
+ *
+ * @return 1 if box is outside of view frustum, 0 otherwise
+ */
+int gpu_isBoundingBoxOutsideFrustum(
+	const Mat4 *matrix, const float min[3], const float max[3]
+);
+
+/**
+ * @brief This function computes clip outcode of vertex in clip-space.
+ * Bit FRUSTUM_OUTCODE(plane) is set if vertex lies outside of frustum plane,
+ * bit GUARD_BAND_OUTCODE(plane) is set if vertex lies outside of guard band
+ * plane (|x| <= GUARD_BAND_SIZE * w, |y| <= GUARD_BAND_SIZE * w).
+ *
+ * @param position position of vertex in clip-space
+ *
+ * @return clip outcode
+ */
+unsigned gpu_computeClipOutcode(const Vec4 *position);
+
+/**
+ * @brief This function computes coefficients of frustum plane in clip-space.
+ * Point P lies in front of plane if dot(plane, P) >= 0.
+ *
+ * @param plane output plane coefficients
+ * @param frustumPlane frustum plane
+ */
+void gpu_getFrustumPlane(Vec4 *plane, FrustumPlane frustumPlane);
+
+/**
+ * @brief This function initializes clip polygon by triangle.
+ *
+ * @param polygon output polygon
+ * @param triangle input triangle
+ */
+void gpu_initClipPolygon(GPUClipPolygon *polygon, const GPUTriangle *triangle);
+
+/**
+ * @brief This function clips convex polygon by plane in place
+ * (Sutherland-Hodgman). Vertices behind plane are replaced by intersections
+ * of edges with plane.
+ *
+ * @param polygon input/output polygon
+ * @param plane plane coefficients, see gpu_getFrustumPlane()
+ */
+void gpu_clipPolygon(GPUClipPolygon *polygon, const Vec4 *plane);
+
+/**
+ * @brief This function returns one triangle of fan triangulation of clip
+ * polygon.
+ *
+ * @param triangle output triangle
+ * @param polygon clip polygon
+ * @param index index of triangle (lower than polygon->nofVertices - 2)
+ */
+void gpu_getClipPolygonTriangle(
+	GPUTriangle *triangle, const GPUClipPolygon *polygon, size_t index
+);
+
 /**
  * @brief This function performs frustum clipping on a single triangle.
+ * Near plane is clipped first, empty polygon ends clipping early.
  *
- * @param output triangle list
+ * @param output clipped polygon
  * @param input input triangle
+ * @param planes frustum planes to clip (FRUSTUM_OUTCODE() bits),
+ * FRUSTUM_OUTCODES selects full frustum clipping
  */
-void gpu_runTriangleClipping(GPUTriangleList *output, const GPUTriangle *input);
+void gpu_runTriangleClipping(
+	GPUClipPolygon *output, const GPUTriangle *input, unsigned planes
+);
 
 /**
  * @brief This function performs perspective division on primitive.
@@ -264,39 +785,10 @@ float gpu_noperspectiveInterpolate(
 	const float weights[WEIGHTS_PER_BARYCENTRICS]
 );
 
-/**
- * @brief This function interpolates values using barycentric coords with
- * perspective correction.
- *
- * @param values values (one value per triangle vertex)
- * @param weights barycentric coords/weights
- * @param homogeneousCoords homogeneous coords of each triangle vertex
- *
- * @return
- */
-float gpu_smoothInterpolate(
-	const float values[WEIGHTS_PER_BARYCENTRICS],
-	const float weights[WEIGHTS_PER_BARYCENTRICS],
-	const float homogeneousCoords[WEIGHTS_PER_BARYCENTRICS]
-);
-
-/**
- * @brief This function creates fragment and interpolates vertex attributes into
- * fragment attributes according to selected interpolation type.
- *
- * @param fragment output fragment
- * @param primitive input primitive
- * @param barycentrics barycentric coords/weight of primitive
- * @param pixelCoord pixel coordinate of fragment
- */
-void gpu_createFragment(
-	GPUFragmentShaderInput *fragment, const GPUPrimitive *primitive,
-	const Vec3 *barycentrics, const Vec2 *pixelCoord
-);
-
 /**
  * @brief This function performs per-fragment operations.
- * Depth test is only per-fragment operation in this project.
+ * Depth test is only per-fragment operation in this project, discarded
+ * fragments are skipped.
  *
  * @param gpu GPU handle
  * @param fragment fragment
@@ -307,6 +799,18 @@ void gpu_perFragmentOperations(
 	GPU gpu, const GPUFragmentShaderOutput *fragment, size_t x, size_t y
 );
 
+/**
+ * @brief This function performs per-fragment operations on covered lanes of
+ * fragment quad.
+ * Helper lanes and discarded fragments are masked out.
+ *
+ * @param gpu GPU handle
+ * @param quad shaded fragment quad
+ *
+ * @return mask of lanes that passed depth test and were written
+ */
+unsigned gpu_perQuadOperations(GPU gpu, const GPUFragmentQuad *quad);
+
 /**
  * @brief This function inits primitive.
  *
@@ -315,6 +819,21 @@ void gpu_perFragmentOperations(
  */
 void gpu_initPrimitive(GPUPrimitive *primitive, GPU gpu);
 
+/**
+ * @brief This function creates vertex of clipped triangle.
+ * Vertices of original primitive are copied, attributes of new vertices are
+ * interpolated by barycentric coords.
+ *
+ * @param vertex output vertex in clip-space
+ * @param primitive original primitive
+ * @param position clipped position of vertex
+ * @param coords barycentric coords of vertex with respect to primitive
+ */
+void gpu_createClippedVertex(
+	GPUVertexShaderOutput *vertex, const GPUPrimitive *primitive,
+	const Vec4 *position, const Vec3 *coords
+);
+
 /**
  * @brief This functions creates sub primitive using clipped triangle and
  * original triangle.
@@ -336,16 +855,166 @@ void gpu_createSubPrimitive(
  */
 void gpu_initTriangle(GPUTriangle *triangle, const GPUPrimitive *primitive);
 
+/**
+ * @brief This function cheaply decides whether triangle cannot cover any
+ * sample, it is called before triangle is culled and set up.
+ * Zero-area triangles and triangles whose bounding box contains no pixel
+ * center are rejected. Triangles that are smaller than one pixel have at most
+ * one candidate sample which is tested by fixed-point edge functions directly.
+ * Decisions agree with triangle setup, so rejected triangles would not produce
+ * any fragment. Statistics are updated with reasons of rejection.
+ *
+ * @param positions screen-space positions of triangle vertices
+ * @param width width of viewport
+ * @param height height of viewport
+ * @param fixedPoint triangle is rasterized by fixed-point edge functions if
+ * its coords are in range
+ * @param statistics statistics of draw call
+ *
+ * @return 1 if triangle is rejected, otherwise 0
+ */
+int gpu_rejectTriangle(
+	const Vec2 positions[VERTICES_PER_TRIANGLE], size_t width, size_t height,
+	int fixedPoint, PipelineStatistics *statistics
+);
+
+/**
+ * @brief This function computes twice the signed area of triangle in
+ * screen-space.
+ *
+ * @param primitive primitive transformed by viewport transformation
+ *
+ * @return positive area for counter-clockwise triangle, negative area for
+ * clockwise triangle
+ */
+float gpu_computeTriangleSignedArea(const GPUPrimitive *primitive);
+
+/**
+ * @brief This function decides whether triangle is removed by face culling.
+ * Triangles with zero area are never culled.
+ *
+ * @param primitive primitive transformed by viewport transformation
+ * @param mode cull face mode
+ * @param frontFace winding of front-facing triangles
+ *
+ * @return 1 if triangle is culled, otherwise 0
+ */
+int gpu_isTriangleCulled(
+	const GPUPrimitive *primitive, CullFaceMode mode, FrontFace frontFace
+);
+
+/**
+ * @brief This function computes triangle setup of primitive in screen-space.
+ *
+ * @param setup output triangle setup
+ * @param primitive input primitive transformed by viewport transformation
+ * @param width screen width in pixels
+ * @param height screen height in pixels
+ * @param fixedPoint snap vertices to sub-pixel grid and set up fixed-point
+ * edge functions
+ *
+ * @return 0 if triangle is degenerate or it does not cover any pixel
+ * row/column of screen, otherwise 1
+ */
+int gpu_setupTriangle(
+	GPUTriangleSetup *setup, const GPUPrimitive *primitive, size_t width,
+	size_t height, int fixedPoint
+);
+
+/**
+ * @brief This function inits rasterization state using active program and
+ * enabled capabilities of GPU.
+ *
+ * @param state output rasterization state
+ * @param gpu GPU handle
+ */
+void gpu_initRasterizationState(GPURasterizationState *state, GPU gpu);
+
+/**
+ * @brief This function rasterizes part of triangle that lies in screen region
+ * [xMin,xMax) x [yMin,yMax).
+ * Fragments are generated and shaded in 2x2 quads aligned to even pixel
+ * coords. Coverage and fragment inputs of several quads are computed at once
+ * by rasterization kernel. Fragments that fail early depth test are not
+ * shaded. If hierarchical depth test is enabled, the
+ * triangle and its quads are rejected when they lie behind hierarchical depth
+ * buffer and the buffer is updated after written depths. Pixel centers that
+ * lie exactly on an edge are covered only by top-left edges, so pixels on
+ * shared edges are rasterized once.
+ *
+ * @param gpu GPU handle
+ * @param setup triangle setup
+ * @param state rasterization state
+ * @param xMin first pixel column of region
+ * @param yMin first pixel row of region
+ * @param xMax pixel column after region
+ * @param yMax pixel row after region
+ */
+void gpu_rasterizeTriangleRegion(
+	GPU gpu, const GPUTriangleSetup *setup,
+	const GPURasterizationState *state, size_t xMin, size_t yMin, size_t xMax,
+	size_t yMax
+);
+
 /**
  * @brief This function rasterizes one triangle.
  *
  * @param gpu GPU handle
  * @param primitive input primitive
+ * @param state rasterization state of draw call
  * @param width screen width in pixels
  * @param height screen height in pixels
  */
 void gpu_rasterizeTriangle(
-	GPU gpu, const GPUPrimitive *primitive, size_t width, size_t height
+	GPU gpu, const GPUPrimitive *primitive, const GPURasterizationState *state,
+	size_t width, size_t height
+);
+
+/**
+ * @brief This function appends triangle setup at the end of list.
+ *
+ * @param list list of triangle setups
+ *
+ * @return pointer to new (uninitialized) triangle setup
+ */
+GPUTriangleSetup *gpu_appendTriangleSetup(GPUTriangleSetupList *list);
+
+/**
+ * @brief This function bins triangles into screen tiles of size TILE_SIZE.
+ * Triangles are assigned to all tiles overlapped by their bounding boxes.
+ *
+ * @param bins output bins, they have to be freed by gpu_freeTileBins()
+ * @param list triangle setups
+ * @param width screen width in pixels
+ * @param height screen height in pixels
+ */
+void gpu_binTriangles(
+	GPUTileBins *bins, const GPUTriangleSetupList *list, size_t width,
+	size_t height
+);
+
+/**
+ * @brief This function frees memory of tile bins.
+ *
+ * @param bins tile bins
+ */
+void gpu_freeTileBins(GPUTileBins *bins);
+
+/**
+ * @brief This function rasterizes binned triangles.
+ * Tiles are rasterized in parallel, every tile is owned by exactly one thread,
+ * so per-fragment operations do not need any synchronization.
+ *
+ * @param gpu GPU handle
+ * @param list triangle setups
+ * @param bins triangles binned into tiles
+ * @param state rasterization state of draw call
+ * @param width screen width in pixels
+ * @param height screen height in pixels
+ */
+void gpu_rasterizeTiles(
+	GPU gpu, const GPUTriangleSetupList *list, const GPUTileBins *bins,
+	const GPURasterizationState *state, size_t width, size_t height
 );
 
 /**
@@ -353,12 +1022,85 @@ void gpu_rasterizeTriangle(
  * This function invokes whole rendering pipeline.
  * It is necessary to active selected vertex puller and to active selected
  * shader program before this function is called.
+ * If TILED_RASTERIZATION is enabled, all triangles are set up first, binned
+ * into screen tiles and the tiles are rasterized in parallel.
+ * Indexed vertices are shaded once per draw call using post-transform vertex
+ * cache, batched vertex shader of program is used if it is attached and all
+ * pulled attributes lie inside of their buffers. If PARALLEL_VERTEX_SHADING
+ * is enabled, all unique vertices are shaded by GPU worker threads before
+ * triangles are assembled. If BOUNDING_VOLUME_CULLING is enabled and bounding
+ * box of vertex puller lies outside of view frustum, no vertex is pulled and
+ * the draw call is counted as culled. Vertices form triangles according to
+ * primitive topology, index equal to primitive restart index starts new
+ * primitive if PRIMITIVE_RESTART is enabled. Triangles that cannot cover any
+ * sample are rejected before sub primitives are created. Triangles are culled
+ * according to cull face mode after viewport transformation and counters of
+ * draw call are added to pipeline statistics.
  *
  * @param gpu GPU handle
  * @param nofVertices number of vertices that will be drawn.
  */
 void cpu_drawTriangles(GPU gpu, size_t nofVertices);
 
+/**
+ * @brief This function draws nofInstances instances of array of triangles.
+ * Vertex fetch is compiled once for all instances, every instance is shaded
+ * with its gl_InstanceID and heads with divisor read per-instance attributes.
+ * With TILED_RASTERIZATION, triangles of all instances are binned and
+ * rasterized together.
+ *
+ * Its alternative function in OpenGL is
+ * <a href="https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glDrawArraysInstanced.xhtml">
+ * glDrawArraysInstanced
+ * </a>.
+ *
+ * @param gpu GPU handle
+ * @param nofVertices number of vertices of one instance
+ * @param nofInstances number of instances
+ */
+void cpu_drawTrianglesInstanced(
+	GPU gpu, size_t nofVertices, size_t nofInstances
+);
+
+/**
+ * @brief This function draws array of draw commands in one pass.
+ * State of GPU is resolved once for all commands and triangles of all
+ * commands are binned and rasterized together, every command is counted as
+ * one draw call in pipeline statistics.
+ *
+ * Its alternative function in OpenGL is
+ * <a href="https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glMultiDrawElementsBaseVertex.xhtml">
+ * glMultiDrawElementsBaseVertex
+ * </a>.
+ *
+ * @param gpu GPU handle
+ * @param commands draw commands
+ * @param nofCommands number of draw commands
+ */
+void cpu_multiDrawTriangles(
+	GPU gpu, const DrawTrianglesCommand *commands, size_t nofCommands
+);
+
+/**
+ * @brief This function draws array of draw commands that are stored in
+ * buffer on GPU, see cpu_multiDrawTriangles().
+ * Commands that do not fit into buffer are reported and nothing is drawn.
+ *
+ * Its alternative function in OpenGL is
+ * <a href="https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glMultiDrawElementsIndirect.xhtml">
+ * glMultiDrawElementsIndirect
+ * </a>.
+ *
+ * @param gpu GPU handle
+ * @param buffer id of buffer that contains DrawTrianglesCommand records
+ * @param offset offset of the first command in bytes
+ * @param nofCommands number of draw commands
+ * @param stride distance between commands in bytes, 0 means tightly packed
+ */
+void cpu_drawTrianglesIndirect(
+	GPU gpu, BufferID buffer, size_t offset, size_t nofCommands, size_t stride
+);
+
 
 #ifdef __cplusplus
 }
@@ -111,6 +111,54 @@ void phong_vertexShader(
 	);
 }
 
+void phong_batchedVertexShader(
+	GPUVertexShaderOutputBatch *const output,
+	const GPUVertexShaderInputBatch *const input, const GPU gpu
+)
+{
+	assert(output != NULL);
+	assert(input != NULL);
+	assert(gpu != NULL);
+
+	// uniforms are read once per batch
+	const Uniforms uniforms = gpu_getUniformsHandle(gpu);
+	const Mat4 *const viewMatrix = shader_interpretUniformAsMat4(
+		uniforms, getUniformLocation(gpu, "viewMatrix")
+	);
+	const Mat4 *const projectionMatrix = shader_interpretUniformAsMat4(
+		uniforms, getUniformLocation(gpu, "projectionMatrix")
+	);
+	Mat4 projectionViewMatrix;
+	multiply_Mat4_Mat4(&projectionViewMatrix, projectionMatrix, viewMatrix);
+
+	// transform vertices to clip-space, w of position is 1
+	const size_t n = input->nofVertices;
+	const float (*const position)[VERTEX_SHADER_BATCH_SIZE] =
+		input->attributes[0];
+	for (size_t y = 0; y < 4; ++y)
+	{
+		const float m0 = projectionViewMatrix.column[0].data[y];
+		const float m1 = projectionViewMatrix.column[1].data[y];
+		const float m2 = projectionViewMatrix.column[2].data[y];
+		const float m3 = projectionViewMatrix.column[3].data[y];
+		for (size_t v = 0; v < n; ++v)
+		{
+			output->gl_Position[y][v] = m0 * position[0][v]
+				+ m1 * position[1][v] + m2 * position[2][v] + m3;
+		}
+	}
+
+	// set output attributes
+	for (size_t c = 0; c < 3; ++c)
+	{
+		for (size_t v = 0; v < n; ++v)
+		{
+			output->attributes[0][c][v] = input->attributes[0][c][v];
+			output->attributes[1][c][v] = input->attributes[1][c][v];
+		}
+	}
+}
+
 
 /**
  * Constrain a vec3 values to lie between
@@ -31,6 +31,19 @@ void phong_vertexShader(
 	GPUVertexShaderOutput *output, const GPUVertexShaderInput *input, GPU gpu
 );
 
+/**
+ * @brief This function represents batched vertex shader for phong
+ * lighting/shading, it computes the same outputs as phong_vertexShader().
+ *
+ * @param output output vertices
+ * @param input input vertices
+ * @param gpu GPU handle
+ */
+void phong_batchedVertexShader(
+	GPUVertexShaderOutputBatch *output, const GPUVertexShaderInputBatch *input,
+	GPU gpu
+);
+
 /**
  * @brief This function represents fragment shader for phong lighting/shading.
  *
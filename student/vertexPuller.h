@@ -87,6 +87,9 @@ struct GPUVertexPullerHead
 	size_t stride;
 	int enabled; ///< is this attribute enabled?
 	const void *buffer; ///< buffer that contains this attribute
+	///< 0 - attribute advances per vertex, N - attribute advances once per N
+	///< instances of instanced draw call
+	size_t divisor;
 };
 
 /**
@@ -97,7 +100,12 @@ struct GPUVertexPullerConfiguration
 	///< reading heads for each vertex attribute
 	GPUVertexPullerHead heads[MAX_ATTRIBUTES];
 	///< indices to vertices, if it is NULL -> indexing is not used
-	const VertexIndex *indices;
+	const void *indices;
+	///< size in bytes of one index (1, 2, 4 or sizeof(VertexIndex))
+	size_t indexSize;
+	int bounded; ///< bounding box of vertices is set
+	float boundingBoxMin[3]; ///< minimal object-space position of vertices
+	float boundingBoxMax[3]; ///< maximal object-space position of vertices
 };
 
 /**
@@ -153,6 +161,41 @@ void cpu_setVertexPullerHead(
 	size_t offset, size_t stride
 );
 
+/**
+ * @brief This function sets instance divisor of vertex puller head.
+ *
+ * Its alternative function in OpenGL is
+ * <a href="https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glVertexBindingDivisor.xhtml">
+ * glVertexArrayBindingDivisor
+ * </a>.
+ *
+ * Head with divisor 0 reads attribute of gl_VertexID, head with divisor N
+ * reads attribute of gl_InstanceID / N in instanced draw calls.
+ *
+ * @param gpu GPU handler
+ * @param puller id of vertex puller
+ * @param headIndex index of reading head in vertex puller configuration
+ * @param divisor number of instances that share one attribute
+ */
+void cpu_setVertexPullerHeadDivisor(
+	GPU gpu, VertexPullerID puller, size_t headIndex, size_t divisor
+);
+
+/**
+ * @brief This function sets object-space bounding box of vertices that are
+ * drawn by vertex puller.
+ * If BOUNDING_VOLUME_CULLING is enabled, draw calls whose bounding box lies
+ * outside of view frustum (see cpu_setCullingMatrix()) are skipped.
+ *
+ * @param gpu GPU handler
+ * @param puller id of vertex puller
+ * @param min minimal position of vertices, NULL removes bounding box
+ * @param max maximal position of vertices
+ */
+void cpu_setVertexPullerBoundingBox(
+	GPU gpu, VertexPullerID puller, const Vec3 *min, const Vec3 *max
+);
+
 /**
  * @brief This function sets indexing in vertex puller.
  *
@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <iostream>
+#include <vector>
 
 #include <tests/conformanceTests.h>
 #include <student/gpu.h>
@@ -9,9 +11,13 @@
 #include <student/vertexPuller.h>
 #include <student/student_cpu.h>
 #include <student/student_pipeline.h>
+#include <student/rasterizationKernel.h>
+#include <student/clipKernel.h>
 #include <student/student_shader.h>
 #include <student/uniforms.h>
 #include <student/globals.h>
+#include <student/bunny.h>
+#include <student/meshOptimizer.h>
 
 #define CATCH_CONFIG_RUNNER
 #include <3rdParty/catch.hpp>
@@ -63,21 +69,21 @@ TEST_CASE("gpu_computeGLVertexID should compute gl_VertexID.")
 	WHEN(" using indexing")
 	{
 		const VertexIndex indices[] = {0, 1, 2, 2, 1, 3};
-		REQUIRE(gpu_computeGLVertexID(indices, 0) == 0);
-		REQUIRE(gpu_computeGLVertexID(indices, 1) == 1);
-		REQUIRE(gpu_computeGLVertexID(indices, 2) == 2);
-		REQUIRE(gpu_computeGLVertexID(indices, 3) == 2);
-		REQUIRE(gpu_computeGLVertexID(indices, 4) == 1);
-		REQUIRE(gpu_computeGLVertexID(indices, 5) == 3);
+		REQUIRE(gpu_computeGLVertexID(indices, sizeof(VertexIndex), 0) == 0);
+		REQUIRE(gpu_computeGLVertexID(indices, sizeof(VertexIndex), 1) == 1);
+		REQUIRE(gpu_computeGLVertexID(indices, sizeof(VertexIndex), 2) == 2);
+		REQUIRE(gpu_computeGLVertexID(indices, sizeof(VertexIndex), 3) == 2);
+		REQUIRE(gpu_computeGLVertexID(indices, sizeof(VertexIndex), 4) == 1);
+		REQUIRE(gpu_computeGLVertexID(indices, sizeof(VertexIndex), 5) == 3);
 	}
 	WHEN(" not using indexing")
 	{
-		REQUIRE(gpu_computeGLVertexID(nullptr, 0) == 0);
-		REQUIRE(gpu_computeGLVertexID(nullptr, 1) == 1);
-		REQUIRE(gpu_computeGLVertexID(nullptr, 2) == 2);
-		REQUIRE(gpu_computeGLVertexID(nullptr, 3) == 3);
-		REQUIRE(gpu_computeGLVertexID(nullptr, 4) == 4);
-		REQUIRE(gpu_computeGLVertexID(nullptr, 5) == 5);
+		REQUIRE(gpu_computeGLVertexID(nullptr, sizeof(VertexIndex), 0) == 0);
+		REQUIRE(gpu_computeGLVertexID(nullptr, sizeof(VertexIndex), 1) == 1);
+		REQUIRE(gpu_computeGLVertexID(nullptr, sizeof(VertexIndex), 2) == 2);
+		REQUIRE(gpu_computeGLVertexID(nullptr, sizeof(VertexIndex), 3) == 3);
+		REQUIRE(gpu_computeGLVertexID(nullptr, sizeof(VertexIndex), 4) == 4);
+		REQUIRE(gpu_computeGLVertexID(nullptr, sizeof(VertexIndex), 5) == 5);
 	}
 }
 
@@ -87,21 +93,21 @@ TEST_CASE("SOLUTION_TEST: gpu_computeGLVertexID should compute gl_VertexID")
 	WHEN(" using indexing")
 	{
 		const VertexIndex ind[] = {3, 10, 20, 20, 10, 30};
-		REQUIRE(gpu_computeGLVertexID(ind, 0) == 3);
-		REQUIRE(gpu_computeGLVertexID(ind, 1) == 10);
-		REQUIRE(gpu_computeGLVertexID(ind, 2) == 20);
-		REQUIRE(gpu_computeGLVertexID(ind, 3) == 20);
-		REQUIRE(gpu_computeGLVertexID(ind, 4) == 10);
-		REQUIRE(gpu_computeGLVertexID(ind, 5) == 30);
+		REQUIRE(gpu_computeGLVertexID(ind, sizeof(VertexIndex), 0) == 3);
+		REQUIRE(gpu_computeGLVertexID(ind, sizeof(VertexIndex), 1) == 10);
+		REQUIRE(gpu_computeGLVertexID(ind, sizeof(VertexIndex), 2) == 20);
+		REQUIRE(gpu_computeGLVertexID(ind, sizeof(VertexIndex), 3) == 20);
+		REQUIRE(gpu_computeGLVertexID(ind, sizeof(VertexIndex), 4) == 10);
+		REQUIRE(gpu_computeGLVertexID(ind, sizeof(VertexIndex), 5) == 30);
 	}
 	WHEN(" not using indexing")
 	{
-		REQUIRE(gpu_computeGLVertexID(nullptr, 10) == 10);
-		REQUIRE(gpu_computeGLVertexID(nullptr, 11) == 11);
-		REQUIRE(gpu_computeGLVertexID(nullptr, 12) == 12);
-		REQUIRE(gpu_computeGLVertexID(nullptr, 13) == 13);
-		REQUIRE(gpu_computeGLVertexID(nullptr, 14) == 14);
-		REQUIRE(gpu_computeGLVertexID(nullptr, 15) == 15);
+		REQUIRE(gpu_computeGLVertexID(nullptr, sizeof(VertexIndex), 10) == 10);
+		REQUIRE(gpu_computeGLVertexID(nullptr, sizeof(VertexIndex), 11) == 11);
+		REQUIRE(gpu_computeGLVertexID(nullptr, sizeof(VertexIndex), 12) == 12);
+		REQUIRE(gpu_computeGLVertexID(nullptr, sizeof(VertexIndex), 13) == 13);
+		REQUIRE(gpu_computeGLVertexID(nullptr, sizeof(VertexIndex), 14) == 14);
+		REQUIRE(gpu_computeGLVertexID(nullptr, sizeof(VertexIndex), 15) == 15);
 	}
 }
 
@@ -141,6 +147,22 @@ TEST_CASE(
 }
 
 
+TEST_CASE("gpu_computeGLVertexID should read indices of declared width.")
+{
+	const uint8_t indices8[] = {3, 200, 7};
+	const uint16_t indices16[] = {3, 60000, 7};
+	const uint32_t indices32[] = {3, 4000000000u, 7};
+	REQUIRE(gpu_computeGLVertexID(indices8, sizeof(uint8_t), 1) == 200);
+	REQUIRE(gpu_computeGLVertexID(indices8, sizeof(uint8_t), 2) == 7);
+	REQUIRE(gpu_computeGLVertexID(indices16, sizeof(uint16_t), 1) == 60000);
+	REQUIRE(gpu_computeGLVertexID(indices16, sizeof(uint16_t), 2) == 7);
+	REQUIRE(
+		gpu_computeGLVertexID(indices32, sizeof(uint32_t), 1) == 4000000000u
+	);
+	REQUIRE(gpu_computeGLVertexID(indices32, sizeof(uint32_t), 2) == 7);
+}
+
+
 TEST_CASE(
 	"gpu_runVertexPuller should construct vertex and fill vertex attributes.")
 {
@@ -150,6 +172,7 @@ TEST_CASE(
 		5, 2, 6, 2, 3, 6, 6, 3, 7
 	};
 	puller.indices = indices;
+	puller.indexSize = sizeof(VertexIndex);
 	for (auto &head : puller.heads)
 	{ head.enabled = 0; }
 	puller.heads[0].offset = 7;
@@ -186,6 +209,7 @@ TEST_CASE("SOLUTION_TEST: gpu_runVertexPuller should construct vertex")
 		6, 7, 8, 12, 11, 3, 4, 1, 7
 	};
 	puller.indices = i;
+	puller.indexSize = sizeof(VertexIndex);
 	for (auto &head : puller.heads)
 	{ head.enabled = 0; }
 	puller.heads[0].offset = 3;
@@ -229,6 +253,7 @@ TEST_CASE("gpu_runPrimitiveAssembly should construct primitive.")
 	GPUVertexPullerConfiguration puller;
 	const VertexIndex indices[8] = {0, 0, 0, 0, 0, 3, 12, 31};
 	puller.indices = indices;
+	puller.indexSize = sizeof(VertexIndex);
 	puller.heads[0].buffer = (void *) 123;
 	puller.heads[0].stride = 32;
 	puller.heads[0].offset = 10000;
@@ -279,6 +304,597 @@ TEST_CASE("gpu_runPrimitiveAssembly should construct primitive.")
 	}
 }
 
+// vertex shader for testing that writes gl_VertexID into position
+void vs_writeVertexID(
+	GPUVertexShaderOutput *const output,
+	const GPUVertexShaderInput *const input, const GPU
+)
+{
+	init_Vec4(&output->gl_Position, (float) input->gl_VertexID, 0.f, 0.f, 1.f);
+	vsInvocationCounter++;
+}
+
+
+TEST_CASE("Compiled vertex fetch should match vertex puller.")
+{
+	GPUVertexPullerConfiguration puller;
+	const VertexIndex indices[4] = {7, 0, 3, 5};
+	puller.indices = indices;
+	puller.indexSize = sizeof(VertexIndex);
+	for (size_t a = 0; a < MAX_ATTRIBUTES; ++a)
+	{
+		puller.heads[a].buffer = (void *) (1000 * (a + 1));
+		puller.heads[a].stride = 4 * (a + 1);
+		puller.heads[a].offset = 10 * a;
+		puller.heads[a].enabled = a % 2 == 0;
+		puller.heads[a].divisor = 0;
+	}
+
+	GPUVertexFetch fetch;
+	gpu_compileVertexFetch(&fetch, &puller, 4, 0, 0);
+	REQUIRE(fetch.nofVertexIDs == 8);
+	REQUIRE(fetch.nofHeads == 2);
+	for (VertexShaderInvocation i = 0; i < 4; ++i)
+	{
+		GPUVertexPullerOutput expected;
+		gpu_runVertexPuller(&expected, &puller, i);
+		GPUVertexPullerOutput output;
+		gpu_runVertexFetch(&output, &fetch, indices[i]);
+		for (size_t a = 0; a < MAX_ATTRIBUTES; ++a)
+		{
+			REQUIRE(output.attributes[a] == expected.attributes[a]);
+		}
+	}
+}
+
+
+TEST_CASE("Vertex cache should shade every unique vertex once.")
+{
+	auto gpu = (GPU) 13;
+	GPUVertexPullerConfiguration puller;
+	const VertexIndex indices[9] = {0, 1, 2, 2, 1, 3, 3, 1, 0};
+	puller.indices = indices;
+	puller.indexSize = sizeof(VertexIndex);
+	for (size_t a = 0; a < MAX_ATTRIBUTES; ++a)
+	{
+		puller.heads[a].buffer = (void *) nullptr;
+		puller.heads[a].stride = 0;
+		puller.heads[a].offset = 0;
+		puller.heads[a].enabled = 0;
+	}
+
+	GPUVertexFetch fetch;
+	gpu_compileVertexFetch(&fetch, &puller, 9, 0, 0);
+	REQUIRE(fetch.nofVertexIDs == 4);
+	REQUIRE(fetch.nofHeads == 0);
+	GPUVertexCache cache;
+	gpu_initVertexCache(&cache, &fetch, 0);
+	REQUIRE(cache.nofVertices == 4);
+	vsInvocationCounter = 0;
+	for (size_t base = 0; base < 9; base += VERTICES_PER_TRIANGLE)
+	{
+		GPUPrimitive primitive;
+		gpu_runCachedPrimitiveAssembly(
+			gpu, &primitive, VERTICES_PER_TRIANGLE, &fetch, base,
+			vs_writeVertexID, &cache
+		);
+		REQUIRE(primitive.nofUsedVertices == VERTICES_PER_TRIANGLE);
+		for (size_t v = 0; v < VERTICES_PER_TRIANGLE; ++v)
+		{
+			REQUIRE(
+				primitive.vertices[v].gl_Position.data[0]
+					== (float) indices[base + v]
+			);
+		}
+	}
+	REQUIRE(vsInvocationCounter == 4);
+	REQUIRE(cache.nofInvocations == 4);
+	REQUIRE(cache.nofHits == 5);
+	gpu_freeVertexCache(&cache);
+
+	// vertices of non-indexed draw are unique, cache is disabled
+	puller.indices = nullptr;
+	gpu_compileVertexFetch(&fetch, &puller, 9, 0, 0);
+	gpu_initVertexCache(&cache, &fetch, 0);
+	REQUIRE(cache.nofVertices == 0);
+	gpu_freeVertexCache(&cache);
+}
+
+
+// vertex shader for testing that scales attribute 0
+void vs_scalePosition(
+	GPUVertexShaderOutput *const output,
+	const GPUVertexShaderInput *const input, const GPU gpu
+)
+{
+	const Vec3 *const position =
+		vs_interpretInputVertexAttributeAsVec3(gpu, input, 0);
+	init_Vec4(
+		&output->gl_Position, position->data[0], position->data[1],
+		position->data[2], 1.f
+	);
+	init_Vec2(
+		(Vec2 *) output->attributes[0], position->data[0] * 2.f,
+		position->data[1] + position->data[2]
+	);
+}
+
+
+// batched version of vs_scalePosition()
+void vs_batchedScalePosition(
+	GPUVertexShaderOutputBatch *const output,
+	const GPUVertexShaderInputBatch *const input, const GPU
+)
+{
+	for (size_t v = 0; v < input->nofVertices; ++v)
+	{
+		for (size_t c = 0; c < 3; ++c)
+		{ output->gl_Position[c][v] = input->attributes[0][c][v]; }
+		output->gl_Position[3][v] = 1.f;
+		output->attributes[0][0][v] = input->attributes[0][0][v] * 2.f;
+		output->attributes[0][1][v] =
+			input->attributes[0][1][v] + input->attributes[0][2][v];
+	}
+}
+
+
+TEST_CASE("Batched vertex shader should match scalar vertex shader.")
+{
+	GPU gpu = cpu_createGPU();
+	const ProgramID program = cpu_createProgram(gpu);
+	cpu_attachVertexShader(gpu, program, vs_scalePosition);
+	cpu_attachBatchedVertexShader(gpu, program, vs_batchedScalePosition);
+	cpu_setAttributeInterpolation(gpu, program, 0, ATTRIB_VEC2, SMOOTH);
+	cpu_setVertexShaderInputType(gpu, program, 0, ATTRIB_VEC3);
+	cpu_useProgram(gpu, program);
+	// the last batch is partial
+	const size_t nofVertices = VERTEX_SHADER_BATCH_SIZE + 3;
+	std::vector<float> positions;
+	for (size_t i = 0; i < 3 * nofVertices; ++i)
+	{ positions.push_back((float) i * .5f - 7.f); }
+	BufferID buffer;
+	cpu_createBuffers(gpu, 1, &buffer);
+	cpu_bufferData(
+		gpu, buffer, positions.size() * sizeof(float), positions.data()
+	);
+	VertexPullerID puller;
+	cpu_createVertexPullers(gpu, 1, &puller);
+	cpu_setVertexPullerHead(gpu, puller, 0, buffer, 0, 3 * sizeof(float));
+	cpu_enableVertexPullerHead(gpu, puller, 0);
+	cpu_bindVertexPuller(gpu, puller);
+
+	GPUVertexFetch fetch;
+	gpu_compileVertexFetch(
+		&fetch, gpu_getActiveVertexPuller(gpu), nofVertices, 0, 0
+	);
+	gpu_validateVertexFetch(gpu, fetch.nofVertexIDs, 1);
+	REQUIRE(gpu_canShadeVertexBatches(gpu, &fetch));
+	GPUVertexCache batched;
+	GPUVertexCache scalar;
+	gpu_initVertexCache(&batched, &fetch, 1);
+	gpu_initVertexCache(&scalar, &fetch, 1);
+	gpu_runBatchedVertexShader(
+		gpu, &batched, &fetch, nofVertices, vs_batchedScalePosition
+	);
+	for (size_t i = 0; i < nofVertices; ++i)
+	{
+		GPUPrimitive primitive;
+		gpu_runCachedPrimitiveAssembly(
+			gpu, &primitive, 1, &fetch, i, vs_scalePosition, &scalar
+		);
+	}
+	gpu_invalidateVertexFetch(gpu);
+	REQUIRE(batched.nofVertices == nofVertices);
+	REQUIRE(batched.nofInvocations == scalar.nofInvocations);
+	for (size_t slot = 0; slot < batched.nofVertices; ++slot)
+	{
+		REQUIRE(batched.shaded[slot] == scalar.shaded[slot]);
+		for (size_t c = 0; c < 4; ++c)
+		{
+			REQUIRE(
+				batched.vertices[slot].gl_Position.data[c]
+					== scalar.vertices[slot].gl_Position.data[c]
+			);
+		}
+		for (size_t c = 0; c < 2; ++c)
+		{
+			REQUIRE(
+				((float *) batched.vertices[slot].attributes[0])[c]
+					== ((float *) scalar.vertices[slot].attributes[0])[c]
+			);
+		}
+	}
+	gpu_freeVertexCache(&batched);
+	gpu_freeVertexCache(&scalar);
+
+	// head without declared input type is not pulled into batch
+	cpu_setVertexPullerHead(gpu, puller, 1, buffer, 0, 3 * sizeof(float));
+	cpu_enableVertexPullerHead(gpu, puller, 1);
+	gpu_compileVertexFetch(
+		&fetch, gpu_getActiveVertexPuller(gpu), nofVertices, 0, 0
+	);
+	gpu_validateVertexFetch(gpu, fetch.nofVertexIDs, 1);
+	REQUIRE(!gpu_canShadeVertexBatches(gpu, &fetch));
+	gpu_invalidateVertexFetch(gpu);
+
+	cpu_destroyGPU(gpu);
+}
+
+
+TEST_CASE("Batched vertex shader should not pull vertices outside of buffer.")
+{
+	GPU gpu = cpu_createGPU();
+	const ProgramID program = cpu_createProgram(gpu);
+	cpu_attachBatchedVertexShader(gpu, program, vs_batchedScalePosition);
+	cpu_setAttributeInterpolation(gpu, program, 0, ATTRIB_VEC2, SMOOTH);
+	cpu_setVertexShaderInputType(gpu, program, 0, ATTRIB_VEC3);
+	cpu_useProgram(gpu, program);
+	const float positions[3 * VERTICES_PER_TRIANGLE] = {
+		-1.f, -1.f, .5f, 1.f, -1.f, .5f, -1.f, 1.f, .5f,
+	};
+	const uint32_t indices[2][VERTICES_PER_TRIANGLE] = {
+		{0, 1, 20}, {0, 1, 2},
+	};
+	BufferID buffers[3];
+	cpu_createBuffers(gpu, 3, buffers);
+	cpu_bufferData(gpu, buffers[0], sizeof(positions), positions);
+	cpu_bufferData(gpu, buffers[1], sizeof(indices[0]), indices[0]);
+	cpu_bufferData(gpu, buffers[2], sizeof(indices[1]), indices[1]);
+	VertexPullerID puller;
+	cpu_createVertexPullers(gpu, 1, &puller);
+	cpu_setVertexPullerHead(gpu, puller, 0, buffers[0], 0, 3 * sizeof(float));
+	cpu_enableVertexPullerHead(gpu, puller, 0);
+	cpu_setIndexing(gpu, puller, buffers[1], sizeof(uint32_t));
+	cpu_bindVertexPuller(gpu, puller);
+
+	GPUVertexFetch fetch;
+	gpu_compileVertexFetch(
+		&fetch, gpu_getActiveVertexPuller(gpu), VERTICES_PER_TRIANGLE, 0, 0
+	);
+	REQUIRE(fetch.nofVertexIDs == 21);
+	gpu_validateVertexFetch(gpu, VERTICES_PER_TRIANGLE, 1);
+	REQUIRE(gpu_isAttributeFetchValidated(gpu, 0, sizeof(Vec3)));
+	REQUIRE(gpu_canShadeVertexBatches(gpu, &fetch));
+	gpu_validateVertexFetch(gpu, fetch.nofVertexIDs, 1);
+	REQUIRE(!gpu_isAttributeFetchValidated(gpu, 0, sizeof(Vec3)));
+	REQUIRE(!gpu_canShadeVertexBatches(gpu, &fetch));
+	gpu_invalidateVertexFetch(gpu);
+
+	// program without scalar vertex shader cannot fall back, draw is skipped
+	cpu_resetPipelineStatistics(gpu);
+	cpu_drawTriangles(gpu, VERTICES_PER_TRIANGLE);
+	REQUIRE(cpu_getPipelineStatistics(gpu)->nofDrawCalls == 1);
+	REQUIRE(cpu_getPipelineStatistics(gpu)->nofVertexShaderInvocations == 0);
+	REQUIRE(cpu_getPipelineStatistics(gpu)->nofAssembledTriangles == 0);
+
+	// enabled head without buffer is not validated either
+	cpu_setIndexing(gpu, puller, buffers[2], sizeof(uint32_t));
+	cpu_setVertexShaderInputType(gpu, program, 1, ATTRIB_VEC2);
+	cpu_enableVertexPullerHead(gpu, puller, 1);
+	gpu_compileVertexFetch(
+		&fetch, gpu_getActiveVertexPuller(gpu), VERTICES_PER_TRIANGLE, 0, 0
+	);
+	gpu_validateVertexFetch(gpu, fetch.nofVertexIDs, 1);
+	REQUIRE(gpu_isAttributeFetchValidated(gpu, 0, sizeof(Vec3)));
+	REQUIRE(!gpu_isAttributeFetchValidated(gpu, 1, sizeof(Vec2)));
+	REQUIRE(!gpu_canShadeVertexBatches(gpu, &fetch));
+	gpu_invalidateVertexFetch(gpu);
+	cpu_drawTriangles(gpu, VERTICES_PER_TRIANGLE);
+	REQUIRE(cpu_getPipelineStatistics(gpu)->nofDrawCalls == 2);
+	REQUIRE(cpu_getPipelineStatistics(gpu)->nofAssembledTriangles == 0);
+
+	// parallel vertex shading takes the same decision
+	cpu_enable(gpu, PARALLEL_VERTEX_SHADING);
+	cpu_drawTriangles(gpu, VERTICES_PER_TRIANGLE);
+	REQUIRE(cpu_getPipelineStatistics(gpu)->nofDrawCalls == 3);
+	REQUIRE(cpu_getPipelineStatistics(gpu)->nofVertexShaderInvocations == 0);
+	REQUIRE(cpu_getPipelineStatistics(gpu)->nofAssembledTriangles == 0);
+
+	cpu_destroyGPU(gpu);
+}
+
+
+// thread-safe vertex shader for testing that writes gl_VertexID into position
+void vs_writeVertexIDParallel(
+	GPUVertexShaderOutput *const output,
+	const GPUVertexShaderInput *const input, const GPU
+)
+{
+	init_Vec4(&output->gl_Position, (float) input->gl_VertexID, 0.f, 0.f, 1.f);
+}
+
+
+TEST_CASE("Parallel vertex shading should shade every unique vertex once.")
+{
+	GPU gpu = cpu_createGPU();
+	cpu_setNofThreads(gpu, 4);
+	GPUVertexPullerConfiguration puller;
+	std::vector<VertexIndex> indices;
+	for (VertexIndex i = 0; i < 3000; ++i)
+	{ indices.push_back(5 + (i * 7) % 1000); }
+	puller.indices = indices.data();
+	puller.indexSize = sizeof(VertexIndex);
+	for (size_t a = 0; a < MAX_ATTRIBUTES; ++a)
+	{
+		puller.heads[a].buffer = (void *) nullptr;
+		puller.heads[a].stride = 0;
+		puller.heads[a].offset = 0;
+		puller.heads[a].enabled = 0;
+	}
+
+	GPUVertexFetch fetch;
+	gpu_compileVertexFetch(&fetch, &puller, indices.size(), 0, 0);
+	GPUVertexCache cache;
+	gpu_initVertexCache(&cache, &fetch, 1);
+	REQUIRE(cache.firstVertexID == 5);
+	REQUIRE(cache.nofVertices == 1000);
+	gpu_runParallelVertexShader(
+		gpu, &cache, &fetch, indices.size(), vs_writeVertexIDParallel, nullptr
+	);
+	REQUIRE(cache.complete == 1);
+	REQUIRE(cache.nofInvocations == 1000);
+	REQUIRE(cache.nofHits == 2000);
+	for (size_t slot = 0; slot < cache.nofVertices; ++slot)
+	{
+		REQUIRE(cache.shaded[slot] == 1);
+		REQUIRE(cache.vertices[slot].gl_Position.data[0] == (float) (slot + 5));
+	}
+	gpu_freeVertexCache(&cache);
+	cpu_destroyGPU(gpu);
+}
+
+
+TEST_CASE("Primitive assembler should follow topology and restart index.")
+{
+	GPUVertexPullerConfiguration puller;
+	const uint16_t indices[9] = {0, 1, 2, 3, 0xFFFF, 4, 5, 6, 7};
+	puller.indices = indices;
+	puller.indexSize = sizeof(uint16_t);
+	for (auto &head : puller.heads)
+	{ head.enabled = 0; }
+
+	GPUVertexFetch fetch;
+	gpu_compileVertexFetch(&fetch, &puller, 9, 1, 0xFFFF);
+	REQUIRE(fetch.nofVertexIDs == 8);
+
+	auto assemble = [&](const PrimitiveTopology topology, const size_t n)
+	{
+		std::vector<VertexShaderInvocation> result;
+		GPUPrimitiveAssembler assembler;
+		gpu_initPrimitiveAssembler(&assembler, topology, &fetch, n);
+		VertexShaderInvocation invocations[VERTICES_PER_TRIANGLE];
+		while (gpu_assembleTriangle(&assembler, invocations))
+		{
+			result.insert(
+				result.end(), invocations, invocations + VERTICES_PER_TRIANGLE
+			);
+		}
+		return result;
+	};
+
+	// odd strip triangles are flipped, restart starts new strip
+	const std::vector<VertexShaderInvocation> strip = {
+		0, 1, 2, 2, 1, 3, 5, 6, 7, 7, 6, 8
+	};
+	REQUIRE(assemble(TOPOLOGY_TRIANGLE_STRIP, 9) == strip);
+	const std::vector<VertexShaderInvocation> fan = {
+		0, 1, 2, 0, 2, 3, 5, 6, 7, 5, 7, 8
+	};
+	REQUIRE(assemble(TOPOLOGY_TRIANGLE_FAN, 9) == fan);
+	// restart discards unfinished triangle of list
+	const std::vector<VertexShaderInvocation> list = {0, 1, 2, 5, 6, 7};
+	REQUIRE(assemble(TOPOLOGY_TRIANGLES, 9) == list);
+	REQUIRE(assemble(TOPOLOGY_TRIANGLE_STRIP, 2).empty());
+
+	// restart index is an ordinary index when restart is disabled
+	gpu_compileVertexFetch(&fetch, &puller, 9, 0, 0xFFFF);
+	REQUIRE(fetch.nofVertexIDs == 0x10000);
+	REQUIRE(assemble(TOPOLOGY_TRIANGLE_STRIP, 9).size() == 7 * 3);
+}
+
+
+// vertex shader for testing that writes gl_VertexID and gl_InstanceID into
+// position
+void vs_writeInstanceID(
+	GPUVertexShaderOutput *const output,
+	const GPUVertexShaderInput *const input, const GPU
+)
+{
+	init_Vec4(
+		&output->gl_Position, (float) input->gl_VertexID,
+		(float) input->gl_InstanceID, 0.f, 1.f
+	);
+	vsInvocationCounter++;
+}
+
+
+TEST_CASE("Instanced vertex fetch should advance heads with divisor.")
+{
+	auto gpu = (GPU) 19;
+	GPUVertexPullerConfiguration puller;
+	const VertexIndex indices[6] = {0, 1, 2, 2, 1, 3};
+	puller.indices = indices;
+	puller.indexSize = sizeof(VertexIndex);
+	for (size_t a = 0; a < MAX_ATTRIBUTES; ++a)
+	{
+		puller.heads[a].buffer = (void *) (1000 * (a + 1));
+		puller.heads[a].stride = 8 * (a + 1);
+		puller.heads[a].offset = 4 * a;
+		puller.heads[a].enabled = a < 2;
+		puller.heads[a].divisor = a == 1 ? 2 : 0;
+	}
+
+	GPUVertexFetch fetch;
+	gpu_compileVertexFetch(&fetch, &puller, 6, 0, 0);
+	GPUVertexCache cache;
+	gpu_initVertexCache(&cache, &fetch, 0);
+	vsInvocationCounter = 0;
+	for (VertexIndex instance = 0; instance < 5; ++instance)
+	{
+		gpu_setVertexFetchInstance(&fetch, instance);
+		if (instance > 0)
+		{ gpu_resetVertexCache(&cache); }
+		for (VertexIndex v = 0; v < 4; ++v)
+		{
+			GPUVertexPullerOutput output;
+			gpu_runVertexFetch(&output, &fetch, v);
+			REQUIRE((size_t) output.attributes[0] == 1000 + 8 * v);
+			REQUIRE(
+				(size_t) output.attributes[1] == 2000 + 4 + 16 * (instance / 2)
+			);
+			REQUIRE(output.attributes[2] == nullptr);
+		}
+		for (size_t base = 0; base < 6; base += VERTICES_PER_TRIANGLE)
+		{
+			GPUPrimitive primitive;
+			gpu_runCachedPrimitiveAssembly(
+				gpu, &primitive, VERTICES_PER_TRIANGLE, &fetch, base,
+				vs_writeInstanceID, &cache
+			);
+			for (size_t v = 0; v < VERTICES_PER_TRIANGLE; ++v)
+			{
+				REQUIRE(
+					primitive.vertices[v].gl_Position.data[0]
+						== (float) indices[base + v]
+				);
+				REQUIRE(
+					primitive.vertices[v].gl_Position.data[1]
+						== (float) instance
+				);
+			}
+		}
+	}
+	REQUIRE(vsInvocationCounter == 5 * 4);
+	gpu_freeVertexCache(&cache);
+}
+
+
+std::vector<VertexIndex> shadedVertexIDs;
+
+// vertex shader for testing that records gl_VertexID of every invocation
+void vs_recordVertexID(
+	GPUVertexShaderOutput *const output,
+	const GPUVertexShaderInput *const input, const GPU
+)
+{
+	init_Vec4(&output->gl_Position, (float) input->gl_VertexID, 0.f, 0.f, 1.f);
+	shadedVertexIDs.push_back(input->gl_VertexID);
+}
+
+
+TEST_CASE("Multi-draw and indirect draw should process all commands.")
+{
+	GPU gpu = cpu_createGPU();
+	cpu_setViewportSize(gpu, 32, 32);
+	const ProgramID program = cpu_createProgram(gpu);
+	cpu_attachVertexShader(gpu, program, vs_recordVertexID);
+	cpu_useProgram(gpu, program);
+	BufferID buffers[2];
+	cpu_createBuffers(gpu, 2, buffers);
+	const uint8_t indices[6] = {0, 1, 2, 3, 4, 5};
+	cpu_bufferData(gpu, buffers[0], sizeof(indices), indices);
+	VertexPullerID puller;
+	cpu_createVertexPullers(gpu, 1, &puller);
+	cpu_setIndexing(gpu, puller, buffers[0], sizeof(uint8_t));
+	cpu_bindVertexPuller(gpu, puller);
+
+	const DrawTrianglesCommand commands[3] = {
+		{3, 1, 3, 10},
+		{0, 5, 0, 0},
+		{3, 2, 0, 0},
+	};
+	const std::vector<VertexIndex> expected = {13, 14, 15, 0, 1, 2, 0, 1, 2};
+	cpu_resetPipelineStatistics(gpu);
+	shadedVertexIDs.clear();
+	cpu_multiDrawTriangles(gpu, commands, 3);
+	REQUIRE(shadedVertexIDs == expected);
+	REQUIRE(cpu_getPipelineStatistics(gpu)->nofDrawCalls == 3);
+	REQUIRE(cpu_getPipelineStatistics(gpu)->nofAssembledTriangles == 3);
+
+	// the same commands are read from buffer
+	cpu_bufferData(gpu, buffers[1], sizeof(commands), commands);
+	shadedVertexIDs.clear();
+	cpu_drawTrianglesIndirect(gpu, buffers[1], 0, 3, 0);
+	REQUIRE(shadedVertexIDs == expected);
+	shadedVertexIDs.clear();
+	cpu_drawTrianglesIndirect(
+		gpu, buffers[1], sizeof(DrawTrianglesCommand), 1,
+		2 * sizeof(DrawTrianglesCommand)
+	);
+	REQUIRE(shadedVertexIDs.empty());
+	cpu_drawTrianglesIndirect(
+		gpu, buffers[1], 0, 2, 2 * sizeof(DrawTrianglesCommand)
+	);
+	REQUIRE(shadedVertexIDs == expected);
+
+	// commands that read behind index buffer or below vertex 0 are skipped
+	const DrawTrianglesCommand invalidCommands[4] = {
+		{3, 1, 4, 0},
+		{3, 1, (size_t) -1, 0},
+		{3, 1, 0, -1},
+		{3, 1, 3, -3},
+	};
+	shadedVertexIDs.clear();
+	cpu_multiDrawTriangles(gpu, invalidCommands, 4);
+	REQUIRE(shadedVertexIDs == std::vector<VertexIndex>({0, 1, 2}));
+
+	cpu_destroyGPU(gpu);
+}
+
+
+TEST_CASE("Bounding volume culling should skip draws outside of frustum.")
+{
+	Mat4 identity;
+	identity_Mat4(&identity);
+	const float inside[2][3] = {{-.5f, -.5f, -.5f}, {.5f, .5f, .5f}};
+	const float outside[2][3] = {{2.f, -.5f, -.5f}, {3.f, .5f, .5f}};
+	const float behind[2][3] = {{-.5f, -.5f, -3.f}, {.5f, .5f, -2.f}};
+	const float corner[2][3] = {{.5f, .5f, -.5f}, {3.f, 3.f, .5f}};
+	REQUIRE(!gpu_isBoundingBoxOutsideFrustum(&identity, inside[0], inside[1]));
+	REQUIRE(gpu_isBoundingBoxOutsideFrustum(&identity, outside[0], outside[1]));
+	REQUIRE(gpu_isBoundingBoxOutsideFrustum(&identity, behind[0], behind[1]));
+	REQUIRE(!gpu_isBoundingBoxOutsideFrustum(&identity, corner[0], corner[1]));
+
+	GPU gpu = cpu_createGPU();
+	cpu_setViewportSize(gpu, 32, 32);
+	const ProgramID program = cpu_createProgram(gpu);
+	cpu_attachVertexShader(gpu, program, vs_recordVertexID);
+	cpu_useProgram(gpu, program);
+	VertexPullerID puller;
+	cpu_createVertexPullers(gpu, 1, &puller);
+	cpu_bindVertexPuller(gpu, puller);
+	cpu_enable(gpu, BOUNDING_VOLUME_CULLING);
+	Vec3 min;
+	Vec3 max;
+	init_Vec3(&min, outside[0][0], outside[0][1], outside[0][2]);
+	init_Vec3(&max, outside[1][0], outside[1][1], outside[1][2]);
+	cpu_setVertexPullerBoundingBox(gpu, puller, &min, &max);
+
+	cpu_resetPipelineStatistics(gpu);
+	shadedVertexIDs.clear();
+	cpu_drawTriangles(gpu, 3);
+	REQUIRE(shadedVertexIDs.empty());
+	REQUIRE(cpu_getPipelineStatistics(gpu)->nofDrawCalls == 1);
+	REQUIRE(cpu_getPipelineStatistics(gpu)->nofCulledDrawCalls == 1);
+
+	// culling matrix moves box into frustum
+	Mat4 translation;
+	translate_Mat4(&translation, -2.5f, 0.f, 0.f);
+	cpu_setCullingMatrix(gpu, &translation);
+	cpu_drawTriangles(gpu, 3);
+	REQUIRE(shadedVertexIDs.size() == 3);
+	REQUIRE(cpu_getPipelineStatistics(gpu)->nofCulledDrawCalls == 1);
+
+	// draw without bounding box is never culled
+	cpu_setCullingMatrix(gpu, &identity);
+	cpu_setVertexPullerBoundingBox(gpu, puller, nullptr, nullptr);
+	cpu_drawTriangles(gpu, 3);
+	REQUIRE(shadedVertexIDs.size() == 6);
+	REQUIRE(cpu_getPipelineStatistics(gpu)->nofDrawCalls == 3);
+
+	cpu_destroyGPU(gpu);
+}
+
 
 TEST_CASE(
 	"SOLUTION_TEST: gpu_runPrimitiveAssembly should construct primitive")
@@ -290,6 +906,7 @@ TEST_CASE(
 	GPUVertexPullerConfiguration puller;
 	const VertexIndex indices[8] = {1, 3, 2, 1, 2, 4, 5, 100};
 	puller.indices = indices;
+	puller.indexSize = sizeof(VertexIndex);
 	puller.heads[0].buffer = (void *) 1000;
 	puller.heads[0].stride = 100;
 	puller.heads[0].offset = 1000;
@@ -725,6 +1342,1179 @@ TEST_CASE("phong_fragmentShader should compute phong color.")
 }
 
 
+TEST_CASE("Rasterization kernels should create the same fragments.")
+{
+	// screen-space triangle with smooth and noperspective attributes
+	GPUPrimitive primitive;
+	primitive.nofUsedVertices = VERTICES_PER_TRIANGLE;
+	for (size_t a = 0; a < MAX_ATTRIBUTES; ++a)
+	{ primitive.types[a] = ATTRIB_EMPTY; }
+	primitive.types[0] = ATTRIB_VEC3;
+	primitive.interpolations[0] = SMOOTH;
+	primitive.types[1] = ATTRIB_FLOAT;
+	primitive.interpolations[1] = NOPERSPECTIVE;
+	const float positions[VERTICES_PER_TRIANGLE][4] = {
+		{1.f, 1.f, .5f, 1.f}, {17.f, 3.f, .5f, 2.f}, {5.f, 14.f, .5f, 4.f},
+	};
+	for (size_t v = 0; v < VERTICES_PER_TRIANGLE; ++v)
+	{
+		init_Vec4(
+			&primitive.vertices[v].gl_Position, positions[v][0],
+			positions[v][1], positions[v][2], positions[v][3]
+		);
+		init_Vec3(
+			(Vec3 *) primitive.vertices[v].attributes[0], (float) v, 1.f,
+			10.f * (float) v
+		);
+		*(float *) primitive.vertices[v].attributes[1] = 2.f * (float) v;
+	}
+	GPUTriangleSetup setup;
+	REQUIRE(gpu_setupTriangle(&setup, &primitive, 20, 20, 0));
+
+	size_t nofKernels;
+	const GPURasterizationKernelInfo *const kernels =
+		gpu_getRasterizationKernels(&nofKernels);
+	const GPURasterizationKernelInfo *const scalar = kernels + nofKernels - 1;
+	REQUIRE(scalar->nofQuads == 1);
+	for (size_t k = 0; k < nofKernels; ++k)
+	{
+		const GPURasterizationKernelInfo *const kernel = kernels + k;
+		for (size_t y = 0; y < 20; y += QUAD_SIZE)
+		{
+			for (size_t x = 0; x < 20; x += QUAD_SIZE * kernel->nofQuads)
+			{
+				GPUFragmentQuad quads[KERNEL_MAX_QUADS];
+				for (size_t q = 0; q < kernel->nofQuads; ++q)
+				{
+					quads[q].x = x + q * QUAD_SIZE;
+					quads[q].y = y;
+					quads[q].mask = QUAD_FULL_MASK;
+				}
+				kernel->kernel(quads, &setup);
+
+				for (size_t q = 0; q < kernel->nofQuads; ++q)
+				{
+					GPUFragmentQuad expected;
+					expected.x = quads[q].x;
+					expected.y = quads[q].y;
+					expected.mask = QUAD_FULL_MASK;
+					scalar->kernel(&expected, &setup);
+					REQUIRE(quads[q].mask == expected.mask);
+					for (size_t l = 0; l < FRAGMENTS_PER_QUAD; ++l)
+					{
+						if (!(expected.mask & (1u << l)))
+						{ continue; }
+						const GPUFragmentShaderInput &a = quads[q].inputs[l];
+						const GPUFragmentShaderInput &b = expected.inputs[l];
+						REQUIRE(a.coords.data[0] == b.coords.data[0]);
+						REQUIRE(a.coords.data[1] == b.coords.data[1]);
+						REQUIRE(equalFloats(a.depth, b.depth));
+						for (size_t c = 0; c < 3; ++c)
+						{
+							REQUIRE(equalFloats(
+								((const float *) a.attributes.attributes[0])[c],
+								((const float *) b.attributes.attributes[0])[c]
+							));
+						}
+						REQUIRE(equalFloats(
+							*(const float *) a.attributes.attributes[1],
+							*(const float *) b.attributes.attributes[1]
+						));
+					}
+				}
+			}
+		}
+	}
+}
+
+
+// vertex shader for testing that passes clip-space position of attribute 0
+void vs_passPosition(
+	GPUVertexShaderOutput *const output,
+	const GPUVertexShaderInput *const input, const GPU gpu
+)
+{
+	copy_Vec4(
+		&output->gl_Position,
+		vs_interpretInputVertexAttributeAsVec4(gpu, input, 0)
+	);
+}
+
+
+// fragment shader that colors fragments by their coords and depth
+void fs_colorByCoords(
+	GPUFragmentShaderOutput *const output,
+	const GPUFragmentShaderInput *const input, const GPU gpu
+)
+{
+	(void) gpu;
+	init_Vec4(
+		&output->color, input->coords.data[0] / 256.f,
+		input->coords.data[1] / 256.f, input->depth / 16.f, 1.f
+	);
+}
+
+
+TEST_CASE("Tiled rasterization should produce the same buffers.")
+{
+	// triangles with perspective cross edges of tiles
+	const size_t width = 3 * TILE_SIZE - 7;
+	const size_t height = 2 * TILE_SIZE + 5;
+	std::vector<float> positions;
+	unsigned seed = 1;
+	const auto random = [&seed]()
+	{
+		seed = seed * 1103515245u + 12345u;
+		return (float) ((seed >> 8) % 2001u) / 1000.f - 1.f;
+	};
+	for (size_t v = 0; v < 3 * 40; ++v)
+	{
+		const float w = 2.f + random();
+		positions.push_back(random() * 1.2f * w);
+		positions.push_back(random() * 1.2f * w);
+		positions.push_back(random() * .5f * w);
+		positions.push_back(w);
+	}
+
+	std::vector<Vec4> colors[2];
+	std::vector<float> depths[2];
+	for (int tiled = 0; tiled < 2; ++tiled)
+	{
+		GPU gpu = cpu_createGPU();
+		cpu_setNofThreads(gpu, 4);
+		cpu_setViewportSize(gpu, width, height);
+		const ProgramID program = cpu_createProgram(gpu);
+		cpu_attachVertexShader(gpu, program, vs_passPosition);
+		cpu_attachFragmentShader(gpu, program, fs_colorByCoords);
+		cpu_useProgram(gpu, program);
+		BufferID buffer;
+		cpu_createBuffers(gpu, 1, &buffer);
+		cpu_bufferData(
+			gpu, buffer, positions.size() * sizeof(float), positions.data()
+		);
+		VertexPullerID puller;
+		cpu_createVertexPullers(gpu, 1, &puller);
+		cpu_setVertexPullerHead(gpu, puller, 0, buffer, 0, 4 * sizeof(float));
+		cpu_enableVertexPullerHead(gpu, puller, 0);
+		cpu_bindVertexPuller(gpu, puller);
+		if (tiled)
+		{ cpu_enable(gpu, TILED_RASTERIZATION); }
+
+		cpu_clearDepth(gpu, 16.f);
+		cpu_drawTriangles(gpu, positions.size() / 4);
+		for (size_t y = 0; y < height; ++y)
+		{
+			for (size_t x = 0; x < width; ++x)
+			{
+				colors[tiled].push_back(*cpu_getColor(gpu, x, y));
+				depths[tiled].push_back(gpu_getDepth(gpu, x, y));
+			}
+		}
+		cpu_destroyGPU(gpu);
+	}
+
+	size_t nofCovered = 0;
+	for (size_t p = 0; p < width * height; ++p)
+	{
+		REQUIRE(depths[0][p] == depths[1][p]);
+		for (size_t c = 0; c < 4; ++c)
+		{ REQUIRE(colors[0][p].data[c] == colors[1][p].data[c]); }
+		nofCovered += depths[0][p] < 16.f;
+	}
+	REQUIRE(nofCovered > width * height / 4);
+}
+
+
+// number of fragments of every pixel created by fs_countFragments
+size_t fragmentCounts[32][32];
+
+
+// fragment shader that counts fragments of pixels
+void fs_countFragments(
+	GPUFragmentShaderOutput *const output,
+	const GPUFragmentShaderInput *const input, const GPU gpu
+)
+{
+	(void) gpu;
+	fragmentCounts[(size_t) input->coords.data[1]]
+		[(size_t) input->coords.data[0]]++;
+	zero_Vec4(&output->color);
+}
+
+
+TEST_CASE("Top-left rule should cover pixels of shared edges once.")
+{
+	// square [4.5,20.5]^2 in pixels is split by its diagonal, all edges go
+	// through pixel centers
+	const float corners[4][2] = {
+		{4.5f, 4.5f}, {20.5f, 4.5f}, {20.5f, 20.5f}, {4.5f, 20.5f}
+	};
+	const size_t triangles[2][VERTICES_PER_TRIANGLE] = {{0, 1, 2}, {0, 2, 3}};
+	float positions[2 * VERTICES_PER_TRIANGLE][4];
+	for (size_t t = 0; t < 2; ++t)
+	{
+		for (size_t v = 0; v < VERTICES_PER_TRIANGLE; ++v)
+		{
+			float *const position = positions[t * VERTICES_PER_TRIANGLE + v];
+			position[0] = corners[triangles[t][v]][0] / 16.f - 1.f;
+			position[1] = corners[triangles[t][v]][1] / 16.f - 1.f;
+			position[2] = 0.f;
+			position[3] = 1.f;
+		}
+	}
+
+	GPU gpu = cpu_createGPU();
+	cpu_setViewportSize(gpu, 32, 32);
+	const ProgramID program = cpu_createProgram(gpu);
+	cpu_attachVertexShader(gpu, program, vs_passPosition);
+	cpu_attachFragmentShader(gpu, program, fs_countFragments);
+	cpu_useProgram(gpu, program);
+	BufferID buffer;
+	cpu_createBuffers(gpu, 1, &buffer);
+	cpu_bufferData(gpu, buffer, sizeof(positions), positions);
+	VertexPullerID puller;
+	cpu_createVertexPullers(gpu, 1, &puller);
+	cpu_setVertexPullerHead(gpu, puller, 0, buffer, 0, 4 * sizeof(float));
+	cpu_enableVertexPullerHead(gpu, puller, 0);
+	cpu_bindVertexPuller(gpu, puller);
+
+	for (int fixedPoint = 0; fixedPoint < 2; ++fixedPoint)
+	{
+		if (fixedPoint)
+		{ cpu_enable(gpu, FIXED_POINT_RASTERIZATION); }
+		cpu_clearDepth(gpu, 2.f);
+		memset(fragmentCounts, 0, sizeof(fragmentCounts));
+		cpu_drawTriangles(gpu, 2 * VERTICES_PER_TRIANGLE);
+
+		// left and top edges own their pixels, right and bottom edges do not
+		// (row 0 is at the bottom of screen)
+		for (size_t y = 0; y < 32; ++y)
+		{
+			for (size_t x = 0; x < 32; ++x)
+			{
+				const bool inside = x >= 4 && x < 20 && y > 4 && y <= 20;
+				REQUIRE(fragmentCounts[y][x] == (inside ? 1u : 0u));
+			}
+		}
+	}
+
+	cpu_destroyGPU(gpu);
+}
+
+
+TEST_CASE("Quad coverage should match screen-space barycentrics.")
+{
+	// no pixel center lies on edge of triangle
+	Vec2 vertices[VERTICES_PER_TRIANGLE];
+	init_Vec2(vertices + 0, 1.f, 1.f);
+	init_Vec2(vertices + 1, 17.f, 3.f);
+	init_Vec2(vertices + 2, 5.f, 14.f);
+	float positions[VERTICES_PER_TRIANGLE][4];
+	for (size_t v = 0; v < VERTICES_PER_TRIANGLE; ++v)
+	{
+		positions[v][0] = vertices[v].data[0] / 16.f - 1.f;
+		positions[v][1] = vertices[v].data[1] / 16.f - 1.f;
+		positions[v][2] = 0.f;
+		positions[v][3] = 1.f;
+	}
+	Vec3 lines[EDGES_PER_TRIANGLE];
+	gpu_computeTriangleLines(lines, vertices);
+	const auto covers = [&](const size_t x, const size_t y)
+	{
+		Vec2 pixelCenter;
+		init_Vec2(
+			&pixelCenter, (float) x + PIXEL_CENTER, (float) y + PIXEL_CENTER
+		);
+		Vec3 coords;
+		gpu_computeScreenSpaceBarycentrics(
+			&coords, &pixelCenter, vertices, lines
+		);
+		return coords.data[0] > 0.f && coords.data[1] > 0.f
+			&& coords.data[2] > 0.f;
+	};
+
+	GPU gpu = cpu_createGPU();
+	cpu_setViewportSize(gpu, 32, 32);
+	const ProgramID program = cpu_createProgram(gpu);
+	cpu_attachVertexShader(gpu, program, vs_passPosition);
+	cpu_attachFragmentShader(gpu, program, fs_countFragments);
+	cpu_useProgram(gpu, program);
+	BufferID buffer;
+	cpu_createBuffers(gpu, 1, &buffer);
+	cpu_bufferData(gpu, buffer, sizeof(positions), positions);
+	VertexPullerID puller;
+	cpu_createVertexPullers(gpu, 1, &puller);
+	cpu_setVertexPullerHead(gpu, puller, 0, buffer, 0, 4 * sizeof(float));
+	cpu_enableVertexPullerHead(gpu, puller, 0);
+	cpu_bindVertexPuller(gpu, puller);
+
+	// helper lanes of quads are not shaded
+	for (int fixedPoint = 0; fixedPoint < 2; ++fixedPoint)
+	{
+		if (fixedPoint)
+		{ cpu_enable(gpu, FIXED_POINT_RASTERIZATION); }
+		cpu_clearDepth(gpu, 10.f);
+		memset(fragmentCounts, 0, sizeof(fragmentCounts));
+		cpu_drawTriangles(gpu, VERTICES_PER_TRIANGLE);
+		for (size_t y = 0; y < 32; ++y)
+		{
+			for (size_t x = 0; x < 32; ++x)
+			{ REQUIRE(fragmentCounts[y][x] == (covers(x, y) ? 1u : 0u)); }
+		}
+	}
+
+	// kernels only clear bits of lanes that are already masked out
+	GPUPrimitive primitive;
+	primitive.nofUsedVertices = VERTICES_PER_TRIANGLE;
+	for (size_t a = 0; a < MAX_ATTRIBUTES; ++a)
+	{ primitive.types[a] = ATTRIB_EMPTY; }
+	for (size_t v = 0; v < VERTICES_PER_TRIANGLE; ++v)
+	{
+		init_Vec4(
+			&primitive.vertices[v].gl_Position, vertices[v].data[0],
+			vertices[v].data[1], .5f, 1.f
+		);
+	}
+	GPUTriangleSetup setup;
+	REQUIRE(gpu_setupTriangle(&setup, &primitive, 32, 32, 0));
+	size_t nofKernels;
+	const GPURasterizationKernelInfo *const kernels =
+		gpu_getRasterizationKernels(&nofKernels);
+	for (size_t k = 0; k < nofKernels; ++k)
+	{
+		const GPURasterizationKernelInfo *const kernel = kernels + k;
+		for (size_t y = 0; y < 20; y += QUAD_SIZE)
+		{
+			for (size_t x = 0; x < 20; x += QUAD_SIZE * kernel->nofQuads)
+			{
+				GPUFragmentQuad quads[KERNEL_MAX_QUADS];
+				for (size_t q = 0; q < kernel->nofQuads; ++q)
+				{
+					quads[q].x = x + q * QUAD_SIZE;
+					quads[q].y = y;
+					// helper lanes of neighbouring quads differ
+					quads[q].mask = q % 2 ? 0x9u : 0x6u;
+				}
+				kernel->kernel(quads, &setup);
+
+				for (size_t q = 0; q < kernel->nofQuads; ++q)
+				{
+					unsigned expected = 0;
+					for (size_t l = 0; l < FRAGMENTS_PER_QUAD; ++l)
+					{
+						if (covers(
+								quads[q].x + l % QUAD_SIZE,
+								quads[q].y + l / QUAD_SIZE
+							))
+						{ expected |= 1u << l; }
+					}
+					const unsigned laneMask = q % 2 ? 0x9u : 0x6u;
+					REQUIRE(quads[q].mask == (expected & laneMask));
+				}
+			}
+		}
+	}
+
+	// per-quad operations do not write masked lanes
+	cpu_clearDepth(gpu, 10.f);
+	GPUFragmentQuad quad;
+	quad.x = 2;
+	quad.y = 4;
+	quad.mask = 0x5u;
+	for (size_t l = 0; l < FRAGMENTS_PER_QUAD; ++l)
+	{
+		quad.outputs[l].depth = 1.f;
+		quad.outputs[l].discard = 0;
+		init_Vec4(&quad.outputs[l].color, 1.f, 1.f, 1.f, 1.f);
+	}
+	REQUIRE(gpu_perQuadOperations(gpu, &quad) == 0x5u);
+	REQUIRE(gpu_getDepth(gpu, 2, 4) == 1.f);
+	REQUIRE(gpu_getDepth(gpu, 3, 4) == 10.f);
+	REQUIRE(gpu_getDepth(gpu, 2, 5) == 1.f);
+	REQUIRE(gpu_getDepth(gpu, 3, 5) == 10.f);
+
+	// discarded lanes are not written either
+	cpu_clearDepth(gpu, 10.f);
+	quad.mask = 0xfu;
+	quad.outputs[1].discard = 1;
+	REQUIRE(gpu_perQuadOperations(gpu, &quad) == 0xdu);
+	REQUIRE(gpu_getDepth(gpu, 2, 4) == 1.f);
+	REQUIRE(gpu_getDepth(gpu, 3, 4) == 10.f);
+	REQUIRE(gpu_getDepth(gpu, 2, 5) == 1.f);
+	REQUIRE(gpu_getDepth(gpu, 3, 5) == 1.f);
+
+	cpu_destroyGPU(gpu);
+}
+
+
+TEST_CASE("Fixed-point rasterization should be watertight.")
+{
+	GPU gpu = cpu_createGPU();
+	cpu_setViewportSize(gpu, 32, 32);
+	memset(fragmentCounts, 0, sizeof(fragmentCounts));
+
+	// square [2.3,29.7]^2 split into triangle fan around pixel center, inner
+	// edges of the fan are diagonals that go through pixel centers
+	const float fan[][2] = {
+		{2.3f, 2.3f}, {29.7f, 2.3f}, {29.7f, 29.7f}, {2.3f, 29.7f},
+	};
+	const float center[2] = {16.5f, 16.5f};
+	size_t kernelCount;
+	const GPURasterizationKernelInfo *const kernel =
+		gpu_getRasterizationKernels(&kernelCount);
+	for (size_t t = 0; t < 4; ++t)
+	{
+		GPUPrimitive primitive;
+		primitive.nofUsedVertices = VERTICES_PER_TRIANGLE;
+		for (size_t a = 0; a < MAX_ATTRIBUTES; ++a)
+		{ primitive.types[a] = ATTRIB_EMPTY; }
+		init_Vec4(
+			&primitive.vertices[0].gl_Position, center[0], center[1], 0.f, 1.f
+		);
+		init_Vec4(
+			&primitive.vertices[1].gl_Position, fan[t][0], fan[t][1], 0.f, 1.f
+		);
+		init_Vec4(
+			&primitive.vertices[2].gl_Position, fan[(t + 1) % 4][0],
+			fan[(t + 1) % 4][1], 0.f, 1.f
+		);
+		GPUTriangleSetup setup;
+		REQUIRE(gpu_setupTriangle(&setup, &primitive, 32, 32, 1));
+		REQUIRE(setup.fixedPoint);
+		GPURasterizationState state;
+		state.fragmentShader = fs_countFragments;
+		state.kernel = kernel;
+		state.fixedPoint = 1;
+		state.hierarchicalDepth = 0;
+		state.earlyDepthTest = 0;
+		gpu_rasterizeTriangleRegion(gpu, &setup, &state, 0, 0, 32, 32);
+	}
+
+	for (size_t y = 0; y < 32; ++y)
+	{
+		for (size_t x = 0; x < 32; ++x)
+		{
+			const bool inside = x >= 2 && x <= 29 && y >= 2 && y <= 29;
+			REQUIRE(fragmentCounts[y][x] == (inside ? 1u : 0u));
+		}
+	}
+
+	cpu_destroyGPU(gpu);
+}
+
+
+TEST_CASE("Attribute planes should interpolate with perspective correction.")
+{
+	// counter-clockwise and clockwise triangle with different w in vertices
+	for (int clockwise = 0; clockwise < 2; ++clockwise)
+	{
+		GPUPrimitive primitive;
+		primitive.nofUsedVertices = VERTICES_PER_TRIANGLE;
+		for (size_t a = 0; a < MAX_ATTRIBUTES; ++a)
+		{ primitive.types[a] = ATTRIB_EMPTY; }
+		primitive.types[0] = ATTRIB_VEC3;
+		primitive.interpolations[0] = SMOOTH;
+		primitive.types[1] = ATTRIB_FLOAT;
+		primitive.interpolations[1] = NOPERSPECTIVE;
+		primitive.types[3] = ATTRIB_VEC2;
+		primitive.interpolations[3] = FLAT;
+		const float positions[VERTICES_PER_TRIANGLE][4] = {
+			{2.f, 1.f, .5f, 1.f}, {13.f, 4.f, .5f, 8.f}, {4.f, 11.f, .5f, 3.f},
+		};
+		for (size_t v = 0; v < VERTICES_PER_TRIANGLE; ++v)
+		{
+			const size_t p = clockwise && v ? VERTICES_PER_TRIANGLE - v : v;
+			init_Vec4(
+				&primitive.vertices[v].gl_Position, positions[p][0],
+				positions[p][1], positions[p][2], positions[p][3]
+			);
+			init_Vec3(
+				(Vec3 *) primitive.vertices[v].attributes[0], (float) p,
+				1.f - (float) p, 10.f * (float) p
+			);
+			*(float *) primitive.vertices[v].attributes[1] = 4.f * (float) p;
+			init_Vec2(
+				(Vec2 *) primitive.vertices[v].attributes[3], 5.f + (float) p,
+				-(float) p
+			);
+		}
+		GPUTriangleSetup setup;
+		REQUIRE(gpu_setupTriangle(&setup, &primitive, 16, 16, 0));
+
+		Vec2 vertices[VERTICES_PER_TRIANGLE];
+		for (size_t v = 0; v < VERTICES_PER_TRIANGLE; ++v)
+		{
+			copy_Vec4_To_Vec2(vertices + v, &primitive.vertices[v].gl_Position);
+		}
+		Vec3 lines[EDGES_PER_TRIANGLE];
+		gpu_computeTriangleLines(lines, vertices);
+
+		// reference interpolations from screen-space barycentrics
+		const auto noperspective = [&](
+			const Vec3 &coords, size_t attribute, size_t component
+		)
+		{
+			float result = 0.f;
+			for (size_t v = 0; v < VERTICES_PER_TRIANGLE; ++v)
+			{
+				result += coords.data[v] * ((const float *)
+					primitive.vertices[v].attributes[attribute])[component];
+			}
+			return result;
+		};
+		const auto smooth = [&](
+			const Vec3 &coords, const float values[VERTICES_PER_TRIANGLE]
+		)
+		{
+			float dividend = 0.f;
+			float divisor = 0.f;
+			for (size_t v = 0; v < VERTICES_PER_TRIANGLE; ++v)
+			{
+				const float weight =
+					coords.data[v] / primitive.vertices[v].gl_Position.data[3];
+				dividend += values[v] * weight;
+				divisor += weight;
+			}
+			return dividend / divisor;
+		};
+		float ws[VERTICES_PER_TRIANGLE];
+		for (size_t v = 0; v < VERTICES_PER_TRIANGLE; ++v)
+		{ ws[v] = primitive.vertices[v].gl_Position.data[3]; }
+
+		size_t nofKernels;
+		const GPURasterizationKernelInfo *const kernels =
+			gpu_getRasterizationKernels(&nofKernels);
+		for (size_t k = 0; k < nofKernels; ++k)
+		{
+			const GPURasterizationKernelInfo *const kernel = kernels + k;
+			size_t nofFragments = 0;
+			float maxCorrection = 0.f;
+			for (size_t y = 0; y < 16; y += QUAD_SIZE)
+			{
+				for (size_t x = 0; x < 16; x += QUAD_SIZE * kernel->nofQuads)
+				{
+					GPUFragmentQuad quads[KERNEL_MAX_QUADS];
+					for (size_t q = 0; q < kernel->nofQuads; ++q)
+					{
+						quads[q].x = x + q * QUAD_SIZE;
+						quads[q].y = y;
+						quads[q].mask = QUAD_FULL_MASK;
+					}
+					kernel->kernel(quads, &setup);
+
+					for (size_t q = 0; q < kernel->nofQuads; ++q)
+					{
+						for (size_t l = 0; l < FRAGMENTS_PER_QUAD; ++l)
+						{
+							if (!(quads[q].mask & (1u << l)))
+							{ continue; }
+							const GPUFragmentShaderInput &a = quads[q].inputs[l];
+							Vec3 coords;
+							gpu_computeScreenSpaceBarycentrics(
+								&coords, &a.coords, vertices, lines
+							);
+							nofFragments++;
+
+							REQUIRE(equalFloats(a.depth, smooth(coords, ws)));
+							for (size_t c = 0; c < 3; ++c)
+							{
+								const float value = ((const float *)
+									a.attributes.attributes[0])[c];
+								const float values[VERTICES_PER_TRIANGLE] = {
+									((const float *)
+										primitive.vertices[0].attributes[0])[c],
+									((const float *)
+										primitive.vertices[1].attributes[0])[c],
+									((const float *)
+										primitive.vertices[2].attributes[0])[c],
+								};
+								REQUIRE(equalFloats(
+									value, smooth(coords, values)
+								));
+								// smooth value differs from screen-space one
+								maxCorrection = fmaxf(maxCorrection, fabsf(
+									value - noperspective(coords, 0, c)
+								));
+							}
+							REQUIRE(equalFloats(
+								*(const float *) a.attributes.attributes[1],
+								noperspective(coords, 1, 0)
+							));
+							for (size_t c = 0; c < 2; ++c)
+							{
+								REQUIRE(((const float *)
+									a.attributes.attributes[3])[c]
+									== ((const float *)
+									primitive.vertices[0].attributes[3])[c]);
+							}
+						}
+					}
+				}
+			}
+			REQUIRE(nofFragments > 20);
+			REQUIRE(maxCorrection > 1.f);
+		}
+	}
+}
+
+
+TEST_CASE("Polygon clipper should keep barycentric coords of vertices.")
+{
+	GPUPrimitive primitive;
+	primitive.nofUsedVertices = VERTICES_PER_TRIANGLE;
+	init_Vec4(&primitive.vertices[0].gl_Position, -3.f, -1.f, -2.f, 1.f);
+	init_Vec4(&primitive.vertices[1].gl_Position, 4.f, -1.f, 0.f, 1.f);
+	init_Vec4(&primitive.vertices[2].gl_Position, 0.f, 5.f, 0.5f, 1.f);
+	GPUTriangle triangle;
+	gpu_initTriangle(&triangle, &primitive);
+
+	// near plane cuts off one vertex, polygon is quad
+	GPUClipPolygon polygon;
+	gpu_runTriangleClipping(&polygon, &triangle, FRUSTUM_OUTCODE(NEAR));
+	REQUIRE(polygon.nofVertices == 4);
+
+	// every clip plane adds at most one vertex
+	gpu_runTriangleClipping(&polygon, &triangle, FRUSTUM_OUTCODES);
+	REQUIRE(polygon.nofVertices >= VERTICES_PER_TRIANGLE);
+	REQUIRE(polygon.nofVertices <= MAX_CLIP_POLYGON_VERTICES);
+	for (size_t v = 0; v < polygon.nofVertices; ++v)
+	{
+		for (size_t k = 0; k < 4; ++k)
+		{
+			const float values[WEIGHTS_PER_BARYCENTRICS] = {
+				primitive.vertices[0].gl_Position.data[k],
+				primitive.vertices[1].gl_Position.data[k],
+				primitive.vertices[2].gl_Position.data[k]
+			};
+			REQUIRE(fabsf(
+				gpu_noperspectiveInterpolate(values, polygon.coords[v].data)
+					- polygon.positions[v].data[k]
+			) < 1e-5f);
+		}
+		for (FrustumPlane p = LEFT; p <= FAR; p = (FrustumPlane) (p + 1))
+		{
+			Vec4 plane;
+			gpu_getFrustumPlane(&plane, p);
+			REQUIRE(dot_Vec4(&plane, polygon.positions + v) >= -1e-5f);
+		}
+	}
+	for (size_t t = 0; t + 2 < polygon.nofVertices; ++t)
+	{
+		gpu_getClipPolygonTriangle(&triangle, &polygon, t);
+		REQUIRE(triangle.positions[0].data[0] == polygon.positions[0].data[0]);
+		REQUIRE(
+			triangle.positions[2].data[1] == polygon.positions[t + 2].data[1]
+		);
+	}
+
+	// triangle behind one plane is clipped away
+	init_Vec4(&primitive.vertices[2].gl_Position, 0.f, 5.f, -3.f, 1.f);
+	init_Vec4(&primitive.vertices[1].gl_Position, 4.f, -1.f, -2.f, 1.f);
+	gpu_initTriangle(&triangle, &primitive);
+	gpu_runTriangleClipping(&polygon, &triangle, FRUSTUM_OUTCODES);
+	REQUIRE(polygon.nofVertices == 0);
+}
+
+
+TEST_CASE("Clipped vertices should copy original vertices.")
+{
+	GPUPrimitive primitive;
+	primitive.nofUsedVertices = VERTICES_PER_TRIANGLE;
+	for (size_t a = 0; a < MAX_ATTRIBUTES; ++a)
+	{ primitive.types[a] = ATTRIB_EMPTY; }
+	primitive.types[1] = ATTRIB_VEC2;
+	for (size_t v = 0; v < VERTICES_PER_TRIANGLE; ++v)
+	{
+		init_Vec4(&primitive.vertices[v].gl_Position, (float) v, 0.f, 0.f, 1.f);
+		init_Vec2(
+			(Vec2 *) primitive.vertices[v].attributes[1], (float) v * 3.f,
+			1.f / 3.f
+		);
+	}
+
+	// original vertex is copied bit by bit, position is ignored
+	GPUVertexShaderOutput vertex;
+	Vec4 position;
+	init_Vec4(&position, 7.f, 7.f, 7.f, 7.f);
+	Vec3 coords;
+	init_Vec3(&coords, 0.f, 1.f, 0.f);
+	gpu_createClippedVertex(&vertex, &primitive, &position, &coords);
+	REQUIRE(vertex.gl_Position.data[0] == 1.f);
+	REQUIRE(((Vec2 *) vertex.attributes[1])->data[0] == 3.f);
+	REQUIRE(((Vec2 *) vertex.attributes[1])->data[1] == 1.f / 3.f);
+
+	// new vertex takes clipped position and interpolates attributes
+	init_Vec3(&coords, .5f, 0.f, .5f);
+	gpu_createClippedVertex(&vertex, &primitive, &position, &coords);
+	REQUIRE(vertex.gl_Position.data[0] == 7.f);
+	REQUIRE(fabsf(((Vec2 *) vertex.attributes[1])->data[0] - 3.f) < 1e-5f);
+}
+
+
+TEST_CASE("Clip outcodes should reject, accept or clip triangles.")
+{
+	Vec4 position;
+	init_Vec4(&position, .5f, -.5f, 0.f, 1.f);
+	REQUIRE(gpu_computeClipOutcode(&position) == 0);
+	init_Vec4(&position, 2.f, -.5f, 3.f, 1.f);
+	REQUIRE(
+		gpu_computeClipOutcode(&position)
+			== (FRUSTUM_OUTCODE(RIGHT) | FRUSTUM_OUTCODE(FAR))
+	);
+	init_Vec4(&position, -100.f, 0.f, 0.f, 1.f);
+	REQUIRE(
+		gpu_computeClipOutcode(&position)
+			== (FRUSTUM_OUTCODE(LEFT) | GUARD_BAND_OUTCODE(LEFT))
+	);
+
+	GPU gpu = cpu_createGPU();
+	cpu_setViewportSize(gpu, 32, 32);
+	const ProgramID program = cpu_createProgram(gpu);
+	cpu_attachVertexShader(gpu, program, vs_passPosition);
+	cpu_attachFragmentShader(gpu, program, fs_countFragments);
+	cpu_useProgram(gpu, program);
+	// the first triangle is outside of left plane, the second one crosses
+	// right and top planes inside of guard band and the third one crosses
+	// guard band, the last two cover whole screen
+	const float positions[][4] = {
+		{-3.f, -1.f, 0.f, 1.f}, {-2.f, -1.f, 0.f, 1.f}, {-2.f, 1.f, 0.f, 1.f},
+		{-1.f, -1.f, 0.f, 1.f}, {3.f, -1.f, 0.f, 1.f}, {-1.f, 3.f, 0.f, 1.f},
+		{-1.f, -1.f, 0.f, 1.f}, {1.f, 400.f, 0.f, 1.f}, {1.f, -400.f, 0.f, 1.f},
+	};
+	BufferID buffer;
+	cpu_createBuffers(gpu, 1, &buffer);
+	cpu_bufferData(gpu, buffer, sizeof(positions), positions);
+	VertexPullerID puller;
+	cpu_createVertexPullers(gpu, 1, &puller);
+	cpu_setVertexPullerHead(gpu, puller, 0, buffer, 0, sizeof(positions[0]));
+	cpu_enableVertexPullerHead(gpu, puller, 0);
+	cpu_bindVertexPuller(gpu, puller);
+	cpu_setCullFace(gpu, CULL_NONE);
+
+	for (size_t t = 0; t < 3; ++t)
+	{
+		cpu_resetPipelineStatistics(gpu);
+		cpu_clearDepth(gpu, 10.f);
+		memset(fragmentCounts, 0, sizeof(fragmentCounts));
+		const DrawTrianglesCommand command = {3, 1, 3 * t, 0};
+		cpu_multiDrawTriangles(gpu, &command, 1);
+		const size_t nofClippedTriangles =
+			cpu_getPipelineStatistics(gpu)->nofClippedTriangles;
+		size_t nofFragments = 0;
+		for (size_t y = 0; y < 32; ++y)
+		{
+			for (size_t x = 0; x < 32; ++x)
+			{
+				REQUIRE(fragmentCounts[y][x] <= 1);
+				nofFragments += fragmentCounts[y][x];
+			}
+		}
+		switch (t)
+		{
+			case 0:
+				REQUIRE(nofClippedTriangles == 0);
+				REQUIRE(nofFragments == 0);
+				break;
+			case 1:
+				REQUIRE(nofClippedTriangles == 1);
+				REQUIRE(nofFragments == 32 * 32);
+				break;
+			default:
+				REQUIRE(nofClippedTriangles > 1);
+				REQUIRE(nofFragments == 32 * 32);
+				break;
+		}
+	}
+
+	cpu_destroyGPU(gpu);
+}
+
+
+TEST_CASE("User clip planes should be classified in batches and clipped.")
+{
+	// all kernels have to agree with the scalar one
+	size_t nofKernels;
+	const GPUClipKernelInfo *const kernels = gpu_getClipKernels(&nofKernels);
+	REQUIRE(nofKernels >= 1);
+	GPUClipBatch batch;
+	Vec4 planes[MAX_USER_CLIP_PLANES];
+	srand(7);
+	for (size_t i = 0; i < 100; ++i)
+	{
+		for (size_t c = 0; c < 4; ++c)
+		{
+			for (size_t v = 0; v < VERTICES_PER_TRIANGLE; ++v)
+			{
+				for (size_t t = 0; t < CLIP_BATCH_SIZE; ++t)
+				{
+					batch.positions[c][v][t] =
+						(float) (rand() % 200 - 100) / 10.f;
+				}
+			}
+		}
+		for (size_t p = 0; p < MAX_USER_CLIP_PLANES; ++p)
+		{
+			init_Vec4(
+				planes + p, (float) (rand() % 21 - 10),
+				(float) (rand() % 21 - 10), (float) (rand() % 21 - 10),
+				(float) (rand() % 21 - 10)
+			);
+		}
+		batch.nofTriangles = 1 + i % CLIP_BATCH_SIZE;
+		const size_t nofPlanes = 1 + i % MAX_USER_CLIP_PLANES;
+		unsigned expectedAll[CLIP_BATCH_SIZE], expectedAny[CLIP_BATCH_SIZE];
+		kernels[nofKernels - 1].kernel(
+			expectedAll, expectedAny, &batch, planes, nofPlanes
+		);
+		for (size_t k = 0; k < nofKernels; ++k)
+		{
+			unsigned all[CLIP_BATCH_SIZE], any[CLIP_BATCH_SIZE];
+			kernels[k].kernel(all, any, &batch, planes, nofPlanes);
+			for (size_t t = 0; t < batch.nofTriangles; ++t)
+			{
+				REQUIRE(all[t] == expectedAll[t]);
+				REQUIRE(any[t] == expectedAny[t]);
+			}
+		}
+	}
+
+	GPU gpu = cpu_createGPU();
+	cpu_setViewportSize(gpu, 32, 32);
+	const ProgramID program = cpu_createProgram(gpu);
+	cpu_attachVertexShader(gpu, program, vs_passPosition);
+	cpu_attachFragmentShader(gpu, program, fs_countFragments);
+	cpu_useProgram(gpu, program);
+	// triangle covers whole screen
+	const float positions[][4] = {
+		{-1.f, -1.f, 0.f, 1.f}, {3.f, -1.f, 0.f, 1.f}, {-1.f, 3.f, 0.f, 1.f},
+	};
+	BufferID buffer;
+	cpu_createBuffers(gpu, 1, &buffer);
+	cpu_bufferData(gpu, buffer, sizeof(positions), positions);
+	VertexPullerID puller;
+	cpu_createVertexPullers(gpu, 1, &puller);
+	cpu_setVertexPullerHead(gpu, puller, 0, buffer, 0, sizeof(positions[0]));
+	cpu_enableVertexPullerHead(gpu, puller, 0);
+	cpu_bindVertexPuller(gpu, puller);
+	cpu_setCullFace(gpu, CULL_NONE);
+	// clipped polygon is split into fan whose shared edges go through pixel
+	// centers, only fixed-point rasterization owns them exactly once
+	cpu_enable(gpu, FIXED_POINT_RASTERIZATION);
+
+	// the first plane keeps left half of screen, the second one rejects
+	// everything but it is disabled in the first draw
+	init_Vec4(planes + 0, -1.f, 0.f, 0.f, 0.f);
+	init_Vec4(planes + 1, 0.f, 0.f, 0.f, -1.f);
+	cpu_setClipPlane(gpu, 0, planes + 0);
+	cpu_setClipPlane(gpu, 1, planes + 1);
+	const size_t expectedFragments[] = {32 * 32, 16 * 32, 0};
+	for (size_t d = 0; d < 3; ++d)
+	{
+		if (d > 0)
+		{ cpu_enable(gpu, (Capability) (CLIP_PLANE0 + d - 1)); }
+		cpu_clearDepth(gpu, 10.f);
+		memset(fragmentCounts, 0, sizeof(fragmentCounts));
+		cpu_drawTriangles(gpu, 3);
+		size_t nofFragments = 0;
+		for (size_t y = 0; y < 32; ++y)
+		{
+			for (size_t x = 0; x < 32; ++x)
+			{
+				nofFragments += fragmentCounts[y][x];
+				if (d == 1 && x >= 16)
+				{ REQUIRE(fragmentCounts[y][x] == 0); }
+			}
+		}
+		REQUIRE(nofFragments == expectedFragments[d]);
+	}
+
+	cpu_destroyGPU(gpu);
+}
+
+
+TEST_CASE("Hierarchical depth test should reject occluded triangles.")
+{
+	GPU gpu = cpu_createGPU();
+	cpu_setViewportSize(gpu, 32, 32);
+	cpu_clearDepth(gpu, 10.f);
+	REQUIRE(gpu_getHierarchicalDepth(gpu, HIZ_FINE_TILE_SIZE)[15] == 10.f);
+	REQUIRE(gpu_getHierarchicalDepth(gpu, HIZ_COARSE_TILE_SIZE)[0] == 10.f);
+
+	size_t kernelCount;
+	GPURasterizationState state;
+	state.fragmentShader = fs_countFragments;
+	state.kernel = gpu_getRasterizationKernels(&kernelCount);
+	state.fixedPoint = 1;
+	state.hierarchicalDepth = 1;
+	state.earlyDepthTest = 0;
+
+	// triangle that covers whole viewport at depth w
+	const auto draw = [&](const float w)
+	{
+		GPUPrimitive primitive;
+		primitive.nofUsedVertices = VERTICES_PER_TRIANGLE;
+		for (size_t a = 0; a < MAX_ATTRIBUTES; ++a)
+		{ primitive.types[a] = ATTRIB_EMPTY; }
+		init_Vec4(&primitive.vertices[0].gl_Position, -1.f, -1.f, 0.f, w);
+		init_Vec4(&primitive.vertices[1].gl_Position, 100.f, -1.f, 0.f, w);
+		init_Vec4(&primitive.vertices[2].gl_Position, -1.f, 100.f, 0.f, w);
+		GPUTriangleSetup setup;
+		REQUIRE(gpu_setupTriangle(&setup, &primitive, 32, 32, 1));
+		memset(fragmentCounts, 0, sizeof(fragmentCounts));
+		gpu_rasterizeTriangleRegion(gpu, &setup, &state, 0, 0, 32, 32);
+		size_t nofFragments = 0;
+		for (auto &row : fragmentCounts)
+		{
+			for (auto count : row)
+			{ nofFragments += count; }
+		}
+		return nofFragments;
+	};
+
+	REQUIRE(draw(2.f) == 32 * 32);
+	REQUIRE(gpu_getHierarchicalDepth(gpu, HIZ_FINE_TILE_SIZE)[15] == 2.f);
+	REQUIRE(gpu_getHierarchicalDepth(gpu, HIZ_COARSE_TILE_SIZE)[0] == 2.f);
+	REQUIRE(draw(3.f) == 0);
+	REQUIRE(draw(1.f) == 32 * 32);
+
+	// depth written by CPU keeps hierarchical depth conservative, only tile
+	// that contains the far pixel is shaded
+	gpu_setDepth(gpu, 31, 31, 5.f);
+	REQUIRE(gpu_getHierarchicalDepth(gpu, HIZ_FINE_TILE_SIZE)[15] == 5.f);
+	REQUIRE(draw(3.f) == HIZ_FINE_TILE_SIZE * HIZ_FINE_TILE_SIZE);
+
+	cpu_clearDepth(gpu, 10.f);
+	REQUIRE(draw(3.f) == 32 * 32);
+
+	// quads of shader that writes depth cannot be rejected by interpolated
+	// depth
+	REQUIRE(draw(1.f) == 32 * 32);
+	const ProgramID program = cpu_createProgram(gpu);
+	cpu_attachVertexShader(gpu, program, vs_passPosition);
+	cpu_attachFragmentShader(gpu, program, fs_countFragments);
+	cpu_useProgram(gpu, program);
+	cpu_enable(gpu, HIERARCHICAL_DEPTH_TEST);
+	gpu_initRasterizationState(&state, gpu);
+	REQUIRE(state.hierarchicalDepth == 1);
+	cpu_setFragmentShaderEffects(gpu, program, FRAGMENT_WRITES_DEPTH);
+	gpu_initRasterizationState(&state, gpu);
+	REQUIRE(state.hierarchicalDepth == 0);
+	state.fixedPoint = 1;
+	REQUIRE(draw(3.f) == 32 * 32);
+
+	cpu_destroyGPU(gpu);
+}
+
+
+TEST_CASE("Face culling should respect cull mode and front face.")
+{
+	GPUPrimitive primitive;
+	primitive.nofUsedVertices = VERTICES_PER_TRIANGLE;
+	for (size_t a = 0; a < MAX_ATTRIBUTES; ++a)
+	{ primitive.types[a] = ATTRIB_EMPTY; }
+	// clockwise triangle in screen space
+	init_Vec4(&primitive.vertices[0].gl_Position, 2.f, 2.f, 0.f, 1.f);
+	init_Vec4(&primitive.vertices[1].gl_Position, 2.f, 20.f, 0.f, 1.f);
+	init_Vec4(&primitive.vertices[2].gl_Position, 20.f, 2.f, 0.f, 1.f);
+	REQUIRE(gpu_computeTriangleSignedArea(&primitive) < 0.f);
+
+	REQUIRE(gpu_isTriangleCulled(&primitive, CULL_BACK, FRONT_FACE_CCW));
+	REQUIRE(!gpu_isTriangleCulled(&primitive, CULL_FRONT, FRONT_FACE_CCW));
+	REQUIRE(!gpu_isTriangleCulled(&primitive, CULL_BACK, FRONT_FACE_CW));
+	REQUIRE(gpu_isTriangleCulled(&primitive, CULL_FRONT, FRONT_FACE_CW));
+	REQUIRE(!gpu_isTriangleCulled(&primitive, CULL_NONE, FRONT_FACE_CCW));
+
+	// clockwise triangle that is not culled has to be rasterized
+	GPUTriangleSetup setup;
+	REQUIRE(gpu_setupTriangle(&setup, &primitive, 32, 32, 1));
+	REQUIRE(gpu_computeTriangleSignedArea(&setup.primitive) > 0.f);
+}
+
+
+TEST_CASE("Rejected triangles should not cover any sample.")
+{
+	GPU gpu = cpu_createGPU();
+	cpu_setViewportSize(gpu, 32, 32);
+	size_t kernelCount;
+	GPURasterizationState state;
+	state.fragmentShader = fs_countFragments;
+	state.kernel = gpu_getRasterizationKernels(&kernelCount);
+	state.hierarchicalDepth = 0;
+	state.earlyDepthTest = 0;
+
+	PipelineStatistics statistics;
+	memset(&statistics, 0, sizeof(statistics));
+	size_t nofRejected = 0;
+	for (int fixedPoint = 0; fixedPoint < 2; ++fixedPoint)
+	{
+		state.fixedPoint = fixedPoint;
+		// small triangles (both windings) at sub-pixel offsets around
+		// pixel center [10.5,10.5]
+		for (size_t t = 0; t < 256; ++t)
+		{
+			const float ox = 10.f + (float) (t % 16) / 16.f;
+			const float oy = 10.f + (float) (t / 16) / 16.f;
+			const float size = t % 2 ? .3f : -.3f;
+			Vec2 positions[VERTICES_PER_TRIANGLE];
+			init_Vec2(positions + 0, ox, oy);
+			init_Vec2(positions + 1, ox + size, oy);
+			init_Vec2(positions + 2, ox, oy + (t % 3 ? .3f : 0.f));
+
+			GPUPrimitive primitive;
+			primitive.nofUsedVertices = VERTICES_PER_TRIANGLE;
+			for (size_t a = 0; a < MAX_ATTRIBUTES; ++a)
+			{ primitive.types[a] = ATTRIB_EMPTY; }
+			for (size_t v = 0; v < VERTICES_PER_TRIANGLE; ++v)
+			{
+				init_Vec4(
+					&primitive.vertices[v].gl_Position,
+					positions[v].data[0], positions[v].data[1], 0.f, 1.f
+				);
+			}
+			if (!gpu_rejectTriangle(
+				positions, 32, 32, fixedPoint, &statistics
+			))
+			{ continue; }
+
+			nofRejected++;
+			memset(fragmentCounts, 0, sizeof(fragmentCounts));
+			GPUTriangleSetup setup;
+			if (gpu_setupTriangle(&setup, &primitive, 32, 32, fixedPoint))
+			{
+				gpu_rasterizeTriangleRegion(gpu, &setup, &state, 0, 0, 32, 32);
+			}
+			REQUIRE(fragmentCounts[10][10] == 0);
+		}
+	}
+
+	REQUIRE(nofRejected == statistics.nofDegenerateTriangles
+		+ statistics.nofEmptyTriangles
+		+ statistics.nofSubPixelRejectedTriangles);
+	REQUIRE(statistics.nofDegenerateTriangles > 0);
+	REQUIRE(statistics.nofEmptyTriangles > 0);
+	REQUIRE(statistics.nofSubPixelRejectedTriangles > 0);
+	REQUIRE(
+		statistics.nofSubPixelTriangles
+			> statistics.nofSubPixelRejectedTriangles
+	);
+
+	cpu_destroyGPU(gpu);
+}
+
+
+TEST_CASE("Depth test mode should follow fragment shader effects.")
+{
+	GPU gpu = cpu_createGPU();
+	const ProgramID program = cpu_createProgram(gpu);
+	cpu_useProgram(gpu, program);
+	REQUIRE(gpu_isEarlyDepthTestActive(gpu) == 1);
+
+	cpu_setFragmentShaderEffects(gpu, program, FRAGMENT_DISCARDS);
+	REQUIRE(gpu_isEarlyDepthTestActive(gpu) == 0);
+	cpu_setFragmentShaderEffects(gpu, program, FRAGMENT_WRITES_DEPTH);
+	REQUIRE(gpu_isEarlyDepthTestActive(gpu) == 0);
+
+	cpu_setDepthTestMode(gpu, program, DEPTH_TEST_EARLY);
+	REQUIRE(gpu_isEarlyDepthTestActive(gpu) == 1);
+	cpu_setFragmentShaderEffects(gpu, program, 0);
+	cpu_setDepthTestMode(gpu, program, DEPTH_TEST_LATE);
+	REQUIRE(gpu_isEarlyDepthTestActive(gpu) == 0);
+
+	cpu_destroyGPU(gpu);
+}
+
+
+TEST_CASE("Mesh optimizer should reorder triangles and vertices of bunny.")
+{
+	const size_t nofIndices = sizeof(bunnyIndices) / sizeof(bunnyIndices[0][0]);
+	const size_t nofVertices = sizeof(bunnyVertices) / sizeof(bunnyVertices[0]);
+	const size_t cacheSize = MESH_OPTIMIZER_CACHE_SIZE;
+	std::vector<uint16_t> indices(nofIndices);
+	std::vector<BunnyVertex> vertices(nofVertices);
+
+	cpu_optimizeVertexCache(
+		indices.data(), bunnyIndices, sizeof(uint16_t), nofIndices,
+		nofVertices, cacheSize
+	);
+	const float cacheACMR =
+		cpu_computeACMR(indices.data(), sizeof(uint16_t), nofIndices, cacheSize);
+	REQUIRE(
+		cacheACMR
+		< cpu_computeACMR(bunnyIndices, sizeof(uint16_t), nofIndices, cacheSize)
+	);
+
+	cpu_optimizeOverdraw(
+		indices.data(), indices.data(), sizeof(uint16_t), nofIndices,
+		bunnyVertices[0].position, sizeof(BunnyVertex), nofVertices, cacheSize,
+		MESH_OPTIMIZER_OVERDRAW_THRESHOLD
+	);
+	REQUIRE(
+		cpu_computeACMR(indices.data(), sizeof(uint16_t), nofIndices, cacheSize)
+		<= cacheACMR * 1.5f
+	);
+
+	const size_t nofUsedVertices = cpu_optimizeVertexFetch(
+		vertices.data(), bunnyVertices, sizeof(BunnyVertex), indices.data(),
+		sizeof(uint16_t), nofIndices, nofVertices
+	);
+	REQUIRE(nofUsedVertices <= nofVertices);
+
+	// optimized mesh has to contain the same triangles with the same winding
+	auto key = [](const BunnyVertex &a, const BunnyVertex &b,
+		const BunnyVertex &c)
+	{
+		std::vector<float> result;
+		const BunnyVertex *triangle[3] = {&a, &b, &c};
+		size_t first = 0;
+		for (size_t i = 1; i < 3; ++i)
+		{
+			if (
+				std::lexicographical_compare(
+					triangle[i]->position, triangle[i]->position + 3,
+					triangle[first]->position, triangle[first]->position + 3
+				)
+			)
+			{ first = i; }
+		}
+		for (size_t i = 0; i < 3; ++i)
+		{
+			const BunnyVertex *vertex = triangle[(first + i) % 3];
+			result.insert(result.end(), vertex->position, vertex->position + 3);
+			result.insert(result.end(), vertex->normal, vertex->normal + 3);
+		}
+		return result;
+	};
+	std::vector<std::vector<float>> original, optimized;
+	for (size_t t = 0; t < nofIndices / 3; ++t)
+	{
+		original.push_back(key(
+			bunnyVertices[bunnyIndices[t][0]], bunnyVertices[bunnyIndices[t][1]],
+			bunnyVertices[bunnyIndices[t][2]]
+		));
+		REQUIRE(indices[t * 3 + 0] < nofUsedVertices);
+		REQUIRE(indices[t * 3 + 1] < nofUsedVertices);
+		REQUIRE(indices[t * 3 + 2] < nofUsedVertices);
+		optimized.push_back(key(
+			vertices[indices[t * 3 + 0]], vertices[indices[t * 3 + 1]],
+			vertices[indices[t * 3 + 2]]
+		));
+	}
+	std::sort(original.begin(), original.end());
+	std::sort(optimized.begin(), optimized.end());
+	REQUIRE(original == optimized);
+
+	// vertices are fetched in order of their first use
+	size_t nextVertex = 0;
+	for (size_t i = 0; i < nofIndices; ++i)
+	{
+		REQUIRE(indices[i] <= nextVertex);
+		if (indices[i] == nextVertex)
+		{ ++nextVertex; }
+	}
+	REQUIRE(nextVertex == nofUsedVertices);
+}
+
+
 TEST_CASE("Application should render correct image.")
 {
 	int32_t windowWidth = 500;